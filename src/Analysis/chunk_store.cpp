@@ -0,0 +1,132 @@
+#include "chunk_store.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Analysis {
+
+namespace {
+    template <class T>
+    void write_value(std::ofstream& out, T value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <class T>
+    bool read_value(std::string_view data, size_t& offset, T& value)
+    {
+        if (offset + sizeof(T) > data.size()) {
+            return false;
+        }
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+} // namespace
+
+ChunkStoreWriter::ChunkStoreWriter(const std::string& path, size_t chunk_size)
+    : m_out(path, std::ios::binary)
+    , m_chunk_size(chunk_size)
+{
+    if (!m_out.is_open()) {
+        throw std::runtime_error("Failed to open trace store " + path);
+    }
+    m_out << STORE_MAGIC;
+    write_value(m_out, STORE_VERSION);
+    write_value(m_out, uint32_t { 0 });
+    m_chunk.data.reserve(chunk_size + 4096);
+}
+
+void ChunkStoreWriter::append(Builder& chunk, int64_t ts, int64_t end, uint64_t thread_key, std::string_view json)
+{
+    chunk.data += json;
+    chunk.data += '\n';
+    chunk.info.ts_min = std::min(chunk.info.ts_min, ts);
+    chunk.info.end_max = std::max(chunk.info.end_max, end);
+    ++chunk.info.events;
+    if (std::ranges::find(chunk.info.threads, thread_key) == chunk.info.threads.end()) {
+        chunk.info.threads.push_back(thread_key);
+    }
+    if (chunk.data.size() >= m_chunk_size) {
+        flush(chunk);
+    }
+}
+
+void ChunkStoreWriter::flush(Builder& chunk)
+{
+    if (chunk.info.events == 0) {
+        return;
+    }
+    chunk.info.offset = m_offset;
+    chunk.info.size = chunk.data.size();
+    std::ranges::sort(chunk.info.threads);
+    m_out.write(chunk.data.data(), static_cast<std::streamsize>(chunk.data.size()));
+    m_offset += chunk.data.size();
+    m_index.push_back(std::move(chunk.info));
+
+    chunk.data.clear();
+    chunk.info = { 0, 0, INT64_MAX, INT64_MIN, 0, {} };
+}
+
+void ChunkStoreWriter::close()
+{
+    flush(m_chunk);
+    flush(m_late_chunk);
+
+    const uint64_t index_offset = m_offset;
+    for (const ChunkInfo& info : m_index) {
+        write_value(m_out, info.offset);
+        write_value(m_out, info.size);
+        write_value(m_out, info.ts_min);
+        write_value(m_out, info.end_max);
+        write_value(m_out, info.events);
+        write_value(m_out, static_cast<uint32_t>(info.threads.size()));
+        for (const uint64_t thread : info.threads) {
+            write_value(m_out, thread);
+        }
+    }
+    write_value(m_out, index_offset);
+    write_value(m_out, static_cast<uint64_t>(m_index.size()));
+    m_out << INDEX_MAGIC;
+    m_out.close();
+    if (!m_out) {
+        throw std::runtime_error("Failed to write the trace store");
+    }
+}
+
+std::optional<std::vector<ChunkInfo>> read_chunk_index(std::string_view data)
+{
+    if (data.size() < STORE_HEADER_SIZE + STORE_TRAILER_SIZE || !data.starts_with(STORE_MAGIC) || !data.ends_with(INDEX_MAGIC)) {
+        return std::nullopt;
+    }
+    size_t offset = data.size() - STORE_TRAILER_SIZE;
+    uint64_t index_offset = 0;
+    uint64_t chunk_count = 0;
+    read_value(data, offset, index_offset);
+    read_value(data, offset, chunk_count);
+
+    const std::string_view index = data.substr(0, data.size() - STORE_TRAILER_SIZE);
+    std::vector<ChunkInfo> chunks;
+    offset = index_offset;
+    for (uint64_t i = 0; i < chunk_count; ++i) {
+        ChunkInfo info {};
+        uint32_t thread_count = 0;
+        const bool is_read = read_value(index, offset, info.offset) && read_value(index, offset, info.size)
+            && read_value(index, offset, info.ts_min) && read_value(index, offset, info.end_max)
+            && read_value(index, offset, info.events) && read_value(index, offset, thread_count);
+        // A corrupt thread count must not size the vector before it's checked against the data left
+        if (!is_read || info.offset < STORE_HEADER_SIZE || info.offset + info.size > index_offset
+            || thread_count > (index.size() - offset) / sizeof(uint64_t)) {
+            return std::nullopt;
+        }
+        info.threads.resize(thread_count);
+        for (uint64_t& thread : info.threads) {
+            read_value(index, offset, thread);
+        }
+        chunks.push_back(std::move(info));
+    }
+    return chunks;
+}
+
+} // namespace Analysis
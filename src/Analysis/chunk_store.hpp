@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Analysis {
+
+// Chunked trace store
+//
+//   "TRCSTORE" version:u32 reserved:u32
+//   chunk payloads, each a run of JSON events, one per line
+//   index: per chunk offset:u64 size:u64 ts_min:i64 end_max:i64 events:u32 thread_count:u32
+//          followed by thread_count thread keys:u64 (SelfTimeTracker::thread_key)
+//   index_offset:u64 chunk_count:u64 "TRCINDEX"
+//
+// Integers are in native byte order. Payloads are plain JSON lines, so a store that lost its index
+// in a crash can still be read sequentially.
+
+static constexpr std::string_view STORE_MAGIC { "TRCSTORE" };
+static constexpr std::string_view INDEX_MAGIC { "TRCINDEX" };
+static constexpr uint32_t STORE_VERSION { 1 };
+static constexpr size_t STORE_HEADER_SIZE { 16 };
+static constexpr size_t STORE_TRAILER_SIZE { 24 };
+
+struct ChunkInfo {
+    uint64_t offset;
+    uint64_t size;
+    int64_t ts_min;
+    /// @var end_max Latest end (ts + dur) of the chunk's events, so long scopes are found by any
+    /// window they overlap
+    int64_t end_max;
+    uint32_t events;
+    std::vector<uint64_t> threads;
+
+    bool overlaps(int64_t from, int64_t to) const { return ts_min <= to && end_max >= from; }
+};
+
+/// @brief Writes a chunked store. Events should arrive in time order, which keeps the time ranges
+/// of the chunks narrow.
+///
+/// Events that arrive out of order can be written with write_late(). They are gathered in chunks of
+/// their own, so they don't widen the range of the ordered ones.
+class ChunkStoreWriter {
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE { 1024 * 1024 };
+
+    ChunkStoreWriter(const std::string& path, size_t chunk_size);
+
+    void write(int64_t ts, int64_t end, uint64_t thread_key, std::string_view json) { append(m_chunk, ts, end, thread_key, json); }
+    void write_late(int64_t ts, int64_t end, uint64_t thread_key, std::string_view json) { append(m_late_chunk, ts, end, thread_key, json); }
+
+    /// @brief Write the open chunks and the index
+    void close();
+
+    size_t chunk_count() const { return m_index.size(); }
+
+private:
+    struct Builder {
+        std::string data;
+        ChunkInfo info { 0, 0, INT64_MAX, INT64_MIN, 0, {} };
+    };
+
+    void append(Builder& chunk, int64_t ts, int64_t end, uint64_t thread_key, std::string_view json);
+    void flush(Builder& chunk);
+
+    std::ofstream m_out;
+    size_t m_chunk_size;
+    uint64_t m_offset { STORE_HEADER_SIZE };
+    std::vector<ChunkInfo> m_index;
+    Builder m_chunk;
+    Builder m_late_chunk;
+};
+
+/// @brief The chunk index of a store, nullopt when the data isn't a store or has no valid index
+std::optional<std::vector<ChunkInfo>> read_chunk_index(std::string_view data);
+
+} // namespace Analysis
@@ -0,0 +1,283 @@
+#include "column_query.hpp"
+
+#include "timeline.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace Analysis {
+
+namespace {
+    constexpr std::array<std::pair<std::string_view, Predicate::Op>, 7> OPERATORS { {
+        // Two character operators first, "<=" isn't "<" followed by "=1"
+        { "!=", Predicate::Op::NE },
+        { "<=", Predicate::Op::LE },
+        { ">=", Predicate::Op::GE },
+        { "=", Predicate::Op::EQ },
+        { "<", Predicate::Op::LT },
+        { ">", Predicate::Op::GT },
+        { "~", Predicate::Op::CONTAINS },
+    } };
+
+    /// @brief A predicate bound to the dictionary of a store
+    struct Filter {
+        Column column;
+        Predicate::Op op;
+        int64_t value;
+
+        /// @var matches For name and cat, whether each dictionary code matches
+        std::vector<uint8_t> matches;
+
+        /// @var min_code,max_code Range of the matching codes, for the zone maps
+        int64_t min_code;
+        int64_t max_code;
+    };
+
+    Filter bind(const Predicate& predicate, const std::vector<std::string_view>& dictionary)
+    {
+        Filter filter { predicate.column, predicate.op, predicate.value, {}, INT64_MAX, INT64_MIN };
+        if (!is_string_column(predicate.column)) {
+            return filter;
+        }
+        filter.matches.resize(dictionary.size());
+        for (size_t code = 0; code < dictionary.size(); ++code) {
+            const std::string_view value = dictionary[code];
+            const bool is_match = predicate.op == Predicate::Op::EQ ? value == predicate.text
+                : predicate.op == Predicate::Op::NE                 ? value != predicate.text
+                                                                    : value.find(predicate.text) != std::string_view::npos;
+            filter.matches[code] = is_match ? 1 : 0;
+            if (is_match) {
+                filter.min_code = std::min(filter.min_code, static_cast<int64_t>(code));
+                filter.max_code = std::max(filter.max_code, static_cast<int64_t>(code));
+            }
+        }
+        return filter;
+    }
+
+    /// @brief Whether any row of a zone could pass the filter
+    bool may_match(const Filter& filter, const ZoneMap& zone)
+    {
+        if (!filter.matches.empty()) {
+            return filter.min_code <= zone.max && filter.max_code >= zone.min;
+        }
+        switch (filter.op) {
+        case Predicate::Op::EQ:
+            return zone.min <= filter.value && filter.value <= zone.max;
+        case Predicate::Op::NE:
+            return zone.min != filter.value || zone.max != filter.value;
+        case Predicate::Op::LT:
+            return zone.min < filter.value;
+        case Predicate::Op::LE:
+            return zone.min <= filter.value;
+        case Predicate::Op::GT:
+            return zone.max > filter.value;
+        case Predicate::Op::GE:
+            return zone.max >= filter.value;
+        case Predicate::Op::CONTAINS:
+            return true;
+        }
+        return true;
+    }
+
+    /// @brief Clear the rows of `selected` that fail `test`, without branches in the loop
+    template <class Test>
+    void narrow(std::vector<uint8_t>& selected, const std::vector<int64_t>& values, Test test)
+    {
+        for (size_t i = 0; i < selected.size(); ++i) {
+            selected[i] &= static_cast<uint8_t>(test(values[i]));
+        }
+    }
+
+    void apply(const Filter& filter, const std::vector<int64_t>& values, std::vector<uint8_t>& selected)
+    {
+        if (!filter.matches.empty()) {
+            const uint8_t* matches = filter.matches.data();
+            narrow(selected, values, [matches](int64_t code) { return matches[code]; });
+            return;
+        }
+        const int64_t value = filter.value;
+        switch (filter.op) {
+        case Predicate::Op::EQ:
+            narrow(selected, values, [value](int64_t v) { return v == value; });
+            break;
+        case Predicate::Op::NE:
+            narrow(selected, values, [value](int64_t v) { return v != value; });
+            break;
+        case Predicate::Op::LT:
+            narrow(selected, values, [value](int64_t v) { return v < value; });
+            break;
+        case Predicate::Op::LE:
+            narrow(selected, values, [value](int64_t v) { return v <= value; });
+            break;
+        case Predicate::Op::GT:
+            narrow(selected, values, [value](int64_t v) { return v > value; });
+            break;
+        case Predicate::Op::GE:
+            narrow(selected, values, [value](int64_t v) { return v >= value; });
+            break;
+        case Predicate::Op::CONTAINS:
+            break;
+        }
+    }
+
+    using GroupKey = std::array<int64_t, COLUMN_COUNT>;
+
+    struct GroupKeyHash {
+        size_t operator()(const GroupKey& key) const
+        {
+            size_t hash = 0;
+            for (const int64_t value : key) {
+                hash = (hash ^ static_cast<size_t>(value)) * 0x100000001b3ULL;
+            }
+            return hash;
+        }
+    };
+
+    struct Partial {
+        std::unordered_map<GroupKey, HdrHistogram, GroupKeyHash> groups;
+        uint64_t rows_scanned { 0 };
+        uint64_t rows_matched { 0 };
+        size_t row_groups_skipped { 0 };
+
+        // Decoded columns and the selection vector, reused across row groups
+        std::array<std::vector<int64_t>, COLUMN_COUNT> columns;
+        std::vector<uint8_t> selected;
+    };
+} // namespace
+
+std::optional<Predicate> parse_predicate(std::string_view text)
+{
+    for (const auto& [symbol, op] : OPERATORS) {
+        const size_t position = text.find(symbol);
+        if (position == std::string_view::npos || position == 0) {
+            continue;
+        }
+        // "a<=b" also contains "=", take the operator that starts first
+        if (text.find_first_of("!<>=~") != position) {
+            continue;
+        }
+        const auto column = parse_column(text.substr(0, position));
+        const std::string_view value = text.substr(position + symbol.size());
+        if (!column) {
+            return std::nullopt;
+        }
+        Predicate predicate { *column, op, 0, "" };
+        if (is_string_column(*column)) {
+            const bool is_string_op = op == Predicate::Op::EQ || op == Predicate::Op::NE || op == Predicate::Op::CONTAINS;
+            if (!is_string_op) {
+                return std::nullopt;
+            }
+            predicate.text = value;
+            return predicate;
+        }
+        if (op == Predicate::Op::CONTAINS) {
+            return std::nullopt;
+        }
+        if (*column == Column::PH) {
+            if (value.size() != 1) {
+                return std::nullopt;
+            }
+            predicate.value = value.front();
+            return predicate;
+        }
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), predicate.value);
+        if (value.empty() || error != std::errc {} || end != value.data() + value.size()) {
+            return std::nullopt;
+        }
+        return predicate;
+    }
+    return std::nullopt;
+}
+
+QueryResult run_query(const ColumnStore& store, const Query& query)
+{
+    for (const Column column : query.group_by) {
+        if (column == Column::TS || column == Column::DUR) {
+            throw std::invalid_argument("Grouping by ts or dur would make a group per event");
+        }
+    }
+
+    std::vector<Filter> filters;
+    for (const Predicate& predicate : query.where) {
+        filters.push_back(bind(predicate, store.dictionary()));
+    }
+
+    const size_t workers = std::max<size_t>(query.threads, 1);
+    std::vector<Partial> partials(workers);
+    const auto& row_groups = store.row_groups();
+
+    parallel_for(row_groups.size(), workers, [&](size_t worker, size_t index) {
+        Partial& partial = partials[worker];
+        const RowGroup& group = row_groups[index];
+        if (!std::ranges::all_of(filters, [&](const Filter& filter) { return may_match(filter, group.column(filter.column).zone); })) {
+            ++partial.row_groups_skipped;
+            return;
+        }
+        partial.rows_scanned += group.rows;
+
+        auto& columns = partial.columns;
+        const auto column_values = [&](Column column) -> std::vector<int64_t>& { return columns[static_cast<size_t>(column)]; };
+        std::array<bool, COLUMN_COUNT> is_decoded {};
+        const auto decode = [&](Column column) {
+            if (!is_decoded[static_cast<size_t>(column)]) {
+                store.decode(group, column, column_values(column));
+                is_decoded[static_cast<size_t>(column)] = true;
+            }
+        };
+
+        partial.selected.assign(group.rows, 1);
+        for (const Filter& filter : filters) {
+            decode(filter.column);
+            apply(filter, column_values(filter.column), partial.selected);
+        }
+        decode(Column::DUR);
+        for (const Column column : query.group_by) {
+            decode(column);
+        }
+
+        const std::vector<int64_t>& dur = column_values(Column::DUR);
+        GroupKey key {};
+        HdrHistogram* last = nullptr;
+        for (size_t row = 0; row < group.rows; ++row) {
+            if (partial.selected[row] == 0) {
+                continue;
+            }
+            ++partial.rows_matched;
+            GroupKey row_key {};
+            for (size_t i = 0; i < query.group_by.size(); ++i) {
+                row_key[i] = column_values(query.group_by[i])[row];
+            }
+            // Sorted rows often repeat the key of the previous one
+            if (last == nullptr || row_key != key) {
+                key = row_key;
+                last = &partial.groups[key];
+            }
+            last->record(dur[row]);
+        }
+    });
+
+    QueryResult result { {}, 0, 0, 0 };
+    std::map<GroupKey, HdrHistogram> merged;
+    for (Partial& partial : partials) {
+        result.rows_scanned += partial.rows_scanned;
+        result.rows_matched += partial.rows_matched;
+        result.row_groups_skipped += partial.row_groups_skipped;
+        for (auto& [key, histogram] : partial.groups) {
+            const auto [it, is_new] = merged.try_emplace(key, std::move(histogram));
+            if (!is_new) {
+                it->second.merge(histogram);
+            }
+        }
+        // Released as soon as it's merged, only one state per group stays
+        partial.groups = {};
+    }
+    for (auto& [key, histogram] : merged) {
+        result.groups.push_back({ std::vector<int64_t>(key.begin(), key.begin() + static_cast<std::ptrdiff_t>(query.group_by.size())), std::move(histogram) });
+    }
+    return result;
+}
+
+} // namespace Analysis
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "column_store.hpp"
+#include "hdr_histogram.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Analysis {
+
+/// @brief A filter on one column: "dur>=1000", "cat=io", "name~alloc"
+struct Predicate {
+    enum class Op : uint8_t {
+        EQ,
+        NE,
+        LT,
+        LE,
+        GT,
+        GE,
+        CONTAINS, // substring of a name or category
+    };
+
+    Column column;
+    Op op;
+
+    /// @var value Compared integer, the character for ph
+    int64_t value;
+
+    /// @var text Compared string for name and cat
+    std::string text;
+};
+
+/// @brief Parse "<column><op><value>", nullopt if the column, operator or value is invalid
+std::optional<Predicate> parse_predicate(std::string_view text);
+
+struct Query {
+    std::vector<Predicate> where;
+
+    /// @var group_by Columns of the group key, among name, cat, ph, pid and tid
+    std::vector<Column> group_by;
+
+    size_t threads;
+};
+
+/// @brief Aggregates of the matching rows that share a group key
+struct QueryGroup {
+    /// @var key Values of the group_by columns, dictionary codes for strings
+    std::vector<int64_t> key;
+
+    HdrHistogram dur;
+};
+
+struct QueryResult {
+    std::vector<QueryGroup> groups;
+    uint64_t rows_scanned;
+    uint64_t rows_matched;
+    size_t row_groups_skipped;
+};
+
+/// @brief Filter and group the rows of a store on up to `threads` threads.
+///
+/// Row groups whose zone maps rule out a predicate are skipped without decoding. The others are
+/// decoded column by column into arrays; every predicate narrows a selection vector in a tight loop
+/// the compiler vectorizes, and only the selected rows are grouped. Workers aggregate row groups
+/// into partial groups that are merged at the end.
+QueryResult run_query(const ColumnStore& store, const Query& query);
+
+} // namespace Analysis
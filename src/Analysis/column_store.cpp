@@ -0,0 +1,289 @@
+#include "column_store.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+namespace Analysis {
+
+namespace {
+    constexpr std::array<std::string_view, COLUMN_COUNT> COLUMN_NAMES { "name", "cat", "ph", "ts", "dur", "pid", "tid" };
+
+    enum class Encoding : uint8_t {
+        FRAME,
+        DELTA,
+    };
+
+    template <class T>
+    void append_value(std::string& out, T value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <class T>
+    bool read_value(std::string_view data, size_t& offset, T& value)
+    {
+        if (offset + sizeof(T) > data.size()) {
+            return false;
+        }
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    /// @brief Bits needed for the distance between the smallest and largest value
+    std::pair<int64_t, int> frame_of(const std::vector<int64_t>& values)
+    {
+        const auto [min, max] = std::ranges::minmax(values);
+        return { min, std::bit_width(static_cast<uint64_t>(max) - static_cast<uint64_t>(min)) };
+    }
+
+    /// @brief Encode one column of a row group, with deltas when they pack tighter than the values
+    std::string encode_block(const std::vector<int64_t>& values)
+    {
+        std::vector<int64_t> deltas(values.size());
+        std::adjacent_difference(values.begin(), values.end(), deltas.begin());
+        deltas.front() = 0;
+        // The first delta is implied, the frame is taken over the others
+        const auto [delta_base, delta_width] = values.size() > 1
+            ? frame_of(std::vector<int64_t>(deltas.begin() + 1, deltas.end()))
+            : std::pair<int64_t, int> { 0, 0 };
+        const auto [frame_base, frame_width] = frame_of(values);
+
+        const bool is_delta = delta_width < frame_width;
+        const Encoding encoding = is_delta ? Encoding::DELTA : Encoding::FRAME;
+        const int64_t base = is_delta ? delta_base : frame_base;
+        const int width = is_delta ? delta_width : frame_width;
+        const std::vector<int64_t>& packed = is_delta ? deltas : values;
+
+        std::string block;
+        append_value(block, static_cast<uint8_t>(encoding));
+        append_value(block, static_cast<uint8_t>(width));
+        append_value(block, uint16_t { 0 });
+        append_value(block, uint32_t { 0 });
+        append_value(block, base);
+        append_value(block, values.front());
+
+        std::vector<uint64_t> words((values.size() * static_cast<size_t>(width) + 63) / 64, 0);
+        for (size_t i = 0; i < values.size() && width != 0; ++i) {
+            // The implied first delta is packed as 0 whatever the base
+            const uint64_t value = is_delta && i == 0 ? 0 : static_cast<uint64_t>(packed[i]) - static_cast<uint64_t>(base);
+            const size_t bit = i * static_cast<size_t>(width);
+            const size_t shift = bit % 64;
+            words[bit / 64] |= value << shift;
+            if (shift + static_cast<size_t>(width) > 64) {
+                words[bit / 64 + 1] |= value >> (64 - shift);
+            }
+        }
+        block.append(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint64_t));
+        return block;
+    }
+} // namespace
+
+std::string_view column_name(Column column)
+{
+    return COLUMN_NAMES[static_cast<size_t>(column)];
+}
+
+std::optional<Column> parse_column(std::string_view name)
+{
+    const auto it = std::ranges::find(COLUMN_NAMES, name);
+    if (it == COLUMN_NAMES.end()) {
+        return std::nullopt;
+    }
+    return static_cast<Column>(it - COLUMN_NAMES.begin());
+}
+
+ColumnStoreWriter::ColumnStoreWriter(const std::string& path, size_t row_group_rows)
+    : m_out(path, std::ios::binary)
+    , m_row_group_rows(std::max<size_t>(row_group_rows, 1))
+{
+    if (!m_out.is_open()) {
+        throw std::runtime_error("Failed to open column store " + path);
+    }
+    std::string header(COLUMN_STORE_MAGIC);
+    append_value(header, COLUMN_STORE_VERSION);
+    append_value(header, uint32_t { 0 });
+    m_out << header;
+    for (auto& column : m_columns) {
+        column.reserve(m_row_group_rows);
+    }
+}
+
+int64_t ColumnStoreWriter::code(std::string_view value)
+{
+    const auto it = m_codes.find(value);
+    if (it != m_codes.end()) {
+        return it->second;
+    }
+    const auto code = static_cast<int64_t>(m_dictionary.size());
+    m_dictionary.emplace_back(value);
+    m_codes.emplace(m_dictionary.back(), code);
+    return code;
+}
+
+void ColumnStoreWriter::write(std::string_view name, std::string_view cat, char ph, int64_t ts, int64_t dur, int pid, uint64_t tid)
+{
+    const std::array<int64_t, COLUMN_COUNT> row { code(name), code(cat), ph, ts, dur, pid, static_cast<int64_t>(tid) };
+    for (size_t i = 0; i < COLUMN_COUNT; ++i) {
+        m_columns[i].push_back(row[i]);
+    }
+    if (m_columns.front().size() >= m_row_group_rows) {
+        flush();
+    }
+}
+
+void ColumnStoreWriter::flush()
+{
+    const size_t rows = m_columns.front().size();
+    if (rows == 0) {
+        return;
+    }
+    std::vector<uint32_t> order(rows);
+    std::iota(order.begin(), order.end(), 0);
+    const std::vector<int64_t>& ts = m_columns[static_cast<size_t>(Column::TS)];
+    std::ranges::stable_sort(order, {}, [&](uint32_t row) { return ts[row]; });
+
+    RowGroup group { static_cast<uint32_t>(rows), {} };
+    std::vector<int64_t> sorted(rows);
+    for (size_t i = 0; i < COLUMN_COUNT; ++i) {
+        std::ranges::transform(order, sorted.begin(), [&](uint32_t row) { return m_columns[i][row]; });
+        const std::string block = encode_block(sorted);
+        const auto [min, max] = std::ranges::minmax(sorted);
+        group.columns[i] = { m_offset, block.size(), { min, max } };
+        m_out.write(block.data(), static_cast<std::streamsize>(block.size()));
+        m_offset += block.size();
+        m_columns[i].clear();
+    }
+    m_row_groups.push_back(group);
+    m_rows += rows;
+}
+
+void ColumnStoreWriter::close()
+{
+    flush();
+
+    std::string footer;
+    append_value(footer, static_cast<uint32_t>(m_dictionary.size()));
+    for (const std::string& value : m_dictionary) {
+        append_value(footer, static_cast<uint32_t>(value.size()));
+        footer += value;
+    }
+    append_value(footer, static_cast<uint32_t>(m_row_groups.size()));
+    for (const RowGroup& group : m_row_groups) {
+        append_value(footer, group.rows);
+        for (const ColumnChunk& chunk : group.columns) {
+            append_value(footer, chunk.offset);
+            append_value(footer, chunk.size);
+            append_value(footer, chunk.zone.min);
+            append_value(footer, chunk.zone.max);
+        }
+    }
+    append_value(footer, m_offset);
+    footer += COLUMN_FOOTER_MAGIC;
+
+    m_out.write(footer.data(), static_cast<std::streamsize>(footer.size()));
+    m_out.close();
+    if (!m_out) {
+        throw std::runtime_error("Failed to write the column store");
+    }
+}
+
+ColumnStore::ColumnStore(const std::string& path)
+    : m_file(path)
+{
+    const std::string_view data = m_file.data();
+    if (data.size() < COLUMN_STORE_HEADER_SIZE + COLUMN_STORE_TRAILER_SIZE || !is_column_store(data)
+        || !data.ends_with(COLUMN_FOOTER_MAGIC)) {
+        throw std::runtime_error(path + " is not a complete column store");
+    }
+    const std::string_view content = data.substr(0, data.size() - COLUMN_STORE_TRAILER_SIZE);
+    size_t offset = content.size();
+    uint64_t footer_offset = 0;
+    read_value(data, offset, footer_offset);
+
+    const auto damaged = [&]() { return std::runtime_error(path + " has a damaged column store footer"); };
+    offset = footer_offset;
+    uint32_t string_count = 0;
+    if (footer_offset < COLUMN_STORE_HEADER_SIZE || !read_value(content, offset, string_count)) {
+        throw damaged();
+    }
+    for (uint32_t i = 0; i < string_count; ++i) {
+        uint32_t length = 0;
+        if (!read_value(content, offset, length) || offset + length > content.size()) {
+            throw damaged();
+        }
+        m_dictionary.push_back(content.substr(offset, length));
+        offset += length;
+    }
+
+    uint32_t group_count = 0;
+    if (!read_value(content, offset, group_count)) {
+        throw damaged();
+    }
+    for (uint32_t i = 0; i < group_count; ++i) {
+        RowGroup group {};
+        bool is_read = read_value(content, offset, group.rows);
+        for (ColumnChunk& chunk : group.columns) {
+            is_read = is_read && read_value(content, offset, chunk.offset) && read_value(content, offset, chunk.size)
+                && read_value(content, offset, chunk.zone.min) && read_value(content, offset, chunk.zone.max);
+            if (!is_read || chunk.offset < COLUMN_STORE_HEADER_SIZE || chunk.offset + chunk.size > footer_offset
+                || chunk.size < COLUMN_BLOCK_HEADER_SIZE) {
+                throw damaged();
+            }
+        }
+        m_row_groups.push_back(group);
+    }
+}
+
+void ColumnStore::decode(const RowGroup& group, Column column, std::vector<int64_t>& values) const
+{
+    const ColumnChunk& chunk = group.column(column);
+    const std::string_view block = m_file.data().substr(chunk.offset, chunk.size);
+    size_t offset = 0;
+    uint8_t encoding = 0;
+    uint8_t width = 0;
+    uint16_t reserved16 = 0;
+    uint32_t reserved32 = 0;
+    int64_t base = 0;
+    int64_t first = 0;
+    read_value(block, offset, encoding);
+    read_value(block, offset, width);
+    read_value(block, offset, reserved16);
+    read_value(block, offset, reserved32);
+    read_value(block, offset, base);
+    read_value(block, offset, first);
+
+    const size_t word_count = (size_t { group.rows } * width + 63) / 64;
+    if (width > 64 || block.size() < COLUMN_BLOCK_HEADER_SIZE + word_count * sizeof(uint64_t)) {
+        throw std::runtime_error("Damaged column block");
+    }
+    std::vector<uint64_t> words(word_count);
+    std::memcpy(words.data(), block.data() + COLUMN_BLOCK_HEADER_SIZE, word_count * sizeof(uint64_t));
+
+    values.resize(group.rows);
+    const uint64_t mask = width == 64 ? ~uint64_t { 0 } : (uint64_t { 1 } << width) - 1;
+    for (size_t i = 0; i < values.size(); ++i) {
+        uint64_t value = 0;
+        if (width != 0) {
+            const size_t bit = i * width;
+            const size_t shift = bit % 64;
+            value = words[bit / 64] >> shift;
+            if (shift + width > 64) {
+                value |= words[bit / 64 + 1] << (64 - shift);
+            }
+        }
+        values[i] = static_cast<int64_t>((value & mask) + static_cast<uint64_t>(base));
+    }
+
+    if (static_cast<Encoding>(encoding) == Encoding::DELTA && !values.empty()) {
+        values.front() = first;
+        for (size_t i = 1; i < values.size(); ++i) {
+            values[i] = static_cast<int64_t>(static_cast<uint64_t>(values[i - 1]) + static_cast<uint64_t>(values[i]));
+        }
+    }
+}
+
+} // namespace Analysis
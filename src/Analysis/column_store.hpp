@@ -0,0 +1,139 @@
+#pragma once
+
+#include "trace_file.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Analysis {
+
+// Columnar trace store
+//
+//   "TRCCOLMN" version:u32 reserved:u32
+//   row groups, each one block per column in Column order
+//   footer: dictionary string_count:u32, per string length:u32 and its bytes
+//           row_group_count:u32, per row group rows:u32 and per column offset:u64 size:u64 min:i64 max:i64
+//   footer_offset:u64 "TRCCOLIX"
+//
+// A column block is encoding:u8 width:u8 reserved:u16 reserved:u32 base:i64 first:i64, followed by
+// one `width` bit value per row packed into u64 words. FRAME values are base + packed; DELTA values
+// are first, then the previous value plus base + packed. Names and categories share one dictionary
+// and are stored as its codes. Integers are in native byte order.
+
+static constexpr std::string_view COLUMN_STORE_MAGIC { "TRCCOLMN" };
+static constexpr std::string_view COLUMN_FOOTER_MAGIC { "TRCCOLIX" };
+static constexpr uint32_t COLUMN_STORE_VERSION { 1 };
+static constexpr size_t COLUMN_STORE_HEADER_SIZE { 16 };
+static constexpr size_t COLUMN_STORE_TRAILER_SIZE { 16 };
+static constexpr size_t COLUMN_BLOCK_HEADER_SIZE { 24 };
+
+enum class Column : uint8_t {
+    NAME,
+    CAT,
+    PH,
+    TS,
+    DUR,
+    PID,
+    TID,
+};
+
+static constexpr size_t COLUMN_COUNT { 7 };
+
+std::string_view column_name(Column column);
+std::optional<Column> parse_column(std::string_view name);
+
+/// @brief Whether the column holds dictionary codes
+inline bool is_string_column(Column column)
+{
+    return column == Column::NAME || column == Column::CAT;
+}
+
+/// @brief Smallest and largest value of a column in a row group, dictionary codes for strings
+struct ZoneMap {
+    int64_t min;
+    int64_t max;
+};
+
+struct ColumnChunk {
+    uint64_t offset;
+    uint64_t size;
+    ZoneMap zone;
+};
+
+struct RowGroup {
+    uint32_t rows;
+    std::array<ColumnChunk, COLUMN_COUNT> columns;
+
+    const ColumnChunk& column(Column column) const { return columns[static_cast<size_t>(column)]; }
+};
+
+/// @brief Writes a columnar store.
+///
+/// Rows are buffered until a row group is full, then sorted by ts and encoded column by column.
+/// Sorting turns timestamps into small deltas and keeps the zone maps of ts narrow when events
+/// arrive roughly in time order, as they do in the collector. Event arguments are not stored.
+class ColumnStoreWriter {
+public:
+    static constexpr size_t DEFAULT_ROW_GROUP_ROWS { 64 * 1024 };
+
+    explicit ColumnStoreWriter(const std::string& path, size_t row_group_rows = DEFAULT_ROW_GROUP_ROWS);
+
+    void write(std::string_view name, std::string_view cat, char ph, int64_t ts, int64_t dur, int pid, uint64_t tid);
+
+    /// @brief Write the open row group, the dictionary and the footer
+    void close();
+
+    size_t row_group_count() const { return m_row_groups.size(); }
+    uint64_t rows() const { return m_rows; }
+
+private:
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const { return std::hash<std::string_view> {}(value); }
+    };
+
+    int64_t code(std::string_view value);
+    void flush();
+
+    std::ofstream m_out;
+    size_t m_row_group_rows;
+    uint64_t m_offset { COLUMN_STORE_HEADER_SIZE };
+    uint64_t m_rows { 0 };
+
+    std::vector<std::string> m_dictionary;
+    std::unordered_map<std::string, int64_t, StringHash, std::equal_to<>> m_codes;
+
+    std::array<std::vector<int64_t>, COLUMN_COUNT> m_columns;
+    std::vector<RowGroup> m_row_groups;
+};
+
+/// @brief A memory-mapped columnar store. Row groups are decoded one column at a time, so a query
+/// only pays for the columns it uses.
+class ColumnStore {
+public:
+    /// @brief Open a store, throws if the file isn't one or its footer is damaged
+    explicit ColumnStore(const std::string& path);
+
+    /// @brief Whether the data starts like a columnar store
+    static bool is_column_store(std::string_view data) { return data.starts_with(COLUMN_STORE_MAGIC); }
+
+    const std::vector<std::string_view>& dictionary() const { return m_dictionary; }
+    const std::vector<RowGroup>& row_groups() const { return m_row_groups; }
+
+    /// @brief Decode one column of a row group, `values` is resized to the rows of the group
+    void decode(const RowGroup& group, Column column, std::vector<int64_t>& values) const;
+
+private:
+    MappedFile m_file;
+    std::vector<std::string_view> m_dictionary;
+    std::vector<RowGroup> m_row_groups;
+};
+
+} // namespace Analysis
@@ -0,0 +1,206 @@
+#include "hdr_histogram.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+
+namespace Analysis {
+
+HdrHistogram::HdrHistogram(int64_t highest_trackable, int significant_digits)
+    : m_highest_trackable(std::max<int64_t>(highest_trackable, 2))
+{
+    if (significant_digits < 1 || significant_digits > 5) {
+        throw std::invalid_argument("HdrHistogram supports 1 to 5 significant digits");
+    }
+
+    // Enough sub-buckets per power of two to tell apart values 10^-digits apart
+    const auto largest_single_unit = static_cast<int64_t>(2 * std::pow(10, significant_digits));
+    m_sub_bucket_count_magnitude = std::bit_width(static_cast<uint64_t>(largest_single_unit - 1));
+    m_sub_bucket_half_count_magnitude = m_sub_bucket_count_magnitude - 1;
+    m_sub_bucket_count = int64_t { 1 } << m_sub_bucket_count_magnitude;
+    m_sub_bucket_half_count = m_sub_bucket_count / 2;
+    m_sub_bucket_mask = m_sub_bucket_count - 1;
+
+    int64_t smallest_untrackable = m_sub_bucket_count;
+    m_bucket_count = 1;
+    while (smallest_untrackable <= m_highest_trackable) {
+        if (smallest_untrackable > INT64_MAX / 2) {
+            ++m_bucket_count;
+            break;
+        }
+        smallest_untrackable <<= 1;
+        ++m_bucket_count;
+    }
+
+    m_counts_length = static_cast<size_t>((m_bucket_count + 1) * m_sub_bucket_half_count);
+}
+
+int HdrHistogram::bucket_index(int64_t value) const
+{
+    const int pow2_ceiling = std::bit_width(static_cast<uint64_t>(value | m_sub_bucket_mask));
+    return pow2_ceiling - (m_sub_bucket_half_count_magnitude + 1);
+}
+
+int HdrHistogram::sub_bucket_index(int64_t value, int bucket) const
+{
+    return static_cast<int>(value >> bucket);
+}
+
+size_t HdrHistogram::counts_index(int bucket, int sub_bucket) const
+{
+    const int64_t bucket_base = int64_t { bucket + 1 } << m_sub_bucket_half_count_magnitude;
+    return static_cast<size_t>(bucket_base + (sub_bucket - m_sub_bucket_half_count));
+}
+
+int64_t HdrHistogram::value_at_index(size_t index) const
+{
+    int bucket = static_cast<int>(index >> m_sub_bucket_half_count_magnitude) - 1;
+    int64_t sub_bucket = static_cast<int64_t>(index & static_cast<size_t>(m_sub_bucket_half_count - 1)) + m_sub_bucket_half_count;
+    if (bucket < 0) {
+        sub_bucket -= m_sub_bucket_half_count;
+        bucket = 0;
+    }
+    return sub_bucket << bucket;
+}
+
+size_t HdrHistogram::index_of(int64_t tracked) const
+{
+    const int bucket = bucket_index(tracked);
+    return counts_index(bucket, sub_bucket_index(tracked, bucket));
+}
+
+int64_t HdrHistogram::highest_equivalent_value(int64_t value) const
+{
+    const int bucket = bucket_index(value);
+    const int sub_bucket = sub_bucket_index(value, bucket);
+    const int64_t lowest_equivalent = int64_t { sub_bucket } << bucket;
+    const int adjusted_bucket = sub_bucket >= m_sub_bucket_count ? bucket + 1 : bucket;
+    return lowest_equivalent + (int64_t { 1 } << adjusted_bucket) - 1;
+}
+
+void HdrHistogram::record(int64_t value, uint64_t count)
+{
+    value = std::max<int64_t>(value, 0);
+    m_sum += value * static_cast<int64_t>(count);
+    m_total_count += count;
+    m_min = std::min(m_min, value);
+    m_max = std::max(m_max, value);
+
+    add_tracked(std::min(value, m_highest_trackable), count);
+}
+
+void HdrHistogram::add_tracked(int64_t tracked, uint64_t count)
+{
+    // A sample costs as much as a bucket, the counts array is worth it past an eighth of its size
+    if (m_counts.empty() && m_samples.size() + count <= m_counts_length / 8) {
+        m_samples.insert(m_samples.end(), count, tracked);
+        return;
+    }
+    allocate_counts();
+    m_counts[index_of(tracked)] += count;
+}
+
+void HdrHistogram::allocate_counts()
+{
+    if (!m_counts.empty()) {
+        return;
+    }
+    m_counts.assign(m_counts_length, 0);
+    for (const int64_t sample : m_samples) {
+        ++m_counts[index_of(sample)];
+    }
+    m_samples.clear();
+    m_samples.shrink_to_fit();
+}
+
+bool HdrHistogram::is_compatible(const HdrHistogram& other) const
+{
+    return other.m_counts_length == m_counts_length && other.m_sub_bucket_count == m_sub_bucket_count;
+}
+
+void HdrHistogram::merge(const HdrHistogram& other)
+{
+    if (!is_compatible(other)) {
+        throw std::invalid_argument("Merging histograms with different configurations");
+    }
+    if (other.m_counts.empty()) {
+        for (const int64_t sample : other.m_samples) {
+            add_tracked(sample, 1);
+        }
+    } else {
+        allocate_counts();
+        std::transform(m_counts.begin(), m_counts.end(), other.m_counts.begin(), m_counts.begin(), std::plus<> {});
+    }
+    m_total_count += other.m_total_count;
+    m_sum += other.m_sum;
+    if (other.m_total_count != 0) {
+        m_min = std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+    }
+}
+
+void HdrHistogram::reset()
+{
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    m_samples.clear();
+    m_total_count = 0;
+    m_sum = 0;
+    m_min = INT64_MAX;
+    m_max = 0;
+}
+
+double HdrHistogram::mean() const
+{
+    return m_total_count == 0 ? 0.0 : static_cast<double>(m_sum) / static_cast<double>(m_total_count);
+}
+
+int64_t HdrHistogram::value_at_percentile(double percentile) const
+{
+    if (m_total_count == 0) {
+        return 0;
+    }
+    percentile = std::clamp(percentile, 0.0, 100.0);
+    const auto target = std::max<uint64_t>(
+        static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(m_total_count) + 0.5), 1);
+
+    uint64_t seen = 0;
+    for (const auto& [index, count] : bucket_counts()) {
+        seen += count;
+        if (seen >= target) {
+            // The last populated bucket holds the maximum, which may have been clamped
+            return seen == m_total_count ? m_max : std::min(highest_equivalent_value(value_at_index(index)), m_max);
+        }
+    }
+    return m_max;
+}
+
+std::vector<std::pair<size_t, uint64_t>> HdrHistogram::bucket_counts() const
+{
+    std::vector<std::pair<size_t, uint64_t>> buckets;
+    if (!m_counts.empty()) {
+        for (size_t i = 0; i < m_counts.size(); ++i) {
+            if (m_counts[i] != 0) {
+                buckets.emplace_back(i, m_counts[i]);
+            }
+        }
+        return buckets;
+    }
+
+    std::vector<size_t> indexes;
+    indexes.reserve(m_samples.size());
+    for (const int64_t sample : m_samples) {
+        indexes.push_back(index_of(sample));
+    }
+    std::sort(indexes.begin(), indexes.end());
+    for (const size_t index : indexes) {
+        if (buckets.empty() || buckets.back().first != index) {
+            buckets.emplace_back(index, 0);
+        }
+        ++buckets.back().second;
+    }
+    return buckets;
+}
+
+} // namespace Analysis
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Analysis {
+
+/// @brief High dynamic range histogram of non-negative values.
+///
+/// Buckets are log-linear: every power of two is split into enough linear sub-buckets to keep
+/// `significant_digits` decimal digits of precision. The counts array is sized from the
+/// configuration, so memory doesn't depend on how many values are recorded. It takes about 26 KB
+/// by default though, too much for the many keys that see a handful of values: up to an eighth of
+/// that, the values themselves are kept and the counts array is only allocated once they overflow.
+/// Both forms answer the same. Values above the highest trackable value are clamped to it; count,
+/// sum, min and max stay exact.
+class HdrHistogram {
+public:
+    /// @brief One hour in microseconds, the default upper bound for trace durations
+    static constexpr int64_t DEFAULT_HIGHEST_TRACKABLE { 3'600'000'000 };
+
+    explicit HdrHistogram(int64_t highest_trackable = DEFAULT_HIGHEST_TRACKABLE, int significant_digits = 2);
+
+    void record(int64_t value, uint64_t count = 1);
+
+    /// @brief Add the counts of a histogram with the same configuration
+    void merge(const HdrHistogram& other);
+
+    void reset();
+
+    uint64_t count() const { return m_total_count; }
+    int64_t sum() const { return m_sum; }
+    int64_t min() const { return m_total_count == 0 ? 0 : m_min; }
+    int64_t max() const { return m_max; }
+    double mean() const;
+
+    /// @brief Highest value equivalent to the value at the given percentile, 0 to 100
+    int64_t value_at_percentile(double percentile) const;
+
+    size_t memory_size() const { return (m_counts.capacity() + m_samples.capacity()) * sizeof(uint64_t); }
+
+    /// @brief Whether the histogram has the same buckets as `other`
+    bool is_compatible(const HdrHistogram& other) const;
+
+    /// @brief Counts of the populated buckets as (bucket index, count), in ascending value order.
+    /// Histograms with the same configuration share bucket boundaries, so their counts can be
+    /// compared index by index.
+    std::vector<std::pair<size_t, uint64_t>> bucket_counts() const;
+
+private:
+    /// @brief Count a clamped value into its bucket, or into the samples while there's room
+    void add_tracked(int64_t tracked, uint64_t count);
+
+    /// @brief Move the samples into the counts array
+    void allocate_counts();
+
+    size_t index_of(int64_t tracked) const;
+    int bucket_index(int64_t value) const;
+    int sub_bucket_index(int64_t value, int bucket) const;
+    size_t counts_index(int bucket, int sub_bucket) const;
+    int64_t value_at_index(size_t index) const;
+    int64_t highest_equivalent_value(int64_t value) const;
+
+    int64_t m_highest_trackable;
+    int m_sub_bucket_count_magnitude;
+    int m_sub_bucket_half_count_magnitude;
+    int64_t m_sub_bucket_count;
+    int64_t m_sub_bucket_half_count;
+    int64_t m_sub_bucket_mask;
+    int m_bucket_count;
+
+    size_t m_counts_length;
+    std::vector<uint64_t> m_counts;
+
+    /// @var m_samples Clamped values, while the counts array isn't allocated
+    std::vector<int64_t> m_samples;
+
+    uint64_t m_total_count { 0 };
+    int64_t m_sum { 0 };
+    int64_t m_min { INT64_MAX };
+    int64_t m_max { 0 };
+};
+
+} // namespace Analysis
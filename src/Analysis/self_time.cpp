@@ -0,0 +1,29 @@
+#include "self_time.hpp"
+
+#include <algorithm>
+
+namespace Analysis {
+
+int64_t SelfTimeTracker::add(uint64_t thread_key, int64_t ts, int64_t dur)
+{
+    if (m_pending.size() >= MAX_THREADS && !m_pending.contains(thread_key)) {
+        // Threads come and go; forgetting the old ones only costs the adoption of their children
+        m_pending.clear();
+    }
+    std::vector<Interval>& pending = m_pending[thread_key];
+
+    const int64_t end = ts + dur;
+    int64_t children = 0;
+    while (!pending.empty() && pending.back().start >= ts && pending.back().end <= end) {
+        children += pending.back().end - pending.back().start;
+        pending.pop_back();
+    }
+
+    if (pending.size() >= MAX_PENDING) {
+        pending.erase(pending.begin(), pending.begin() + MAX_PENDING / 2);
+    }
+    pending.push_back({ ts, end });
+    return std::max<int64_t>(dur - children, 0);
+}
+
+} // namespace Analysis
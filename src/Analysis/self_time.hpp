@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Analysis {
+
+/// @brief Self time of complete events that arrive in completion order, as the profiler emits them.
+///
+/// A scope is exported when it closes, so its children always arrive before it. Per thread the
+/// tracker keeps the intervals still waiting for a parent. An arriving event adopts the most recent
+/// ones it contains as its direct children. Memory is bounded: only the newest MAX_PENDING intervals
+/// of a thread and MAX_THREADS threads are kept, older ones just stop counting as children.
+class SelfTimeTracker {
+public:
+    static constexpr size_t MAX_PENDING { 1024 };
+    static constexpr size_t MAX_THREADS { 4096 };
+
+    /// @brief Register the event and return its duration minus the duration of its direct children
+    int64_t add(uint64_t thread_key, int64_t ts, int64_t dur);
+
+    static uint64_t thread_key(int pid, size_t tid)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(pid)) << 32) | static_cast<uint32_t>(tid);
+    }
+
+private:
+    struct Interval {
+        int64_t start;
+        int64_t end;
+    };
+
+    std::unordered_map<uint64_t, std::vector<Interval>> m_pending;
+};
+
+} // namespace Analysis
@@ -0,0 +1,46 @@
+#include "significance.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace Analysis {
+
+MannWhitney mann_whitney(const HdrHistogram& a, const HdrHistogram& b)
+{
+    if (!a.is_compatible(b)) {
+        throw std::invalid_argument("Comparing histograms with different configurations");
+    }
+
+    const auto n1 = static_cast<double>(a.count());
+    const auto n2 = static_cast<double>(b.count());
+    if (n1 == 0 || n2 == 0) {
+        return { 0.0, 0.0, 1.0, 0.5 };
+    }
+
+    // Walks the populated buckets of both in value order, empty ones add nothing
+    const auto a_buckets = a.bucket_counts();
+    const auto b_buckets = b.bucket_counts();
+    double u = 0.0;
+    double b_below = 0.0;
+    double ties = 0.0;
+    auto a_bucket = a_buckets.begin();
+    auto b_bucket = b_buckets.begin();
+    while (a_bucket != a_buckets.end() || b_bucket != b_buckets.end()) {
+        const bool is_a = b_bucket == b_buckets.end() || (a_bucket != a_buckets.end() && a_bucket->first <= b_bucket->first);
+        const bool is_b = a_bucket == a_buckets.end() || (b_bucket != b_buckets.end() && b_bucket->first <= a_bucket->first);
+        const double a_count = is_a ? static_cast<double>((a_bucket++)->second) : 0.0;
+        const double b_count = is_b ? static_cast<double>((b_bucket++)->second) : 0.0;
+        u += a_count * (b_below + b_count / 2.0);
+        b_below += b_count;
+        const double tied = a_count + b_count;
+        ties += tied * tied * tied - tied;
+    }
+
+    const double n = n1 + n2;
+    const double mean = n1 * n2 / 2.0;
+    const double variance = n1 * n2 / 12.0 * ((n + 1.0) - ties / (n * (n - 1.0)));
+    const double z = variance > 0.0 ? (u - mean) / std::sqrt(variance) : 0.0;
+    return { u, z, std::erfc(std::abs(z) / std::sqrt(2.0)), u / (n1 * n2) };
+}
+
+} // namespace Analysis
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "hdr_histogram.hpp"
+
+namespace Analysis {
+
+struct MannWhitney {
+    /// @var u Pairs (a, b) with a above b, ties counting half
+    double u;
+    /// @var z Standard score of u under the hypothesis that both samples come from one distribution
+    double z;
+    /// @var p_value Two-sided probability of a difference at least this large by chance
+    double p_value;
+    /// @var superiority Probability that a value of `a` is above one of `b`, 0.5 when alike
+    double superiority;
+};
+
+/// @brief Mann-Whitney U test of two histograms with the same configuration.
+///
+/// Latencies are rarely normal, so the rank test suits them better than comparing means. Values
+/// sharing a bucket count as ties, and the normal approximation is corrected for them.
+MannWhitney mann_whitney(const HdrHistogram& a, const HdrHistogram& b);
+
+} // namespace Analysis
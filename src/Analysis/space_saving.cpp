@@ -0,0 +1,102 @@
+#include "space_saving.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace Analysis {
+
+SpaceSaving::SpaceSaving(size_t capacity)
+    : m_capacity(capacity)
+{
+    if (capacity == 0) {
+        throw std::invalid_argument("SpaceSaving needs at least one counter");
+    }
+    m_heap.reserve(capacity);
+    m_positions.reserve(capacity);
+}
+
+void SpaceSaving::add(std::string_view key, uint64_t weight)
+{
+    if (weight == 0) {
+        return;
+    }
+    m_total += weight;
+
+    if (const auto it = m_positions.find(key); it != m_positions.end()) {
+        const size_t position = it->second;
+        m_heap[position].weight += weight;
+        sift_down(position);
+        return;
+    }
+
+    if (m_heap.size() < m_capacity) {
+        m_heap.push_back({ std::string(key), weight, 0 });
+        m_positions.emplace(key, m_heap.size() - 1);
+        sift_up(m_heap.size() - 1);
+        return;
+    }
+
+    // Take over the lightest counter, its weight becomes the error bound of the new key
+    Counter& lightest = m_heap.front();
+    auto node = m_positions.extract(lightest.key);
+    lightest.key.assign(key);
+    lightest.error = lightest.weight;
+    lightest.weight += weight;
+    node.key() = lightest.key;
+    m_positions.insert(std::move(node));
+    sift_down(0);
+}
+
+std::vector<SpaceSaving::Counter> SpaceSaving::top(size_t k) const
+{
+    std::vector<Counter> counters = m_heap;
+    const auto heavier = [](const Counter& lhs, const Counter& rhs) {
+        return lhs.weight != rhs.weight ? lhs.weight > rhs.weight : lhs.key < rhs.key;
+    };
+    k = std::min(k, counters.size());
+    std::partial_sort(counters.begin(), counters.begin() + static_cast<std::ptrdiff_t>(k), counters.end(), heavier);
+    counters.resize(k);
+    return counters;
+}
+
+void SpaceSaving::sift_up(size_t position)
+{
+    while (position > 0) {
+        const size_t parent = (position - 1) / 2;
+        if (m_heap[parent].weight <= m_heap[position].weight) {
+            return;
+        }
+        swap_counters(parent, position);
+        position = parent;
+    }
+}
+
+void SpaceSaving::sift_down(size_t position)
+{
+    for (;;) {
+        const size_t left = 2 * position + 1;
+        const size_t right = left + 1;
+        size_t lightest = position;
+        if (left < m_heap.size() && m_heap[left].weight < m_heap[lightest].weight) {
+            lightest = left;
+        }
+        if (right < m_heap.size() && m_heap[right].weight < m_heap[lightest].weight) {
+            lightest = right;
+        }
+        if (lightest == position) {
+            return;
+        }
+        swap_counters(lightest, position);
+        position = lightest;
+    }
+}
+
+void SpaceSaving::swap_counters(size_t a, size_t b)
+{
+    std::swap(m_heap[a], m_heap[b]);
+    m_positions.find(m_heap[a].key)->second = a;
+    m_positions.find(m_heap[b].key)->second = b;
+}
+
+} // namespace Analysis
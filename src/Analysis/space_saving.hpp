@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Analysis {
+
+/// @brief Weighted Space-Saving sketch of the heaviest keys of a stream.
+///
+/// At most `capacity` counters are kept. A key that isn't monitored takes over the lightest
+/// counter and inherits its weight as overestimation error. Any key heavier than total / capacity
+/// is guaranteed to be monitored, and every reported weight is at most `error` above the true one.
+/// The counters form a min-heap, so an update costs O(log capacity).
+class SpaceSaving {
+public:
+    struct Counter {
+        std::string key;
+        uint64_t weight;
+        uint64_t error;
+    };
+
+    explicit SpaceSaving(size_t capacity);
+
+    void add(std::string_view key, uint64_t weight = 1);
+
+    /// @brief The `k` heaviest counters, heaviest first
+    std::vector<Counter> top(size_t k) const;
+
+    size_t capacity() const { return m_capacity; }
+    uint64_t total() const { return m_total; }
+
+private:
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view key) const { return std::hash<std::string_view> {}(key); }
+    };
+
+    void sift_up(size_t position);
+    void sift_down(size_t position);
+    void swap_counters(size_t a, size_t b);
+
+    size_t m_capacity;
+    uint64_t m_total { 0 };
+    std::vector<Counter> m_heap;
+    std::unordered_map<std::string, size_t, StringHash, std::equal_to<>> m_positions;
+};
+
+} // namespace Analysis
@@ -0,0 +1,339 @@
+#include <Analysis/chunk_store.hpp>
+#include <Analysis/column_query.hpp>
+#include <Analysis/hdr_histogram.hpp>
+#include <Analysis/self_time.hpp>
+#include <Analysis/significance.hpp>
+#include <Analysis/space_saving.hpp>
+#include <Analysis/trace_stats.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <initializer_list>
+#include <print>
+#include <string>
+
+bool is_close(int64_t value, int64_t expected)
+{
+    // Two significant digits
+    return std::abs(static_cast<double>(value - expected)) <= static_cast<double>(expected) * 0.01 + 1;
+}
+
+bool test_histogram()
+{
+    Analysis::HdrHistogram histogram;
+    for (int64_t value = 1; value <= 100000; ++value) {
+        histogram.record(value);
+    }
+    if (histogram.count() != 100000 || histogram.min() != 1 || histogram.max() != 100000) {
+        std::println(stderr, "Wrong count, min or max");
+        return false;
+    }
+    if (histogram.sum() != int64_t { 100000 } * 100001 / 2) {
+        std::println(stderr, "Wrong sum {}", histogram.sum());
+        return false;
+    }
+    for (const auto& [percentile, expected] : { std::pair { 50.0, 50000 }, { 90.0, 90000 }, { 99.0, 99000 }, { 99.9, 99900 } }) {
+        const int64_t value = histogram.value_at_percentile(percentile);
+        if (!is_close(value, expected)) {
+            std::println(stderr, "p{} is {}, expected about {}", percentile, value, expected);
+            return false;
+        }
+    }
+
+    // Outliers past the trackable range are clamped, but still counted exactly
+    Analysis::HdrHistogram other;
+    other.record(Analysis::HdrHistogram::DEFAULT_HIGHEST_TRACKABLE * 2);
+    histogram.merge(other);
+    if (histogram.count() != 100001 || histogram.value_at_percentile(100.0) != histogram.max()) {
+        std::println(stderr, "Merge lost the outlier");
+        return false;
+    }
+
+    // A few values are kept as they are, and answer like the counts array they move into later
+    Analysis::HdrHistogram small;
+    Analysis::HdrHistogram large;
+    for (int64_t value = 1; value <= 50; ++value) {
+        small.record(value * 1000);
+        large.record(value * 1000);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        large.record(50'000);
+    }
+    if (small.memory_size() >= 1024 || large.memory_size() < 16 * 1024) {
+        std::println(stderr, "Histograms take {} and {} bytes", small.memory_size(), large.memory_size());
+        return false;
+    }
+    Analysis::HdrHistogram merged;
+    merged.merge(small);
+    merged.merge(large);
+    if (small.value_at_percentile(50.0) != 25'087 || large.value_at_percentile(1.0) != 11'007
+        || merged.count() != 1100 || merged.value_at_percentile(1.0) != 6'015) {
+        std::println(stderr, "Sparse percentiles {} {} {}", small.value_at_percentile(50.0), large.value_at_percentile(1.0), merged.value_at_percentile(1.0));
+        return false;
+    }
+    return true;
+}
+
+bool test_self_time()
+{
+    // parent [0, 100) with children [10, 30) and [40, 90), the latter with a child [50, 60)
+    Analysis::SelfTimeTracker tracker;
+    const uint64_t thread = Analysis::SelfTimeTracker::thread_key(1, 1);
+    const int64_t first = tracker.add(thread, 10, 20);
+    const int64_t grandchild = tracker.add(thread, 50, 10);
+    const int64_t second = tracker.add(thread, 40, 50);
+    const int64_t parent = tracker.add(thread, 0, 100);
+    if (first != 20 || grandchild != 10 || second != 40 || parent != 30) {
+        std::println(stderr, "Wrong self times {} {} {} {}", first, grandchild, second, parent);
+        return false;
+    }
+
+    // Other threads don't adopt each other's events
+    tracker.add(Analysis::SelfTimeTracker::thread_key(1, 2), 200, 10);
+    if (tracker.add(thread, 150, 100) != 100) {
+        std::println(stderr, "Adopted an event of another thread");
+        return false;
+    }
+    return true;
+}
+
+bool test_space_saving()
+{
+    // Three heavy keys hidden in a long tail of unique ones
+    Analysis::SpaceSaving sketch(16);
+    for (int i = 0; i < 10000; ++i) {
+        sketch.add("request_" + std::to_string(i));
+        if (i % 10 == 0) {
+            sketch.add("hot", 3);
+            sketch.add("warm", 2);
+            sketch.add("mild");
+        }
+    }
+    const auto top = sketch.top(3);
+    if (top.size() != 3 || top[0].key != "hot" || top[1].key != "warm" || top[2].key != "mild") {
+        std::println(stderr, "Heavy hitters not found");
+        return false;
+    }
+    // Reported weights overestimate by at most the error, which is bounded by total / capacity
+    for (const auto& [counter, exact] : { std::pair { top[0], 3000ULL }, { top[1], 2000ULL }, { top[2], 1000ULL } }) {
+        if (counter.weight < exact || counter.weight - counter.error > exact || counter.error > sketch.total() / sketch.capacity()) {
+            std::println(stderr, "Error bound exceeded for {}", counter.key);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool test_trace_stats()
+{
+    // Children are written before their parents, a truncated event swallows the line after it
+    const char* path = "/tmp/analysis_test_trace.json";
+    std::ofstream(path) << R"({"traceEvents":[
+{"name":"leaf","cat":"test","ph":"X","ts":110,"pid":1,"tid":1,"dur":20},
+{"name":"leaf","cat":"test","ph":"X","ts":150,"pid":1,"tid":1,"dur":10},
+{"name":"middle","cat":"test","ph":"X","ts":140,"pid":1,"tid":1,"dur":50},
+{"name":"root","cat":"test","ph":"X","ts":100,"pid":1,"tid":1,"dur":100},
+{"name":"leaf","cat":"test","ph":"X","ts":105,"pid":1,"tid":2,"dur":30,"args":{"nested":{"a":[1,"}"]}}},
+{"name":"marker","cat":"test","ph":"i","ts":120,"pid":1,"tid":1},
+{"name":"broken","cat":"test","ph":"X","ts":
+{"name":"root","cat":"test","ph":"X","ts":300,"pid":1,"tid":1,"dur":50}
+],"displayTimeUnit":"ns"})";
+
+    for (size_t threads : { 1, 3 }) {
+        const Analysis::TraceStats stats = Analysis::compute_stats(Analysis::TraceFile(path), threads);
+        if (stats.events != 7 || stats.complete_events != 6 || stats.malformed_events != 1 || stats.scopes.size() != 3) {
+            std::println(stderr, "Wrong event counts with {} threads", threads);
+            return false;
+        }
+        for (const auto& scope : stats.scopes) {
+            const auto [count, self_time] = scope.name == "root" ? std::pair { 2U, 80 }
+                : scope.name == "middle"                         ? std::pair { 1U, 40 }
+                                                                 : std::pair { 3U, 60 };
+            if (scope.histogram.count() != count || scope.self_time != self_time) {
+                std::println(stderr, "{}: count {} self {} with {} threads", scope.name, scope.histogram.count(), scope.self_time, threads);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool test_chunk_store()
+{
+    // Ten ordered events per thread, chunks of about three events, one late event
+    const char* path = "/tmp/analysis_test_store.trc";
+    Analysis::ChunkStoreWriter writer(path, 200);
+    for (int64_t ts = 0; ts < 100; ts += 10) {
+        for (const size_t tid : { 1, 2 }) {
+            const std::string json = std::format(R"({{"name":"step","cat":"test","ph":"X","ts":{},"pid":1,"tid":{},"dur":5}})", ts, tid);
+            writer.write(ts, ts + 5, Analysis::SelfTimeTracker::thread_key(1, tid), json);
+        }
+    }
+    writer.write_late(0, 100, Analysis::SelfTimeTracker::thread_key(1, 1), R"({"name":"root","cat":"test","ph":"X","ts":0,"pid":1,"tid":1,"dur":100})");
+    writer.close();
+
+    const Analysis::TraceFile file(path);
+    if (file.format() != Analysis::TraceFormat::CHUNKED || file.chunks().size() < 4) {
+        std::println(stderr, "Store index not found");
+        return false;
+    }
+    const Analysis::TraceStats stats = Analysis::compute_stats(file, 2);
+    if (stats.complete_events != 21 || stats.malformed_events != 0) {
+        std::println(stderr, "Store holds {} events, expected 21", stats.complete_events);
+        return false;
+    }
+
+    // A window in the middle reads its chunk and the late chunk of the long event, not all of them
+    size_t overlapping = 0;
+    for (const auto& chunk : file.chunks()) {
+        overlapping += chunk.overlaps(52, 58) ? 1 : 0;
+    }
+    if (overlapping == 0 || overlapping >= file.chunks().size() - 1) {
+        std::println(stderr, "{} of {} chunks overlap a narrow window", overlapping, file.chunks().size());
+        return false;
+    }
+
+    // A thread count beyond the end of the index is rejected, not allocated
+    std::ifstream in(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    uint64_t index_offset = 0;
+    std::memcpy(&index_offset, data.data() + data.size() - Analysis::STORE_TRAILER_SIZE, sizeof(index_offset));
+    const uint32_t thread_count = UINT32_MAX;
+    std::memcpy(data.data() + index_offset + 36, &thread_count, sizeof(thread_count));
+    if (Analysis::read_chunk_index(data)) {
+        std::println(stderr, "Corrupt thread count accepted");
+        return false;
+    }
+    return true;
+}
+
+bool test_column_store()
+{
+    // Row groups of 100 rows: "read" takes 10 us in category io, "parse" 1000 + ts % 7 us in cpu
+    const char* path = "/tmp/analysis_test_store.cols";
+    Analysis::ColumnStoreWriter writer(path, 100);
+    for (int64_t ts = 0; ts < 1000; ++ts) {
+        const bool is_read = ts % 4 == 0;
+        writer.write(is_read ? "read" : "parse", is_read ? "io" : "cpu", 'X', 1'700'000'000'000'000 + ts * 50,
+            is_read ? 10 : 1000 + ts % 7, 42, 0x7f00'0000'0000ULL + static_cast<uint64_t>(ts % 3));
+    }
+    writer.close();
+
+    const Analysis::ColumnStore store(path);
+    if (store.row_groups().size() != 10 || store.dictionary().size() != 4) {
+        std::println(stderr, "{} row groups, {} strings", store.row_groups().size(), store.dictionary().size());
+        return false;
+    }
+    std::vector<int64_t> values;
+    store.decode(store.row_groups()[3], Analysis::Column::TS, values);
+    if (values.size() != 100 || values[0] != 1'700'000'000'000'000 + 300 * 50 || values[99] != 1'700'000'000'000'000 + 399 * 50) {
+        std::println(stderr, "Timestamps decoded wrong");
+        return false;
+    }
+    store.decode(store.row_groups()[3], Analysis::Column::TID, values);
+    if (values[1] != static_cast<int64_t>(0x7f00'0000'0000ULL + 301 % 3)) {
+        std::println(stderr, "Thread ids decoded wrong");
+        return false;
+    }
+
+    for (const size_t threads : { 1, 3 }) {
+        const Analysis::QueryResult result = Analysis::run_query(store, {
+            { *Analysis::parse_predicate("cat=cpu"), *Analysis::parse_predicate("dur>=1003") },
+            { Analysis::Column::NAME },
+            threads,
+        });
+        // ts % 7 >= 3 for the parse rows
+        uint64_t expected = 0;
+        for (int64_t ts = 0; ts < 1000; ++ts) {
+            expected += ts % 4 != 0 && ts % 7 >= 3 ? 1 : 0;
+        }
+        if (result.groups.size() != 1 || result.rows_matched != expected || result.groups.front().dur.count() != expected
+            || store.dictionary()[static_cast<size_t>(result.groups.front().key.front())] != "parse") {
+            std::println(stderr, "Wrong query result with {} threads", threads);
+            return false;
+        }
+    }
+
+    // Zone maps skip the row groups outside the time range
+    const Analysis::QueryResult window = Analysis::run_query(store, {
+        { *Analysis::parse_predicate("ts<1700000000000000"), *Analysis::parse_predicate("name~ea") }, {}, 2 });
+    if (window.row_groups_skipped != 10 || window.rows_matched != 0) {
+        std::println(stderr, "{} row groups skipped", window.row_groups_skipped);
+        return false;
+    }
+    return !Analysis::parse_predicate("dur~1") && !Analysis::parse_predicate("name<a") && !Analysis::parse_predicate("size=1");
+}
+
+bool test_mann_whitney()
+{
+    const auto histogram_of = [](std::initializer_list<int64_t> values) {
+        Analysis::HdrHistogram histogram;
+        for (const int64_t value : values) {
+            histogram.record(value);
+        }
+        return histogram;
+    };
+    const auto is_near = [](double value, double expected) { return std::abs(value - expected) < 1e-6; };
+
+    // Every value of a below every one of b: U = 0, z = -4.5 / sqrt(5.25)
+    const auto apart = Analysis::mann_whitney(histogram_of({ 1, 2, 3 }), histogram_of({ 4, 5, 6 }));
+    if (apart.u != 0.0 || !is_near(apart.z, -1.963961) || !is_near(apart.p_value, 0.049535) || apart.superiority != 0.0) {
+        std::println(stderr, "Wrong test of separate samples: U {} z {} p {}", apart.u, apart.z, apart.p_value);
+        return false;
+    }
+    // Three ties of 2 and three of 3 count half: U = 3, the variance shrinks by 16/12 * 48/56
+    const auto tied = Analysis::mann_whitney(histogram_of({ 1, 2, 2, 3 }), histogram_of({ 2, 3, 3, 4 }));
+    if (tied.u != 3.0 || !is_near(tied.z, -1.517442) || !is_near(tied.p_value, 0.129155) || tied.superiority != 3.0 / 16.0) {
+        std::println(stderr, "Wrong test of tied samples: U {} z {} p {}", tied.u, tied.z, tied.p_value);
+        return false;
+    }
+    // Dense histograms of one distribution don't differ
+    Analysis::HdrHistogram first;
+    Analysis::HdrHistogram second;
+    for (int64_t value = 1; value <= 20000; ++value) {
+        first.record(value);
+        second.record(value);
+    }
+    const auto same = Analysis::mann_whitney(first, second);
+    if (same.u != 2e8 || same.z != 0.0 || same.p_value != 1.0 || same.superiority != 0.5) {
+        std::println(stderr, "Wrong test of equal samples: U {} p {}", same.u, same.p_value);
+        return false;
+    }
+    return true;
+}
+
+int main(int /* argc */, char* /* argv */[])
+{
+    std::println("1. Testing HDR histogram...");
+    if (!test_histogram()) {
+        return 1;
+    }
+    std::println("2. Testing self time...");
+    if (!test_self_time()) {
+        return 1;
+    }
+    std::println("3. Testing Space-Saving sketch...");
+    if (!test_space_saving()) {
+        return 1;
+    }
+    std::println("4. Testing trace statistics...");
+    if (!test_trace_stats()) {
+        return 1;
+    }
+    std::println("5. Testing chunk store...");
+    if (!test_chunk_store()) {
+        return 1;
+    }
+    std::println("6. Testing column store...");
+    if (!test_column_store()) {
+        return 1;
+    }
+    std::println("7. Testing Mann-Whitney U...");
+    if (!test_mann_whitney()) {
+        return 1;
+    }
+    std::println("\nAnalysis test complete.");
+    return 0;
+}
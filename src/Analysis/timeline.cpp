@@ -0,0 +1,118 @@
+#include "timeline.hpp"
+#include "self_time.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+
+namespace Analysis {
+
+namespace {
+    struct ScopeKeyHash {
+        size_t operator()(const ScopeKey& key) const
+        {
+            return std::hash<std::string_view> {}(key.name) ^ (std::hash<std::string_view> {}(key.cat) * 31);
+        }
+    };
+
+    struct ScopeKeyEqual {
+        bool operator()(const ScopeKey& lhs, const ScopeKey& rhs) const { return lhs.name == rhs.name && lhs.cat == rhs.cat; }
+    };
+
+    using KeyIndex = std::unordered_map<ScopeKey, uint32_t, ScopeKeyHash, ScopeKeyEqual>;
+
+    /// @brief Complete events of a range, grouped per thread. Keys index the range's own table.
+    struct DecodedRange {
+        std::vector<ScopeKey> keys;
+        KeyIndex key_index;
+        std::unordered_map<uint64_t, std::vector<Span>> threads;
+        uint64_t events { 0 };
+        uint64_t malformed { 0 };
+    };
+
+    void decode(const TraceFile& file, std::string_view range, DecodedRange& decoded)
+    {
+        EventCursor cursor(file.format(), range);
+        EventView event {};
+        while (cursor.next(event)) {
+            ++decoded.events;
+            if (event.ph != 'X') {
+                continue;
+            }
+            const auto [it, is_new] = decoded.key_index.try_emplace({ event.name, event.cat }, static_cast<uint32_t>(decoded.keys.size()));
+            if (is_new) {
+                decoded.keys.push_back(it->first);
+            }
+            decoded.threads[SelfTimeTracker::thread_key(event.pid, event.tid)].push_back({ event.ts, event.dur, it->second });
+        }
+        decoded.malformed = cursor.malformed();
+    }
+} // namespace
+
+void parallel_for(size_t count, size_t threads, const std::function<void(size_t, size_t)>& work)
+{
+    std::atomic<size_t> next { 0 };
+    const auto worker = [&](size_t worker_index) {
+        for (size_t index = next++; index < count; index = next++) {
+            work(worker_index, index);
+        }
+    };
+    std::vector<std::jthread> pool;
+    for (size_t i = 1; i < std::min(threads, count); ++i) {
+        pool.emplace_back(worker, i);
+    }
+    worker(0);
+}
+
+Timelines build_timelines(const TraceFile& file, size_t threads)
+{
+    threads = std::max<size_t>(threads, 1);
+
+    // Several ranges per thread even out the work when events are unevenly spread
+    const std::vector<std::string_view> ranges = file.partition(threads * 4);
+    std::vector<DecodedRange> decoded(ranges.size());
+    parallel_for(ranges.size(), threads, [&](size_t /* worker */, size_t index) { decode(file, ranges[index], decoded[index]); });
+
+    Timelines timelines {};
+    KeyIndex key_index;
+    std::unordered_map<uint64_t, std::vector<Span>> thread_spans;
+    for (DecodedRange& range : decoded) {
+        timelines.events += range.events;
+        timelines.malformed_events += range.malformed;
+
+        std::vector<uint32_t> remap(range.keys.size());
+        for (size_t local = 0; local < range.keys.size(); ++local) {
+            const auto [it, is_new] = key_index.try_emplace(range.keys[local], static_cast<uint32_t>(timelines.keys.size()));
+            if (is_new) {
+                timelines.keys.push_back(range.keys[local]);
+            }
+            remap[local] = it->second;
+        }
+        for (auto& [thread, spans] : range.threads) {
+            std::vector<Span>& merged = thread_spans[thread];
+            merged.reserve(merged.size() + spans.size());
+            for (const Span& span : spans) {
+                merged.push_back({ span.ts, span.dur, remap[span.key] });
+            }
+            timelines.complete_events += spans.size();
+            std::vector<Span> {}.swap(spans);
+        }
+    }
+    std::vector<DecodedRange> {}.swap(decoded);
+
+    timelines.threads.reserve(thread_spans.size());
+    for (auto& [thread, spans] : thread_spans) {
+        timelines.threads.emplace_back(thread, std::move(spans));
+    }
+    // Largest threads first, so a big one doesn't end up alone at the end of a parallel_for
+    std::ranges::sort(timelines.threads, [](const auto& lhs, const auto& rhs) { return lhs.second.size() > rhs.second.size(); });
+    parallel_for(timelines.threads.size(), threads, [&](size_t /* worker */, size_t index) {
+        std::ranges::sort(timelines.threads[index].second, [](const Span& lhs, const Span& rhs) {
+            return lhs.ts != rhs.ts ? lhs.ts < rhs.ts : lhs.dur > rhs.dur;
+        });
+    });
+    return timelines;
+}
+
+} // namespace Analysis
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "trace_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Analysis {
+
+/// @brief A complete event on a thread's timeline. Key indexes Timelines::keys.
+struct Span {
+    int64_t ts;
+    int64_t dur;
+    uint32_t key;
+};
+
+struct ScopeKey {
+    std::string_view name;
+    std::string_view cat;
+};
+
+/// @brief The complete events of a trace, per thread. Strings point into the trace file.
+struct Timelines {
+    std::vector<ScopeKey> keys;
+
+    /// @var threads SelfTimeTracker::thread_key and spans sorted by start, longest first on ties so
+    /// parents come before their children. Threads with the most spans come first.
+    std::vector<std::pair<uint64_t, std::vector<Span>>> threads;
+
+    uint64_t events;
+    uint64_t complete_events;
+    uint64_t malformed_events;
+};
+
+/// @brief Decode the file on up to `threads` threads and sort every thread's complete events
+Timelines build_timelines(const TraceFile& file, size_t threads);
+
+/// @brief Run `work(worker, index)` for every index below `count` on up to `threads` workers.
+/// Workers are numbered from 0, so they can keep partial results without locking.
+void parallel_for(size_t count, size_t threads, const std::function<void(size_t worker, size_t index)>& work);
+
+/// @brief Walk sorted spans keeping the stack of enclosing ones.
+///
+/// `visit(span, stack)` gets the spans that contain `span`, outermost first. Spans that only
+/// overlap the open one are treated as its siblings.
+template <class Visitor>
+void walk_nesting(const std::vector<Span>& spans, Visitor&& visit)
+{
+    std::vector<const Span*> stack;
+    for (const Span& span : spans) {
+        const int64_t end = span.ts + span.dur;
+        while (!stack.empty() && stack.back()->ts + stack.back()->dur < end) {
+            stack.pop_back();
+        }
+        visit(span, stack);
+        stack.push_back(&span);
+    }
+}
+
+} // namespace Analysis
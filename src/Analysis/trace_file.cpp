@@ -0,0 +1,327 @@
+#include "trace_file.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Analysis {
+
+MappedFile::MappedFile(const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open " + path + ": " + std::strerror(errno));
+    }
+    struct stat status {};
+    if (::fstat(fd, &status) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat " + path);
+    }
+    m_size = static_cast<size_t>(status.st_size);
+    if (m_size != 0) {
+        void* mapping = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Failed to map " + path);
+        }
+        ::madvise(mapping, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const char*>(mapping);
+    }
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data != nullptr) {
+        ::munmap(const_cast<char*>(m_data), m_size);
+    }
+}
+
+namespace {
+    bool is_space(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    const char* skip_space(const char* p, const char* end)
+    {
+        while (p != end && is_space(*p)) {
+            ++p;
+        }
+        return p;
+    }
+
+    /// @brief Position after the closing quote of the string starting at p, or nullptr
+    const char* skip_string(const char* p, const char* end)
+    {
+        for (++p; p != end; ++p) {
+            if (*p == '\\') {
+                if (++p == end) {
+                    return nullptr;
+                }
+            } else if (*p == '"') {
+                return p + 1;
+            }
+        }
+        return nullptr;
+    }
+
+    /// @brief Position after the object or array starting at p, or nullptr
+    const char* skip_nested(const char* p, const char* end)
+    {
+        int depth = 0;
+        while (p != end) {
+            switch (*p) {
+            case '"':
+                p = skip_string(p, end);
+                if (p == nullptr) {
+                    return nullptr;
+                }
+                continue;
+            case '{':
+            case '[':
+                ++depth;
+                break;
+            case '}':
+            case ']':
+                if (--depth == 0) {
+                    return p + 1;
+                }
+                break;
+            default:
+                break;
+            }
+            ++p;
+        }
+        return nullptr;
+    }
+
+    /// @brief Integer value of a JSON number or of a string holding one, "0x" prefixed ones in hex.
+    /// Fractional numbers are truncated.
+    int64_t to_integer(std::string_view value)
+    {
+        if (value.size() >= 2 && value.front() == '"') {
+            value = value.substr(1, value.size() - 2);
+        }
+        int base = 10;
+        if (value.starts_with("0x") || value.starts_with("0X")) {
+            value.remove_prefix(2);
+            base = 16;
+        }
+        uint64_t integer = 0;
+        const char* last = value.data() + value.size();
+        const bool is_negative = base == 10 && value.starts_with('-');
+        const auto [end, error] = std::from_chars(value.data() + (is_negative ? 1 : 0), last, integer, base);
+        if (error != std::errc {}) {
+            return 0;
+        }
+        if (end != last && (*end == '.' || *end == 'e' || *end == 'E')) {
+            double real = 0.0;
+            std::from_chars(value.data(), last, real);
+            return static_cast<int64_t>(real);
+        }
+        return is_negative ? -static_cast<int64_t>(integer) : static_cast<int64_t>(integer);
+    }
+
+    std::string_view unquote(std::string_view value)
+    {
+        return value.size() >= 2 && value.front() == '"' ? value.substr(1, value.size() - 2) : value;
+    }
+} // namespace
+
+TraceFile::TraceFile(const std::string& path)
+    : m_file(path)
+    , m_format(TraceFormat::JSON)
+{
+    const std::string_view data = m_file.data();
+    if (data.starts_with(STORE_MAGIC)) {
+        // Chunks are stored back to back, and a store without index is read as one run of events
+        m_format = TraceFormat::CHUNKED;
+        auto chunks = read_chunk_index(data);
+        const size_t events_end = chunks && !chunks->empty() ? chunks->back().offset + chunks->back().size : data.size();
+        m_events = data.substr(std::min(STORE_HEADER_SIZE, data.size()), events_end - std::min(STORE_HEADER_SIZE, events_end));
+        if (chunks) {
+            m_chunks = std::move(*chunks);
+            m_events = m_chunks.empty() ? std::string_view {} : m_events;
+        }
+        return;
+    }
+
+    const char* begin = skip_space(data.data(), data.data() + data.size());
+    const char* end = data.data() + data.size();
+    if (begin == end || (*begin != '{' && *begin != '[')) {
+        throw std::runtime_error("Unrecognized trace format: " + path);
+    }
+
+    // Either the object form, {"traceEvents":[...], ...}, or a bare array of events
+    const char* events = begin;
+    if (*begin == '{') {
+        const size_t key = data.find(R"("traceEvents")");
+        const size_t array = key == std::string_view::npos ? key : data.find('[', key);
+        if (array == std::string_view::npos) {
+            throw std::runtime_error("No traceEvents array in " + path);
+        }
+        events = data.data() + array;
+    }
+    m_events = { events + 1, static_cast<size_t>(end - events - 1) };
+}
+
+std::vector<std::string_view> TraceFile::partition(size_t parts) const
+{
+    if (!m_chunks.empty()) {
+        // Whole chunks, neighbours grouped until a range holds its share of the events
+        std::vector<std::string_view> ranges;
+        const uint64_t share = m_events.size() / std::max<size_t>(parts, 1) + 1;
+        const std::string_view data = m_file.data();
+        uint64_t begin = m_chunks.front().offset;
+        for (const ChunkInfo& chunk : m_chunks) {
+            const uint64_t end = chunk.offset + chunk.size;
+            if (end - begin >= share || &chunk == &m_chunks.back()) {
+                ranges.push_back(data.substr(begin, end - begin));
+                begin = end;
+            }
+        }
+        return ranges;
+    }
+
+    // FileExporter writes one event per line, so ranges are cut where a line starts an object.
+    // Files without such lines end up in a single range.
+    std::vector<std::string_view> ranges;
+    parts = std::max<size_t>(parts, 1);
+    size_t begin = 0;
+    for (size_t part = 1; part <= parts && begin < m_events.size(); ++part) {
+        size_t cut = m_events.size();
+        if (part < parts) {
+            const size_t target = std::max(begin + 1, m_events.size() / parts * part);
+            const size_t line = m_events.find("\n{", target);
+            cut = line == std::string_view::npos ? m_events.size() : line + 1;
+        }
+        ranges.push_back(m_events.substr(begin, cut - begin));
+        begin = cut;
+    }
+    return ranges;
+}
+
+EventCursor::EventCursor(TraceFormat format, std::string_view range)
+    : m_format(format)
+    , m_position(range.data())
+    , m_end(range.data() + range.size())
+{
+}
+
+bool EventCursor::next(EventView& event)
+{
+    switch (m_format) {
+    case TraceFormat::JSON:
+    case TraceFormat::CHUNKED:
+        // Chunks hold one JSON event per line
+        return next_json(event);
+    }
+    return false;
+}
+
+bool EventCursor::next_json(EventView& event)
+{
+    while (true) {
+        const char* p = m_position;
+        while (p != m_end && (is_space(*p) || *p == ',')) {
+            ++p;
+        }
+        if (p == m_end || *p == ']') {
+            m_position = m_end;
+            return false;
+        }
+
+        const char* begin = p;
+        event = {};
+        bool is_valid = *p == '{';
+        for (++p; is_valid;) {
+            p = skip_space(p, m_end);
+            if (p != m_end && *p == '}') {
+                ++p;
+                break;
+            }
+            if (p == m_end || *p != '"') {
+                is_valid = false;
+                break;
+            }
+            const char* key_end = skip_string(p, m_end);
+            if (key_end == nullptr) {
+                is_valid = false;
+                break;
+            }
+            const std::string_view key { p + 1, static_cast<size_t>(key_end - p - 2) };
+            p = skip_space(key_end, m_end);
+            if (p == m_end || *p != ':') {
+                is_valid = false;
+                break;
+            }
+            p = skip_space(p + 1, m_end);
+
+            const char* value_end = nullptr;
+            if (p == m_end) {
+                is_valid = false;
+                break;
+            } else if (*p == '"') {
+                value_end = skip_string(p, m_end);
+            } else if (*p == '{' || *p == '[') {
+                value_end = skip_nested(p, m_end);
+            } else {
+                value_end = p;
+                while (value_end != m_end && *value_end != ',' && *value_end != '}' && !is_space(*value_end)) {
+                    ++value_end;
+                }
+            }
+            if (value_end == nullptr) {
+                is_valid = false;
+                break;
+            }
+            const std::string_view value { p, static_cast<size_t>(value_end - p) };
+            p = skip_space(value_end, m_end);
+            if (p != m_end && *p == ',') {
+                ++p;
+            }
+
+            if (key == "name") {
+                event.name = unquote(value);
+            } else if (key == "cat") {
+                event.cat = unquote(value);
+            } else if (key == "ph") {
+                const std::string_view ph = unquote(value);
+                event.ph = ph.empty() ? '\0' : ph.front();
+            } else if (key == "ts") {
+                event.ts = to_integer(value);
+            } else if (key == "dur") {
+                event.dur = to_integer(value);
+            } else if (key == "pid") {
+                event.pid = static_cast<int>(to_integer(value));
+            } else if (key == "tid") {
+                event.tid = static_cast<uint64_t>(to_integer(value));
+            } else if (key == "id") {
+                event.id = static_cast<uint64_t>(to_integer(value));
+            } else if (key == "args") {
+                event.args = value;
+            }
+        }
+
+        if (is_valid) {
+            event.raw = { begin, static_cast<size_t>(p - begin) };
+            m_position = p;
+            return true;
+        }
+
+        // Resynchronize on the line after the start of the event, where FileExporter starts the next
+        // one. A truncated event may have swallowed it as a value.
+        ++m_malformed;
+        m_position = std::find(begin, m_end, '\n');
+    }
+}
+
+} // namespace Analysis
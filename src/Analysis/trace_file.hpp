@@ -0,0 +1,100 @@
+#pragma once
+
+#include "chunk_store.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Analysis {
+
+/// @brief Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view data() const { return { m_data, m_size }; }
+
+private:
+    const char* m_data { nullptr };
+    size_t m_size { 0 };
+};
+
+/// @brief A decoded event. Strings point into the trace file and are not unescaped.
+struct EventView {
+    std::string_view name;
+    std::string_view cat;
+    char ph;
+    int64_t ts;
+    int64_t dur;
+    int pid;
+    uint64_t tid;
+    uint64_t id;
+
+    /// @var args Raw JSON text of the args object, empty without arguments
+    std::string_view args;
+
+    /// @var raw JSON text of the whole event
+    std::string_view raw;
+};
+
+enum class TraceFormat : uint8_t {
+    JSON, // Chrome trace events, as written by FileExporter
+    CHUNKED, // chunk store of the collector, see chunk_store.hpp
+};
+
+/// @brief A trace file opened for the offline tools, whatever its format.
+///
+/// The file is memory-mapped. partition() splits its events into ranges at event boundaries, and
+/// every range can be decoded independently by an EventCursor, so the tools can spread one file
+/// over all cores.
+class TraceFile {
+public:
+    explicit TraceFile(const std::string& path);
+
+    TraceFormat format() const { return m_format; }
+    size_t size() const { return m_file.data().size(); }
+
+    /// @brief Split the events into at most `parts` ranges of similar size
+    std::vector<std::string_view> partition(size_t parts) const;
+
+    /// @brief Chunk index of a store, empty for other formats and for stores without an index
+    const std::vector<ChunkInfo>& chunks() const { return m_chunks; }
+
+    /// @brief Events of a chunk, a range for EventCursor
+    std::string_view chunk_data(const ChunkInfo& chunk) const { return m_file.data().substr(chunk.offset, chunk.size); }
+
+private:
+    MappedFile m_file;
+    TraceFormat m_format;
+    std::string_view m_events;
+    std::vector<ChunkInfo> m_chunks;
+};
+
+/// @brief Decodes the events of one range of a TraceFile.
+///
+/// Malformed events are skipped up to the next line and counted.
+class EventCursor {
+public:
+    EventCursor(TraceFormat format, std::string_view range);
+
+    bool next(EventView& event);
+
+    uint64_t malformed() const { return m_malformed; }
+
+private:
+    bool next_json(EventView& event);
+
+    TraceFormat m_format;
+    const char* m_position;
+    const char* m_end;
+    uint64_t m_malformed { 0 };
+};
+
+} // namespace Analysis
@@ -0,0 +1,342 @@
+#include "trace_merge.hpp"
+#include "timeline.hpp"
+#include "trace_file.hpp"
+
+#include <Profiler/chrome_event.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <unordered_set>
+#include <unistd.h>
+
+namespace Analysis {
+
+namespace {
+    /// @brief Output is handed to the writer thread in buffers of this size
+    constexpr size_t WRITE_BUFFER_SIZE { 4 * 1024 * 1024 };
+
+    /// @brief Runs are read back through buffers of this size, one per run
+    constexpr size_t RUN_READ_BUFFER_SIZE { 256 * 1024 };
+
+    struct RangeJob {
+        const TraceFile* file;
+        std::string_view range;
+    };
+
+    struct RangeResult {
+        bool is_sorted { true };
+        std::vector<std::string> runs;
+        std::vector<std::pair<std::string, std::string_view>> metadata;
+        uint64_t events { 0 };
+        uint64_t malformed { 0 };
+    };
+
+    /// @brief Removes the spilled runs, whatever way the merge ends
+    struct TempFiles {
+        std::vector<std::string> paths;
+
+        ~TempFiles()
+        {
+            std::error_code ignored;
+            for (const std::string& path : paths) {
+                std::filesystem::remove(path, ignored);
+            }
+        }
+    };
+
+    struct Entry {
+        int64_t ts;
+        std::string_view raw;
+    };
+
+    void write_run(const std::string& path, std::vector<Entry>& entries)
+    {
+        std::ranges::stable_sort(entries, {}, &Entry::ts);
+        std::ofstream out(path, std::ios::binary);
+        for (const Entry& entry : entries) {
+            const auto length = static_cast<uint32_t>(entry.raw.size());
+            out.write(reinterpret_cast<const char*>(&entry.ts), sizeof(entry.ts));
+            out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+            out.write(entry.raw.data(), static_cast<std::streamsize>(entry.raw.size()));
+        }
+        if (!out) {
+            throw std::runtime_error("Failed to spill events to " + path);
+        }
+        entries.clear();
+    }
+
+    /// @brief Scan a range once for metadata and order, then spill it in sorted runs if it isn't ordered
+    void scan_range(const RangeJob& job, const MergeOptions& options, const std::function<std::string()>& next_run_path, RangeResult& result)
+    {
+        EventCursor cursor(job.file->format(), job.range);
+        EventView event {};
+        int64_t last_ts = INT64_MIN;
+        while (cursor.next(event)) {
+            if (event.ph == 'M') {
+                result.metadata.emplace_back(std::format("{}/{}/{}", event.pid, event.tid, event.name), event.raw);
+                continue;
+            }
+            ++result.events;
+            result.is_sorted = result.is_sorted && event.ts >= last_ts;
+            last_ts = event.ts;
+        }
+        result.malformed = cursor.malformed();
+        if (result.is_sorted) {
+            return;
+        }
+
+        std::vector<Entry> entries;
+        entries.reserve(std::min<uint64_t>(options.run_events, result.events));
+        EventCursor spill_cursor(job.file->format(), job.range);
+        while (spill_cursor.next(event)) {
+            if (event.ph == 'M') {
+                continue;
+            }
+            entries.push_back({ event.ts, event.raw });
+            if (entries.size() >= options.run_events) {
+                write_run(result.runs.emplace_back(next_run_path()), entries);
+            }
+        }
+        if (!entries.empty()) {
+            write_run(result.runs.emplace_back(next_run_path()), entries);
+        }
+    }
+
+    class Source {
+    public:
+        virtual ~Source() = default;
+        virtual bool next() = 0;
+
+        int64_t ts { 0 };
+        std::string_view raw;
+    };
+
+    /// @brief Events of an ordered range, read in place from the mapped file
+    class RangeSource final : public Source {
+    public:
+        RangeSource(TraceFormat format, std::string_view range)
+            : m_cursor(format, range)
+        {
+        }
+
+        bool next() override
+        {
+            EventView event {};
+            while (m_cursor.next(event)) {
+                if (event.ph != 'M') {
+                    ts = event.ts;
+                    raw = event.raw;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        EventCursor m_cursor;
+    };
+
+    class RunSource final : public Source {
+    public:
+        explicit RunSource(const std::string& path)
+            : m_read_buffer(RUN_READ_BUFFER_SIZE)
+        {
+            m_in.rdbuf()->pubsetbuf(m_read_buffer.data(), static_cast<std::streamsize>(m_read_buffer.size()));
+            m_in.open(path, std::ios::binary);
+            if (!m_in) {
+                throw std::runtime_error("Failed to read spilled events from " + path);
+            }
+        }
+
+        bool next() override
+        {
+            uint32_t length = 0;
+            m_in.read(reinterpret_cast<char*>(&ts), sizeof(ts));
+            m_in.read(reinterpret_cast<char*>(&length), sizeof(length));
+            if (!m_in) {
+                return false;
+            }
+            m_event.resize(length);
+            m_in.read(m_event.data(), length);
+            raw = m_event;
+            return static_cast<bool>(m_in);
+        }
+
+    private:
+        std::vector<char> m_read_buffer;
+        std::ifstream m_in;
+        std::string m_event;
+    };
+
+    /// @brief Buffered output, every full buffer is written by a background task while the next fills
+    class AsyncWriter {
+    public:
+        explicit AsyncWriter(const std::string& path)
+            : m_out(path, std::ios::binary)
+        {
+            if (!m_out) {
+                throw std::runtime_error("Failed to open " + path);
+            }
+            m_buffer.reserve(WRITE_BUFFER_SIZE);
+        }
+
+        void append(std::string_view text)
+        {
+            m_buffer += text;
+            if (m_buffer.size() >= WRITE_BUFFER_SIZE) {
+                flush_async();
+            }
+        }
+
+        /// @brief Events span a single line in the output; JSON strings can't hold raw line breaks, so
+        /// any in the event are whitespace
+        void append_event(std::string_view raw)
+        {
+            const size_t start = m_buffer.size();
+            append(raw);
+            if (raw.find_first_of("\r\n") != std::string_view::npos) {
+                std::replace_if(m_buffer.begin() + static_cast<std::ptrdiff_t>(start), m_buffer.end(), [](char c) { return c == '\n' || c == '\r'; }, ' ');
+            }
+        }
+
+        void close()
+        {
+            flush_async();
+            wait();
+            m_out.close();
+            if (!m_out) {
+                throw std::runtime_error("Failed to write the merged trace");
+            }
+        }
+
+    private:
+        void wait()
+        {
+            if (m_pending.valid()) {
+                m_pending.get();
+            }
+        }
+
+        void flush_async()
+        {
+            wait();
+            m_writing.swap(m_buffer);
+            m_buffer.clear();
+            m_pending = std::async(std::launch::async, [this] { m_out.write(m_writing.data(), static_cast<std::streamsize>(m_writing.size())); });
+        }
+
+        std::ofstream m_out;
+        std::string m_buffer;
+        std::string m_writing;
+        std::future<void> m_pending;
+    };
+} // namespace
+
+MergeResult merge_traces(const MergeOptions& options)
+{
+    std::vector<std::unique_ptr<TraceFile>> files;
+    std::vector<RangeJob> jobs;
+    for (const std::string& input : options.inputs) {
+        const auto& file = files.emplace_back(std::make_unique<TraceFile>(input));
+        for (const std::string_view range : file->partition(options.threads * 2)) {
+            jobs.push_back({ file.get(), range });
+        }
+    }
+
+    TempFiles temp_files;
+    std::atomic<size_t> run_number { 0 };
+    const auto next_run_path = [&] {
+        return std::format("{}/trace_merge.{}.{}.run", options.temp_dir, ::getpid(), run_number++);
+    };
+
+    std::vector<RangeResult> results(jobs.size());
+    std::exception_ptr failure;
+    std::mutex failure_lock;
+    parallel_for(jobs.size(), options.threads, [&](size_t /* worker */, size_t index) {
+        try {
+            scan_range(jobs[index], options, next_run_path, results[index]);
+        } catch (...) {
+            const std::lock_guard<std::mutex> guard(failure_lock);
+            failure = std::current_exception();
+        }
+    });
+    for (const RangeResult& result : results) {
+        temp_files.paths.insert(temp_files.paths.end(), result.runs.begin(), result.runs.end());
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+
+    MergeResult summary {};
+    AsyncWriter writer(options.output_file);
+    writer.append(Tracer::TRACE_EVENTS);
+    writer.append("\n");
+    bool is_first = true;
+    const auto write_event = [&](std::string_view raw) {
+        if (!is_first) {
+            writer.append(",\n");
+        }
+        is_first = false;
+        writer.append_event(raw);
+    };
+
+    // Metadata first, in input order, the first of each (pid, tid, name) wins
+    std::unordered_set<std::string> metadata_keys;
+    for (const RangeResult& result : results) {
+        for (const auto& [key, raw] : result.metadata) {
+            if (metadata_keys.insert(key).second) {
+                write_event(raw);
+                ++summary.metadata_events;
+            } else {
+                ++summary.duplicate_metadata;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Source>> sources;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        summary.malformed_events += results[i].malformed;
+        if (results[i].is_sorted) {
+            ++summary.sorted_ranges;
+            sources.push_back(std::make_unique<RangeSource>(jobs[i].file->format(), jobs[i].range));
+        }
+        for (const std::string& run : results[i].runs) {
+            sources.push_back(std::make_unique<RunSource>(run));
+        }
+        summary.spilled_runs += results[i].runs.size();
+    }
+
+    // Ties keep the order of the sources, so events of one input with equal timestamps stay in order
+    using Head = std::pair<int64_t, size_t>;
+    std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        if (sources[i]->next()) {
+            heads.emplace(sources[i]->ts, i);
+        }
+    }
+    while (!heads.empty()) {
+        const size_t index = heads.top().second;
+        heads.pop();
+        Source& source = *sources[index];
+        write_event(source.raw);
+        ++summary.events;
+        if (source.next()) {
+            heads.emplace(source.ts, index);
+        }
+    }
+
+    writer.append("\n");
+    writer.append(Tracer::TRACE_EVENT_BODY);
+    writer.close();
+    return summary;
+}
+
+} // namespace Analysis
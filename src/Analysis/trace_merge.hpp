@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Analysis {
+
+struct MergeOptions {
+    std::vector<std::string> inputs;
+    std::string output_file;
+    std::string temp_dir;
+    size_t threads;
+
+    /// @var run_events Events sorted in memory at once per thread before spilling them to disk
+    size_t run_events;
+};
+
+struct MergeResult {
+    uint64_t events;
+    uint64_t metadata_events;
+    uint64_t duplicate_metadata;
+    uint64_t malformed_events;
+    size_t sorted_ranges;
+    size_t spilled_runs;
+};
+
+/// @brief Merge trace files into one, ordered by timestamp.
+///
+/// Inputs are split into ranges that are scanned in parallel. A range already ordered by `ts` is
+/// merged straight from the mapped file; any other range is sorted in runs of `run_events` that are
+/// spilled to `temp_dir`. A k-way merge of all ranges and runs then writes the events, while a
+/// background thread writes the previous buffer. Memory depends on `run_events` and the buffer
+/// sizes, not on the size of the traces. Metadata events (ph "M") are written first, once per
+/// (pid, tid, name).
+MergeResult merge_traces(const MergeOptions& options);
+
+} // namespace Analysis
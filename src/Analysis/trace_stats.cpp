@@ -0,0 +1,59 @@
+#include "trace_stats.hpp"
+#include "timeline.hpp"
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <unordered_map>
+
+namespace Analysis {
+
+namespace {
+    struct Partial {
+        HdrHistogram histogram;
+        int64_t self_time { 0 };
+    };
+
+    /// @brief Fold the events of one thread. A parent's self time loses the duration of every
+    /// event it fully contains that no deeper event contains.
+    void fold_thread(const std::vector<Span>& spans, std::unordered_map<uint32_t, Partial>& partials)
+    {
+        walk_nesting(spans, [&](const Span& span, const std::vector<const Span*>& stack) {
+            if (!stack.empty()) {
+                partials[stack.back()->key].self_time -= span.dur;
+            }
+            Partial& partial = partials[span.key];
+            partial.histogram.record(span.dur);
+            partial.self_time += span.dur;
+        });
+    }
+} // namespace
+
+TraceStats compute_stats(const TraceFile& file, size_t threads)
+{
+    threads = std::max<size_t>(threads, 1);
+    const Timelines timelines = build_timelines(file, threads);
+
+    TraceStats stats { {}, timelines.events, timelines.complete_events, timelines.malformed_events };
+    stats.scopes.reserve(timelines.keys.size());
+    for (const ScopeKey& key : timelines.keys) {
+        stats.scopes.push_back({ std::string(key.name), std::string(key.cat), HdrHistogram {}, 0 });
+    }
+
+    // One state per key: a thread is folded on its own, then merged into the keys it saw
+    static constexpr size_t LOCK_STRIPES { 64 };
+    std::array<std::mutex, LOCK_STRIPES> locks;
+    parallel_for(timelines.threads.size(), threads, [&](size_t /* worker */, size_t index) {
+        std::unordered_map<uint32_t, Partial> partials;
+        fold_thread(timelines.threads[index].second, partials);
+        for (const auto& [key, partial] : partials) {
+            const std::lock_guard lock(locks[key % LOCK_STRIPES]);
+            ScopeStats& scope = stats.scopes[key];
+            scope.histogram.merge(partial.histogram);
+            scope.self_time += partial.self_time;
+        }
+    });
+    return stats;
+}
+
+} // namespace Analysis
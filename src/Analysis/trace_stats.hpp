@@ -0,0 +1,33 @@
+#pragma once
+
+#include "hdr_histogram.hpp"
+#include "trace_file.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Analysis {
+
+/// @brief Statistics of all complete events sharing a name and category
+struct ScopeStats {
+    std::string name;
+    std::string cat;
+    HdrHistogram histogram;
+    int64_t self_time;
+};
+
+struct TraceStats {
+    std::vector<ScopeStats> scopes;
+    uint64_t events;
+    uint64_t complete_events;
+    uint64_t malformed_events;
+};
+
+/// @brief Per (name, cat) statistics of the complete events of a trace, using up to `threads` threads.
+///
+/// Self time comes from the nesting of every thread's events sorted by start time, which doesn't
+/// depend on the order of the file. Threads are folded in parallel.
+TraceStats compute_stats(const TraceFile& file, size_t threads);
+
+} // namespace Analysis
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Args/args.hpp>
+
+#include <charconv>
+#include <string>
+#include <thread>
+
+struct ArgsOpts {
+    std::string input_file = "";
+    std::string folded_file = "";
+    std::string html_file = "";
+    std::string title = "Flame Graph";
+    size_t threads = std::max(std::thread::hardware_concurrency(), 1U);
+    bool per_thread = false;
+};
+
+inline Args::Result parse_count(std::string_view key, std::string_view value, size_t& count)
+{
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), count);
+    if (error != std::errc {} || end != value.data() + value.size() || count == 0) {
+        return { Args::Result::Code::ERROR, std::string("Error: ") + std::string(key) + " expects a positive number" };
+    }
+    return { Args::Result::Code::OK };
+}
+
+inline Args::Result command_handler(std::string_view key, std::string_view value, ArgsOpts& options)
+{
+    if (key == "--input" && !value.empty()) {
+        options.input_file = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--folded" && !value.empty()) {
+        options.folded_file = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--html" && !value.empty()) {
+        options.html_file = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--title" && !value.empty()) {
+        options.title = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--threads") {
+        return parse_count(key, value, options.threads);
+    }
+    if (key == "--per-thread" && value.empty()) {
+        options.per_thread = true;
+        return { Args::Result::Code::OK };
+    }
+    return { Args::Result::Code::UNHANDLED };
+}
@@ -0,0 +1,203 @@
+#include "call_tree.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace {
+/// @brief Frames below this fraction of the total are left out of the page, they'd be invisible
+constexpr double HTML_MIN_FRACTION { 1e-4 };
+
+constexpr std::string_view HTML_HEAD { R"(<!DOCTYPE html>
+<html><head><meta charset="utf-8"><title>{TITLE}</title><style>
+body { font: 12px sans-serif; margin: 8px; }
+#info { height: 16px; margin-bottom: 4px; }
+#chart { position: relative; }
+.frame { position: absolute; height: 17px; overflow: hidden; white-space: nowrap; box-sizing: border-box;
+  border: 1px solid #fff; padding-left: 2px; line-height: 15px; cursor: pointer; }
+</style></head><body><h3>{TITLE}</h3><div id="info"></div><div id="chart"></div><script>
+const root = )" };
+
+constexpr std::string_view HTML_TAIL { R"(;
+// Nodes are [label, total, self, children], times in microseconds
+const chart = document.getElementById('chart');
+const info = document.getElementById('info');
+const ROW = 18;
+function color(label) {
+  let hash = 0;
+  for (const c of label) hash = (hash * 31 + c.charCodeAt(0)) | 0;
+  return `hsl(${10 + Math.abs(hash) % 45}, 85%, ${55 + Math.abs(hash >> 8) % 20}%)`;
+}
+function depth(node) {
+  return 1 + node[3].reduce((deepest, child) => Math.max(deepest, depth(child)), 0);
+}
+function render(focus) {
+  chart.innerHTML = '';
+  const rows = depth(focus);
+  chart.style.height = rows * ROW + 'px';
+  const draw = (node, x, width, level) => {
+    if (width < 0.05) return;
+    const frame = document.createElement('div');
+    frame.className = 'frame';
+    frame.style.left = x + '%';
+    frame.style.width = width + '%';
+    frame.style.top = (rows - 1 - level) * ROW + 'px';
+    frame.style.background = color(node[0]);
+    frame.textContent = node[0];
+    frame.title = `${node[0]}: total ${node[1]} us (${(100 * node[1] / root[1]).toFixed(2)}%), self ${node[2]} us`;
+    frame.onmouseover = () => { info.textContent = frame.title; };
+    frame.onclick = () => render(node === focus ? root : node);
+    chart.appendChild(frame);
+    let child_x = x;
+    for (const child of node[3]) {
+      const child_width = width * child[1] / node[1];
+      draw(child, child_x, child_width, level + 1);
+      child_x += child_width;
+    }
+  };
+  draw(focus, 0, 100, 0);
+}
+render(root);
+</script></body></html>
+)" };
+
+void write_html_text(std::ostream& out, std::string_view text)
+{
+    for (const char c : text) {
+        switch (c) {
+        case '<':
+            out << "&lt;";
+            break;
+        case '>':
+            out << "&gt;";
+            break;
+        case '&':
+            out << "&amp;";
+            break;
+        default:
+            out << c;
+        }
+    }
+}
+
+void write_template(std::ostream& out, std::string_view html, std::string_view title)
+{
+    for (size_t at = html.find("{TITLE}"); at != std::string_view::npos; at = html.find("{TITLE}")) {
+        out << html.substr(0, at);
+        write_html_text(out, title);
+        html.remove_prefix(at + 7);
+    }
+    out << html;
+}
+} // namespace
+
+CallTree::CallTree()
+{
+    m_nodes.push_back({ "all", 0, {}, {} });
+}
+
+uint32_t CallTree::child(uint32_t parent, std::string_view label)
+{
+    const auto [it, is_new] = m_nodes[parent].index.try_emplace(label, static_cast<uint32_t>(m_nodes.size()));
+    const uint32_t node = it->second;
+    if (is_new) {
+        m_nodes[parent].children.push_back(node);
+        m_nodes.push_back({ label, 0, {}, {} });
+    }
+    return node;
+}
+
+void CallTree::merge(const CallTree& other)
+{
+    merge(other, ROOT, ROOT);
+}
+
+void CallTree::merge(const CallTree& other, uint32_t other_node, uint32_t node)
+{
+    m_nodes[node].self_time += other.m_nodes[other_node].self_time;
+    for (const uint32_t other_child : other.m_nodes[other_node].children) {
+        merge(other, other_child, child(node, other.m_nodes[other_child].label));
+    }
+}
+
+int64_t CallTree::total(uint32_t node) const
+{
+    int64_t sum = m_nodes[node].self_time;
+    for (const uint32_t child : m_nodes[node].children) {
+        sum += total(child);
+    }
+    return sum;
+}
+
+int64_t CallTree::fill_totals(uint32_t node, std::vector<int64_t>& totals) const
+{
+    int64_t sum = m_nodes[node].self_time;
+    for (const uint32_t child : m_nodes[node].children) {
+        sum += fill_totals(child, totals);
+    }
+    totals[node] = sum;
+    return sum;
+}
+
+void CallTree::write_folded(std::ostream& out) const
+{
+    std::string path;
+    for (const uint32_t child : m_nodes[ROOT].children) {
+        write_folded(out, child, path);
+    }
+}
+
+void CallTree::write_folded(std::ostream& out, uint32_t node, std::string& path) const
+{
+    const size_t length = path.size();
+    if (!path.empty()) {
+        path += ';';
+    }
+    // Semicolons separate frames, so they can't appear in a label
+    std::ranges::replace_copy(m_nodes[node].label, std::back_inserter(path), ';', ':');
+
+    if (m_nodes[node].self_time > 0) {
+        out << path << ' ' << m_nodes[node].self_time << '\n';
+    }
+    for (const uint32_t child : m_nodes[node].children) {
+        write_folded(out, child, path);
+    }
+    path.resize(length);
+}
+
+void CallTree::write_html(std::ostream& out, std::string_view title) const
+{
+    std::vector<int64_t> totals(m_nodes.size());
+    const int64_t root_total = fill_totals(ROOT, totals);
+
+    write_template(out, HTML_HEAD, title);
+    write_json(out, ROOT, totals, static_cast<int64_t>(static_cast<double>(root_total) * HTML_MIN_FRACTION));
+    write_template(out, HTML_TAIL, title);
+}
+
+void CallTree::write_json(std::ostream& out, uint32_t node, const std::vector<int64_t>& totals, int64_t min_total) const
+{
+    // Labels are still JSON-escaped as read from the trace; "</" must not close the script
+    out << "[\"";
+    std::string_view label = m_nodes[node].label;
+    for (size_t at = label.find("</"); at != std::string_view::npos; at = label.find("</")) {
+        out << label.substr(0, at) << "<\\/";
+        label.remove_prefix(at + 2);
+    }
+    out << label << "\"," << totals[node] << ',' << m_nodes[node].self_time << ",[";
+
+    // Heaviest children first
+    std::vector<uint32_t> children = m_nodes[node].children;
+    std::ranges::sort(children, [&](uint32_t lhs, uint32_t rhs) { return totals[lhs] > totals[rhs]; });
+    bool is_first = true;
+    for (const uint32_t child : children) {
+        if (totals[child] < min_total || totals[child] == 0) {
+            continue;
+        }
+        if (!is_first) {
+            out << ',';
+        }
+        is_first = false;
+        write_json(out, child, totals, min_total);
+    }
+    out << "]]";
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// @brief Call tree of scopes merged by path, weighted by self time.
+///
+/// Labels are not copied, they must outlive the tree (the mapped trace file or the caller's storage).
+class CallTree {
+public:
+    static constexpr uint32_t ROOT { 0 };
+
+    CallTree();
+
+    /// @brief Index of the child of `parent` with the given label, created on first use
+    uint32_t child(uint32_t parent, std::string_view label);
+
+    void add_self(uint32_t node, int64_t self_time) { m_nodes[node].self_time += self_time; }
+
+    /// @brief Add the paths and weights of another tree
+    void merge(const CallTree& other);
+
+    /// @brief One "frame;frame;frame weight" line per path with self time, the format of flamegraph.pl
+    void write_folded(std::ostream& out) const;
+
+    /// @brief A standalone page drawing the tree, click a frame to zoom into it
+    void write_html(std::ostream& out, std::string_view title) const;
+
+    int64_t total_time() const { return total(ROOT); }
+
+private:
+    struct Node {
+        std::string_view label;
+        int64_t self_time { 0 };
+        std::vector<uint32_t> children;
+        std::unordered_map<std::string_view, uint32_t> index;
+    };
+
+    void merge(const CallTree& other, uint32_t other_node, uint32_t node);
+    int64_t total(uint32_t node) const;
+    int64_t fill_totals(uint32_t node, std::vector<int64_t>& totals) const;
+    void write_folded(std::ostream& out, uint32_t node, std::string& path) const;
+    void write_json(std::ostream& out, uint32_t node, const std::vector<int64_t>& totals, int64_t min_total) const;
+
+    std::vector<Node> m_nodes;
+};
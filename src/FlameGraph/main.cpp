@@ -0,0 +1,81 @@
+#include "args.hpp"
+#include "call_tree.hpp"
+
+#include <Analysis/timeline.hpp>
+
+#include <exception>
+#include <format>
+#include <fstream>
+#include <print>
+
+namespace {
+/// @brief Rebuild every thread's call tree from the nesting of its complete events
+CallTree build_tree(const Analysis::Timelines& timelines, size_t threads, const std::vector<std::string>& thread_labels)
+{
+    std::vector<CallTree> trees(threads);
+    Analysis::parallel_for(timelines.threads.size(), threads, [&](size_t worker, size_t index) {
+        CallTree& tree = trees[worker];
+        const uint32_t thread_root = thread_labels.empty() ? CallTree::ROOT : tree.child(CallTree::ROOT, thread_labels[index]);
+
+        std::vector<uint32_t> nodes;
+        Analysis::walk_nesting(timelines.threads[index].second, [&](const Analysis::Span& span, const std::vector<const Analysis::Span*>& stack) {
+            nodes.resize(stack.size());
+            const uint32_t parent = nodes.empty() ? thread_root : nodes.back();
+            const uint32_t node = tree.child(parent, timelines.keys[span.key].name);
+            tree.add_self(node, span.dur);
+            if (!nodes.empty()) {
+                tree.add_self(parent, -span.dur);
+            }
+            nodes.push_back(node);
+        });
+    });
+
+    for (size_t worker = 1; worker < trees.size(); ++worker) {
+        trees.front().merge(trees[worker]);
+    }
+    return std::move(trees.front());
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const ArgsOpts options = Args::parse<ArgsOpts>(argc, argv, command_handler);
+    if (options.input_file.empty() || (options.folded_file.empty() && options.html_file.empty())) {
+        std::println(stderr, "Usage: trace_flamegraph --input <trace> [--folded <file>] [--html <file>] [--title T] [--per-thread] [--threads N]");
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const Analysis::TraceFile file(options.input_file);
+        const Analysis::Timelines timelines = Analysis::build_timelines(file, options.threads);
+
+        std::vector<std::string> thread_labels;
+        if (options.per_thread) {
+            for (const auto& [thread, spans] : timelines.threads) {
+                thread_labels.push_back(std::format("pid {} tid {}", thread >> 32, thread & 0xffffffff));
+            }
+        }
+        const CallTree tree = build_tree(timelines, options.threads, thread_labels);
+
+        if (!options.folded_file.empty()) {
+            std::ofstream folded(options.folded_file);
+            tree.write_folded(folded);
+            if (!folded) {
+                throw std::runtime_error("Failed to write " + options.folded_file);
+            }
+        }
+        if (!options.html_file.empty()) {
+            std::ofstream html(options.html_file);
+            tree.write_html(html, options.title);
+            if (!html) {
+                throw std::runtime_error("Failed to write " + options.html_file);
+            }
+        }
+        std::println("{} complete events of {} threads, {} us in total", timelines.complete_events,
+            timelines.threads.size(), tree.total_time());
+    } catch (const std::exception& error) {
+        std::println(stderr, "{}", error.what());
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "../call_tree.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <print>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Runs trace_flamegraph, given as the first argument, on nested.json and checks the folded stacks,
+// then merges call trees the way its workers do.
+
+namespace {
+const char* FOLDED = "/tmp/trace_flamegraph_test.folded";
+const char* HTML = "/tmp/trace_flamegraph_test.html";
+
+/// @brief Lines of the text, sorted since sibling order depends on the workers
+std::vector<std::string> sorted_lines(std::istream& in)
+{
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    std::ranges::sort(lines);
+    return lines;
+}
+
+bool check_folded(const std::string& command, const std::vector<std::string>& expected)
+{
+    if (std::system(command.c_str()) != 0) {
+        std::println(stderr, "trace_flamegraph failed: {}", command);
+        return false;
+    }
+    std::ifstream folded(FOLDED);
+    const std::vector<std::string> lines = sorted_lines(folded);
+    if (lines != expected) {
+        std::println(stderr, "Folded {} stacks, expected {}:", lines.size(), expected.size());
+        for (const std::string& line : lines) {
+            std::println(stderr, "  {}", line);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool test_merge()
+{
+    // Labels outlive the trees, like the mapped trace does
+    const std::string shared = "parse";
+    std::vector<CallTree> trees(3);
+    trees[0].add_self(trees[0].child(trees[0].child(CallTree::ROOT, "main"), shared), 5);
+    trees[1].add_self(trees[1].child(trees[1].child(CallTree::ROOT, "main"), "parse"), 7);
+    trees[1].add_self(trees[1].child(trees[1].child(CallTree::ROOT, "main"), "load;file"), 3);
+    trees[2].add_self(trees[2].child(CallTree::ROOT, "idle"), 1);
+    trees[2].add_self(trees[2].child(CallTree::ROOT, "main"), 4);
+    for (size_t worker = 1; worker < trees.size(); ++worker) {
+        trees.front().merge(trees[worker]);
+    }
+
+    std::stringstream folded;
+    trees.front().write_folded(folded);
+    const std::vector<std::string> expected { "idle 1", "main 4", "main;load:file 3", "main;parse 12" };
+    if (sorted_lines(folded) != expected || trees.front().total_time() != 20) {
+        std::println(stderr, "Merged trees of {} us differ", trees.front().total_time());
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3) {
+        std::println(stderr, "Usage: flamegraph_test <trace_flamegraph> <nested.json>");
+        return 1;
+    }
+    const std::string command = std::string(argv[1]) + " --input " + argv[2] + " --folded " + FOLDED + " --threads 2";
+
+    // Self time is the duration less the children: root 100 - 20 - 50 plus the second root of 50,
+    // middle 50 - 10; the leaf of tid 2 starts its own stack
+    std::println("1. Testing folded stacks...");
+    if (!check_folded(command, { "leaf 30", "root 80", "root;leaf 20", "root;middle 40", "root;middle;leaf 10" })) {
+        return 1;
+    }
+    std::println("2. Testing folded stacks per thread...");
+    const std::vector<std::string> per_thread {
+        "pid 1 tid 1;root 80", "pid 1 tid 1;root;leaf 20", "pid 1 tid 1;root;middle 40", "pid 1 tid 1;root;middle;leaf 10", "pid 1 tid 2;leaf 30"
+    };
+    if (!check_folded(command + " --per-thread --html " + HTML, per_thread)) {
+        return 1;
+    }
+    std::ifstream html(HTML);
+    const std::string page((std::istreambuf_iterator<char>(html)), std::istreambuf_iterator<char>());
+    if (page.find(R"(const root = ["all",180,0,[)") == std::string::npos) {
+        std::println(stderr, "The page doesn't hold the tree of 180 us");
+        return 1;
+    }
+    std::println("3. Testing call tree merge...");
+    if (!test_merge()) {
+        return 1;
+    }
+
+    std::println("\nFlame graph test complete.");
+    return 0;
+}
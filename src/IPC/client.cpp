@@ -1,25 +1,42 @@
 #include "client.hpp"
 
+#include <atomic>
 #include <filesystem>
 #include <iostream>
+#include <sstream>
 #include <thread>
+#include <tuple>
 
+#include <climits> // PIPE_BUF
 #include <fcntl.h> // open
+#include <pthread.h> // pthread_atfork
 #include <string.h> // strerror
 #include <unistd.h> // write
 
+namespace {
+// A forked child inherits the parent's queued messages. Those are still written by the parent, so
+// the child drops its copy when it notices the fork.
+std::atomic<unsigned> fork_generation { 0 };
+const int atfork_registered = pthread_atfork(nullptr, nullptr, []() { ++fork_generation; });
+
+constexpr std::chrono::milliseconds MAX_DELAY { 50 };
+} // namespace
+
 namespace IPC {
 
 PipeClient::PipeClient(const char* path)
     : m_pid(getpid())
+    , m_fork_generation(fork_generation.load())
     , m_pipe_path(path)
 {
+    std::ignore = atfork_registered;
+    m_buffer.reserve(PIPE_BUF);
 }
 
 PipeClient::~PipeClient()
 {
-    m_pipe_stream.close();
-    if (m_pipe_stream.fail()) {
+    std::ignore = flush();
+    if (m_pipe_fd >= 0 && close(m_pipe_fd) != 0) {
         std::cerr << "PID " << m_pid << ": Error while closing pipe. " << strerror(errno) << '\n';
     }
 }
@@ -33,9 +50,9 @@ bool PipeClient::init()
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
     }
-    m_pipe_stream.open(m_pipe_path.data(), std::ios::binary | std::ios::out);
-    if (!m_pipe_stream.is_open() || m_pipe_stream.fail()) {
-        std::cerr << "Failed to open pipe.\n";
+    m_pipe_fd = open(m_pipe_path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (m_pipe_fd < 0) {
+        std::cerr << "Failed to open pipe. " << strerror(errno) << '\n';
         return false;
     }
     return true;
@@ -43,11 +60,49 @@ bool PipeClient::init()
 
 bool PipeClient::write_message(const Message& msg)
 {
-    m_pipe_stream << msg;
-    if (m_pipe_stream.fail()) {
-        std::cerr << "PID " << m_pid << ": Error while writing message. " << strerror(errno) << '\n';
+    if (const unsigned generation = fork_generation.load(std::memory_order_relaxed); generation != m_fork_generation) {
+        m_fork_generation = generation;
+        m_pid = getpid();
+        m_buffer.clear();
+    }
+
+    std::stringstream ss;
+    ss << msg;
+    const std::string frame = ss.str();
+
+    if (m_buffer.size() + frame.size() > PIPE_BUF && !flush()) {
         return false;
     }
+    const Clock::time_point now = Clock::now();
+    if (m_buffer.empty()) {
+        m_first_queued = now;
+    }
+    m_buffer += frame;
+
+    const bool is_slow = now - m_last_queued >= MAX_DELAY;
+    m_last_queued = now;
+    if (msg.kind != MessageKind::DATA || m_buffer.size() >= PIPE_BUF || is_slow || now - m_first_queued >= MAX_DELAY) {
+        return flush();
+    }
+    return true;
+}
+
+bool PipeClient::flush()
+{
+    size_t offset = 0;
+    while (offset < m_buffer.size()) {
+        const ssize_t written = write(m_pipe_fd, m_buffer.data() + offset, m_buffer.size() - offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "PID " << m_pid << ": Error while writing message. " << strerror(errno) << '\n';
+            m_buffer.clear();
+            return false;
+        }
+        offset += static_cast<size_t>(written);
+    }
+    m_buffer.clear();
     return true;
 }
 
@@ -2,7 +2,7 @@
 
 #include "message.hpp"
 
-#include <fstream>
+#include <chrono>
 #include <string>
 
 namespace IPC {
@@ -14,12 +14,29 @@ public:
 
     bool init();
 
+    /// @brief Queue a message for the server.
+    ///
+    /// Messages are batched and written in chunks of at most PIPE_BUF bytes. POSIX guarantees those
+    /// writes are atomic, so messages from several processes sharing the pipe never interleave.
+    /// STOP and HELLO messages are written immediately. So are messages that arrive more than
+    /// MAX_DELAY after the previous one, and messages that find the oldest queued one MAX_DELAY
+    /// old, so slow clients don't hold back their events. There's no timer: the queue of a client
+    /// that goes idle waits for its next message, flush() or the destructor.
     bool write_message(const Message& msg);
 
+    /// @brief Write all queued messages to the pipe.
+    bool flush();
+
 private:
+    using Clock = std::chrono::steady_clock;
+
     pid_t m_pid {};
+    unsigned m_fork_generation {};
+    int m_pipe_fd { -1 };
     std::string m_pipe_path;
-    std::ofstream m_pipe_stream;
+    std::string m_buffer;
+    Clock::time_point m_first_queued {};
+    Clock::time_point m_last_queued {};
 };
 
 } // namespace IPC
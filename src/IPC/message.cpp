@@ -48,6 +48,11 @@ std::istream& deserialize(std::istream& in, Message& msg)
     in.read(reinterpret_cast<char*>(&msg.kind), sizeof(msg.kind));
     in.read(reinterpret_cast<char*>(&msg.pid), sizeof(msg.pid));
     in.read(reinterpret_cast<char*>(&length), sizeof(length));
+    if (length > MAX_BODY_LENGTH) {
+        // A desynchronized stream would otherwise block waiting for a bogus body
+        in.setstate(std::ios::failbit);
+        return in;
+    }
     msg.body.resize(length);
     in.read(&msg.body[0], length);
     return in;
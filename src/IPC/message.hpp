@@ -8,8 +8,12 @@ namespace IPC {
 enum class MessageKind : uint8_t {
     DATA,
     STOP,
+    HELLO, // body is the path of the client's control pipe
 };
 
+/// @brief Upper bound for a message body. Larger lengths can only come from a corrupted stream.
+static constexpr size_t MAX_BODY_LENGTH { 1 << 20 };
+
 struct Message {
     MessageKind kind;
     int pid;
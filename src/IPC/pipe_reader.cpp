@@ -0,0 +1,89 @@
+#include "pipe_reader.hpp"
+
+#include <array>
+#include <cstring>
+#include <print>
+
+#include <fcntl.h> // open
+#include <string.h> // strerror
+#include <sys/stat.h> // mkfifo
+#include <unistd.h> // read
+
+namespace IPC {
+
+namespace {
+    // The frame written by IPC::serialize: kind, pid, body length, body
+    constexpr size_t HEADER_SIZE { sizeof(MessageKind) + sizeof(int) + sizeof(size_t) };
+} // namespace
+
+PipeReader::PipeReader(std::string_view path)
+    : m_path(path)
+{
+}
+
+PipeReader::~PipeReader()
+{
+    if (m_read_fd >= 0) {
+        close(m_read_fd);
+    }
+    if (m_write_fd >= 0) {
+        close(m_write_fd);
+    }
+    if (m_read_fd >= 0 && unlink(m_path.c_str()) != 0) {
+        std::println(stderr, "Error while unlinking pipe {}. {}", m_path, strerror(errno));
+    }
+}
+
+bool PipeReader::init()
+{
+    if (mkfifo(m_path.c_str(), 0666) < 0 && errno != EEXIST) {
+        std::println(stderr, "Error when creating FIFO {}. {}.", m_path, strerror(errno));
+        return false;
+    }
+    m_read_fd = open(m_path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    // Only succeeds without blocking once the read end is open
+    m_write_fd = m_read_fd < 0 ? -1 : open(m_path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (m_read_fd < 0 || m_write_fd < 0) {
+        std::println(stderr, "Failed to open pipe {}. {}", m_path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+size_t PipeReader::read(const std::function<void(const Message&)>& handler)
+{
+    std::array<char, READ_LIMIT> buffer;
+    ssize_t count = 0;
+    do {
+        count = ::read(m_read_fd, buffer.data(), buffer.size());
+    } while (count < 0 && errno == EINTR);
+    if (count <= 0) {
+        return 0;
+    }
+    m_pending.append(buffer.data(), static_cast<size_t>(count));
+
+    size_t offset = 0;
+    while (m_pending.size() - offset >= HEADER_SIZE) {
+        const char* header = m_pending.data() + offset;
+        size_t length = 0;
+        std::memcpy(&m_message.kind, header, sizeof(MessageKind));
+        std::memcpy(&m_message.pid, header + sizeof(MessageKind), sizeof(int));
+        std::memcpy(&length, header + sizeof(MessageKind) + sizeof(int), sizeof(size_t));
+        if (length > MAX_BODY_LENGTH) {
+            // Nothing after a desynchronized frame can be trusted
+            std::println(stderr, "Corrupted message on pipe {}, dropping {} bytes", m_path, m_pending.size() - offset);
+            offset = m_pending.size();
+            break;
+        }
+        if (m_pending.size() - offset < HEADER_SIZE + length) {
+            break;
+        }
+        m_message.body.assign(header + HEADER_SIZE, length);
+        handler(m_message);
+        offset += HEADER_SIZE + length;
+    }
+    m_pending.erase(0, offset);
+    return static_cast<size_t>(count);
+}
+
+} // namespace IPC
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "message.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace IPC {
+
+/// @brief Non-blocking reader of a named pipe, for servers that poll several pipes from one thread.
+///
+/// Unlike PipeServer, the reader never blocks: read() takes what the pipe holds and hands out the
+/// complete messages, keeping a partial one for the next call. The reader also keeps a write end
+/// of its own pipe open, so the pipe doesn't signal end of file between clients.
+class PipeReader {
+public:
+    /// @brief Bytes taken from the pipe by one read(), so one busy pipe can't hold up the others
+    static constexpr size_t READ_LIMIT { 64 * 1024 };
+
+    explicit PipeReader(std::string_view path);
+    ~PipeReader();
+
+    PipeReader(const PipeReader&) = delete;
+    PipeReader& operator=(const PipeReader&) = delete;
+
+    /// @brief Create the pipe if needed and open it
+    [[nodiscard]] bool init();
+
+    /// @brief Descriptor to poll for POLLIN
+    int fd() const { return m_read_fd; }
+
+    const std::string& path() const { return m_path; }
+
+    /// @brief Pass the complete messages of up to READ_LIMIT available bytes to `handler`.
+    ///
+    /// @return Bytes read, 0 if the pipe was empty
+    size_t read(const std::function<void(const Message&)>& handler);
+
+private:
+    std::string m_path;
+    int m_read_fd { -1 };
+    int m_write_fd { -1 };
+
+    /// @var m_pending Bytes of a message that didn't arrive completely yet
+    std::string m_pending;
+    Message m_message {};
+};
+
+} // namespace IPC
@@ -71,7 +71,7 @@ void PipeServer::run(MessageHandler message_handler, StopHandler stop_handler)
             continue;
         }
 
-        if (msg->kind == MessageKind::DATA) {
+        if (msg->kind == MessageKind::DATA || msg->kind == MessageKind::HELLO) {
             // std::println(">> Message from PID [{}]", msg->pid);
             message_handler(msg.value());
         }
@@ -24,7 +24,7 @@ public:
 
     /// @brief Run the server loop.
     ///
-    /// MessageKind::DATA messages are passed to the provided message_handler.
+    /// MessageKind::DATA and MessageKind::HELLO messages are passed to the provided message_handler.
     /// MessageKind::STOP is handled internally to manage active clients.
     ///
     /// @param[in] message_handler Function to handle incoming messages.
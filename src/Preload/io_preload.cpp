@@ -0,0 +1,181 @@
+// LD_PRELOAD shim that traces blocking I/O calls made through the libc entry points.
+//
+//   LD_PRELOAD=libtracer_io_preload.so TRACER_IO_THRESHOLD_US=500 ./app
+//
+// Environment:
+//   TRACER_IO_THRESHOLD_US  Only calls lasting at least this long are traced (default: 100)
+//   TRACER_IO_PIPE          Send the slices to a TraceCollector listening on this pipe
+//   TRACER_IO_OUTPUT        Otherwise write them to this file (default: trace_io.json)
+//
+// The shim has its own exporter, separate from the one of a profiler linked into the application.
+// In file mode the slices end up in their own trace, only the pipe merges them with the
+// application's events.
+//
+// Calls libc makes internally (e.g. stdio buffers flushing through __write) don't go through the
+// public symbols and aren't traced.
+
+#include <Profiler/trace.hpp>
+
+#include <cerrno>
+#include <cstdlib>
+#include <type_traits>
+
+#include <dlfcn.h> // dlsym
+#include <sys/socket.h> // recv, send
+#include <unistd.h> // read, write, fsync
+
+namespace {
+
+using Tracer::FileExporter;
+using Tracer::IPCExporter;
+
+struct Config {
+    int64_t threshold_us;
+    const char* pipe_path;
+    const char* output_file;
+};
+
+const Config& config()
+{
+    static const Config config = []() {
+        const char* threshold = std::getenv("TRACER_IO_THRESHOLD_US");
+        const char* output = std::getenv("TRACER_IO_OUTPUT");
+        return Config {
+            /* threshold_us */ threshold ? std::strtoll(threshold, nullptr, 10) : 100,
+            /* pipe_path    */ std::getenv("TRACER_IO_PIPE"),
+            /* output_file  */ output ? output : "trace_io.json",
+        };
+    }();
+    return config;
+}
+
+/// @brief Set while the shim itself is running, so the exporter's own I/O isn't traced. Threads
+/// the exporter starts (e.g. the gzip writer) are skipped too: their slice would wait for the
+/// exporter lock that the thread handing them work holds.
+thread_local bool is_in_hook { false };
+
+/// @brief Cleared right before the exporter is destroyed at exit.
+///
+/// Constructed after the exporter, so it's destroyed before it: I/O done during static destruction
+/// (e.g. the exporter flushing its own file) is never routed back into a dead exporter. Checked on
+/// every call, a copy taken at the first one would stay true.
+struct ExporterLifetime {
+    bool is_alive { true };
+    ~ExporterLifetime() { is_alive = false; }
+};
+
+template <class T>
+const ExporterLifetime& init_exporter(T& /* exporter */)
+{
+    static ExporterLifetime lifetime;
+    return lifetime;
+}
+
+void emit(const char* name, int64_t start, int64_t dur, int fd, ssize_t bytes)
+{
+    Tracer::EventArgs args {};
+    args.add("fd", fd);
+    if (bytes >= 0) {
+        args.add("bytes", bytes);
+    }
+
+    if (config().pipe_path != nullptr) {
+        static const ExporterLifetime& lifetime = init_exporter(IPCExporter::instance(config().pipe_path));
+        if (lifetime.is_alive) {
+            Tracer::write_complete_event<IPCExporter>(name, "io", start, dur, args);
+        }
+    } else {
+        static const ExporterLifetime& lifetime = init_exporter(FileExporter::instance(config().output_file));
+        if (lifetime.is_alive) {
+            Tracer::write_complete_event<FileExporter>(name, "io", start, dur, args);
+        }
+    }
+}
+
+template <class Fn>
+Fn next_symbol(const char* name)
+{
+    return reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+}
+
+/// @brief Call the real function and emit a slice if it took longer than the threshold
+template <class Result, class... Args>
+Result traced_call(const char* name, Result (*real)(int, Args...), int fd, Args... args)
+{
+    if (is_in_hook || Tracer::is_exporter_thread()) {
+        return real(fd, args...);
+    }
+
+    const int64_t start = Tracer::get_unique_timestamp();
+    const Result result = real(fd, args...);
+    const int64_t dur = Tracer::get_unique_timestamp() - start;
+
+    if (dur >= config().threshold_us) {
+        const int saved_errno = errno;
+        is_in_hook = true;
+        // Only read/write style calls return a byte count
+        const ssize_t bytes = std::is_same<Result, ssize_t>::value ? static_cast<ssize_t>(result) : -1;
+        try {
+            emit(name, start, dur, fd, bytes);
+        } catch (...) {
+            // Never let tracing break the traced call
+        }
+        is_in_hook = false;
+        errno = saved_errno;
+    }
+    return result;
+}
+
+} // namespace
+
+extern "C" {
+
+ssize_t read(int fd, void* buf, size_t count)
+{
+    static const auto real = next_symbol<ssize_t (*)(int, void*, size_t)>("read");
+    return traced_call("read", real, fd, buf, count);
+}
+
+ssize_t write(int fd, const void* buf, size_t count)
+{
+    static const auto real = next_symbol<ssize_t (*)(int, const void*, size_t)>("write");
+    return traced_call("write", real, fd, buf, count);
+}
+
+ssize_t pread(int fd, void* buf, size_t count, off_t offset)
+{
+    static const auto real = next_symbol<ssize_t (*)(int, void*, size_t, off_t)>("pread");
+    return traced_call("pread", real, fd, buf, count, offset);
+}
+
+ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset)
+{
+    static const auto real = next_symbol<ssize_t (*)(int, const void*, size_t, off_t)>("pwrite");
+    return traced_call("pwrite", real, fd, buf, count, offset);
+}
+
+int fsync(int fd)
+{
+    static const auto real = next_symbol<int (*)(int)>("fsync");
+    return traced_call("fsync", real, fd);
+}
+
+int fdatasync(int fd)
+{
+    static const auto real = next_symbol<int (*)(int)>("fdatasync");
+    return traced_call("fdatasync", real, fd);
+}
+
+ssize_t recv(int fd, void* buf, size_t count, int flags)
+{
+    static const auto real = next_symbol<ssize_t (*)(int, void*, size_t, int)>("recv");
+    return traced_call("recv", real, fd, buf, count, flags);
+}
+
+ssize_t send(int fd, const void* buf, size_t count, int flags)
+{
+    static const auto real = next_symbol<ssize_t (*)(int, const void*, size_t, int)>("send");
+    return traced_call("send", real, fd, buf, count, flags);
+}
+
+} // extern "C"
@@ -0,0 +1,170 @@
+#include <Profiler/exporters/gzip_writer.hpp>
+#include <Profiler/macros.hpp>
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <print>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h> // posix_spawn
+#include <sys/socket.h>
+#include <sys/wait.h> // waitpid
+#include <unistd.h>
+
+extern char** environ;
+
+// Run with libtracer_io_preload.so preloaded. I/O slices are emitted by the shim, the manual scopes
+// by the profiler linked into this binary: both share the same clock.
+//
+// The shim writes its trace when the process exits, so the test runs the I/O in a child process
+// with its own TRACER_IO_OUTPUT and checks the child's trace afterwards.
+
+constexpr const char* WORKLOAD_OUTPUT { "trace_io_preload.workload.json" };
+constexpr const char* GZIP_WORKLOAD_OUTPUT { "trace_io_preload.workload.json.gz" };
+
+size_t count_in_trace(const char* path, const std::string& pattern)
+{
+    std::ifstream in { path };
+    std::stringstream content;
+    content << in.rdbuf();
+    const std::string text = content.str();
+
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+bool file_io(const char* path)
+{
+    TRACE_FN_CAT("io_test");
+    const int fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    std::array<char, 4096> buffer {};
+    buffer.fill('x');
+
+    bool is_ok = true;
+    for (int i = 0; i < 8; ++i) {
+        is_ok &= write(fd, buffer.data(), buffer.size()) == static_cast<ssize_t>(buffer.size());
+    }
+    is_ok &= fsync(fd) == 0;
+    is_ok &= fdatasync(fd) == 0;
+    is_ok &= pread(fd, buffer.data(), buffer.size(), 0) == static_cast<ssize_t>(buffer.size());
+    is_ok &= pwrite(fd, buffer.data(), buffer.size(), 0) == static_cast<ssize_t>(buffer.size());
+    is_ok &= lseek(fd, 0, SEEK_SET) == 0;
+    is_ok &= read(fd, buffer.data(), buffer.size()) == static_cast<ssize_t>(buffer.size());
+    close(fd);
+    unlink(path);
+    return is_ok;
+}
+
+bool socket_io()
+{
+    TRACE_FN_CAT("io_test");
+    std::array<int, 2> fds {};
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data()) != 0) {
+        return false;
+    }
+    const char message[] = "ping";
+    std::array<char, sizeof(message)> buffer {};
+
+    bool is_ok = send(fds[0], message, sizeof(message), 0) == static_cast<ssize_t>(sizeof(message));
+    is_ok &= recv(fds[1], buffer.data(), buffer.size(), 0) == static_cast<ssize_t>(sizeof(message));
+    close(fds[0]);
+    close(fds[1]);
+    return is_ok;
+}
+
+int workload()
+{
+    TRACE_SETUP("trace_io_test.json");
+    TRACE_FN();
+
+    std::println("1. Testing file I/O...");
+    if (!file_io("io_test.bin")) {
+        std::println(stderr, "File I/O failed");
+        return 1;
+    }
+
+    std::println("2. Testing socket I/O...");
+    if (!socket_io()) {
+        std::println(stderr, "Socket I/O failed");
+        return 1;
+    }
+
+    return 0;
+}
+
+/// @brief Run this binary with --workload and the shim writing to `output_file`
+bool run_workload(const char* self, const char* output_file)
+{
+    const std::string output = std::string("TRACER_IO_OUTPUT=") + output_file;
+    std::vector<char*> env;
+    for (char** var = environ; *var != nullptr; ++var) {
+        if (!std::string_view(*var).starts_with("TRACER_IO_OUTPUT=")) {
+            env.push_back(*var);
+        }
+    }
+    env.push_back(const_cast<char*>(output.c_str()));
+    env.push_back(nullptr);
+
+    std::array<char*, 3> args { const_cast<char*>(self), const_cast<char*>("--workload"), nullptr };
+    pid_t pid {};
+    if (posix_spawn(&pid, self, nullptr, nullptr, args.data(), env.data()) != 0) {
+        return false;
+    }
+    int status {};
+    return waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && std::string_view(argv[1]) == "--workload") {
+        return workload();
+    }
+    if (!run_workload(argv[0], WORKLOAD_OUTPUT)) {
+        return 1;
+    }
+
+    std::println("3. Testing the I/O slices...");
+    const auto slices = [](const char* name) {
+        return count_in_trace(WORKLOAD_OUTPUT, std::string(R"({"name":")") + name + R"(","cat":"io")");
+    };
+    if (count_in_trace(WORKLOAD_OUTPUT, R"("bytes":4096)") < 11 || slices("write") < 8) {
+        std::println(stderr, "Expected the 8 file writes, pread, pwrite and read as io slices");
+        return 1;
+    }
+    for (const char* name : { "fsync", "fdatasync", "pread", "pwrite", "read", "send", "recv" }) {
+        if (slices(name) == 0) {
+            std::println(stderr, "Expected a {} slice", name);
+            return 1;
+        }
+    }
+    // The shim has its own exporter, the application's scopes are in the application's trace
+    const char* scope = R"("name":"file_io","cat":"io_test")";
+    if (count_in_trace("trace_io_test.json", scope) != 1 || count_in_trace(WORKLOAD_OUTPUT, scope) != 0) {
+        std::println(stderr, "Expected the manual scopes in the application's own trace only");
+        return 1;
+    }
+
+    // The gzip thread's writes would wait for the exporter lock held by the thread feeding it
+    if (Tracer::GzipWriter::is_supported()) {
+        std::println("4. Testing a compressed trace...");
+        if (!run_workload(argv[0], GZIP_WORKLOAD_OUTPUT) || std::ifstream(GZIP_WORKLOAD_OUTPUT).peek() == EOF) {
+            std::println(stderr, "The shim didn't write a compressed trace");
+            return 1;
+        }
+    }
+
+    std::println("\nI/O preload test complete.");
+    return 0;
+}
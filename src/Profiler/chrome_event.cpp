@@ -1,23 +1,164 @@
 #include "chrome_event.hpp"
 
 #include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <mutex>
 #include <sstream>
+#include <string_view>
+#include <unordered_set>
 
 namespace Tracer {
 
-std::string serialize_to_json(const ChromeEvent& event)
+const char* intern(const char* value, size_t length)
 {
-    std::string event_name = event.name;
-    if (event.name.find('"') != std::string::npos) {
-        std::string sanitized;
-        std::replace_copy(event.name.begin(), event.name.end(), std::back_inserter(sanitized), '"', '\'');
-        event_name = std::move(sanitized);
+    // Leaked on purpose: exporters may still serialize interned strings during static destruction.
+    static std::mutex* lock = new std::mutex;
+    static auto* storage = new std::deque<std::string>;
+    static auto* table = new std::unordered_set<std::string_view>;
+
+    const std::string_view key { value, length };
+
+    std::lock_guard<std::mutex> guard(*lock);
+    if (const auto it = table->find(key); it != table->end()) {
+        return it->data();
+    }
+    const std::string& stored = storage->emplace_back(key);
+    table->emplace(stored);
+    return stored.c_str();
+}
+
+namespace {
+    /// @brief Write a JSON string literal, escaped as RFC 8259 asks
+    void write_json_string(std::ostream& out, std::string_view value)
+    {
+        static constexpr const char* HEX_DIGITS { "0123456789abcdef" };
+        out << '"';
+        // Runs that need no escape are written at once, names rarely have any
+        size_t run = 0;
+        for (size_t i = 0; i < value.size(); ++i) {
+            const auto c = static_cast<unsigned char>(value[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+            out << value.substr(run, i - run);
+            run = i + 1;
+            switch (c) {
+            case '"':
+                out << R"(\")";
+                break;
+            case '\\':
+                out << R"(\\)";
+                break;
+            case '\n':
+                out << R"(\n)";
+                break;
+            case '\r':
+                out << R"(\r)";
+                break;
+            case '\t':
+                out << R"(\t)";
+                break;
+            default:
+                out << R"(\u00)" << HEX_DIGITS[c >> 4] << HEX_DIGITS[c & 0xf];
+                break;
+            }
+        }
+        out << value.substr(run) << '"';
+    }
+
+    void write_json_args(std::ostream& out, const EventArgs& args)
+    {
+        out << R"(,"args":{)";
+        bool is_first = true;
+        for (const EventArg& arg : args) {
+            std::ignore = !is_first && out << ',';
+            is_first = false;
+
+            write_json_string(out, arg.key);
+            out << ':';
+            switch (arg.type) {
+            case EventArg::Type::INT:
+                out << arg.i;
+                break;
+            case EventArg::Type::DOUBLE:
+                // JSON has no representation for NaN or infinity
+                std::ignore = std::isfinite(arg.d) ? out << arg.d : out << "null";
+                break;
+            case EventArg::Type::STRING:
+                write_json_string(out, arg.s);
+                break;
+            case EventArg::Type::ID: {
+                char id[19];
+                std::snprintf(id, sizeof(id), "\"%016" PRIx64 "\"", arg.id);
+                out << id;
+                break;
+            }
+            }
+        }
+        out << '}';
+    }
+
+    template <class T>
+    void write_binary(std::ostream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <class T>
+    void read_binary(std::istream& in, T& value)
+    {
+        in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    }
+
+    void write_binary_string(std::ostream& out, const char* value)
+    {
+        const size_t length = std::char_traits<char>::length(value);
+        write_binary(out, length);
+        out.write(value, static_cast<std::streamsize>(length));
     }
 
+    const char* read_binary_string(std::istream& in, std::string& buffer)
+    {
+        // Keys and values are short labels, anything larger is a corrupted stream
+        static constexpr size_t MAX_LENGTH { 4096 };
+
+        size_t length {};
+        read_binary(in, length);
+        if (!in || length > MAX_LENGTH) {
+            in.setstate(std::ios::failbit);
+            return "";
+        }
+        buffer.resize(length);
+        in.read(&buffer[0], static_cast<std::streamsize>(length));
+        return intern(buffer);
+    }
+} // namespace
+
+std::string serialize_to_json(const ChromeEvent& event)
+{
     std::stringstream ss;
-    ss << R"({"name":")" << event_name << R"(","cat":")" << event.cat << R"(","ph":")" << event.ph
-       << R"(","ts":)" << event.ts << R"(,"pid":)" << event.pid << R"(,"tid":)" << event.tid
-       << R"(,"dur":)" << event.dur << "}";
+    ss << R"({"name":)";
+    write_json_string(ss, event.name);
+    ss << R"(,"cat":)";
+    write_json_string(ss, event.cat);
+    ss << R"(,"ph":")" << event.ph
+       << R"(","ts":)" << event.ts << R"(,"pid":)" << event.pid << R"(,"tid":)" << event.tid;
+    if (event.ph == 'X') {
+        ss << R"(,"dur":)" << event.dur;
+    }
+    if (is_async_phase(event.ph) || is_flow_phase(event.ph)) {
+        ss << R"(,"id":"0x)" << std::hex << event.id << std::dec << '"';
+    }
+    if (event.ph == 'f') {
+        ss << R"(,"bp":"e")";
+    }
+    if (!event.args.empty()) {
+        write_json_args(ss, event.args);
+    }
+    ss << "}";
     return ss.str();
 }
 
@@ -30,6 +171,28 @@ std::ostream& serialize_to_stream(std::ostream& out, const ChromeEvent& event)
     out << event.pid << '\n';
     out << event.tid << '\n';
     out << event.dur << '\n';
+    out << event.id << '\n';
+
+    // Arguments travel in binary form after the text fields
+    write_binary(out, event.args.count);
+    for (const EventArg& arg : event.args) {
+        write_binary_string(out, arg.key);
+        write_binary(out, arg.type);
+        switch (arg.type) {
+        case EventArg::Type::INT:
+            write_binary(out, arg.i);
+            break;
+        case EventArg::Type::DOUBLE:
+            write_binary(out, arg.d);
+            break;
+        case EventArg::Type::STRING:
+            write_binary_string(out, arg.s);
+            break;
+        case EventArg::Type::ID:
+            write_binary(out, arg.id);
+            break;
+        }
+    }
     return out;
 }
 
@@ -40,7 +203,50 @@ std::istream& deserialize_from_stream(std::istream& in, ChromeEvent& event)
     std::getline(in, event.cat);
     in >> event.ph;
     in.ignore(); // consume newline after ph
-    in >> event.ts >> event.pid >> event.tid >> event.dur;
+    in >> event.ts >> event.pid >> event.tid >> event.dur >> event.id;
+    in.ignore(); // consume newline after id
+
+    event.args = {};
+    if (in.peek() == std::istream::traits_type::eof()) {
+        // Events without arguments section
+        in.clear(in.rdstate() & ~std::ios::eofbit);
+        return in;
+    }
+
+    uint8_t count {};
+    read_binary(in, count);
+    std::string buffer;
+    for (uint8_t i = 0; i < count && in; ++i) {
+        const char* key = read_binary_string(in, buffer);
+        EventArg::Type type {};
+        read_binary(in, type);
+        switch (type) {
+        case EventArg::Type::INT: {
+            int64_t value {};
+            read_binary(in, value);
+            event.args.add(key, value);
+            break;
+        }
+        case EventArg::Type::DOUBLE: {
+            double value {};
+            read_binary(in, value);
+            event.args.add(key, value);
+            break;
+        }
+        case EventArg::Type::STRING:
+            event.args.add(key, read_binary_string(in, buffer));
+            break;
+        case EventArg::Type::ID: {
+            uint64_t value {};
+            read_binary(in, value);
+            event.args.add_id(key, value);
+            break;
+        }
+        default:
+            in.setstate(std::ios::failbit);
+            break;
+        }
+    }
     return in;
 }
 
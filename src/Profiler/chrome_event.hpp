@@ -1,6 +1,9 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <string>
+#include <type_traits>
 
 namespace Tracer {
 
@@ -27,6 +30,121 @@ static constexpr const char* TRACE_EVENT_BODY {
     R"(],"displayTimeUnit":"ns"})"
 };
 
+/// @brief Intern a string in the process-wide string table.
+///
+/// Returns a pointer that stays valid for the lifetime of the process. Repeated calls with the same
+/// content return the same pointer, so only the first occurrence of a string allocates.
+const char* intern(const char* value, size_t length);
+
+inline const char* intern(const std::string& value)
+{
+    return intern(value.data(), value.length());
+}
+
+/// @brief A typed key/value pair attached to an event.
+///
+/// The key must outlive the event (string literals or interned strings). String values are interned,
+/// so the event never owns heap memory for its arguments, unless the caller keeps them alive itself.
+struct EventArg {
+    enum class Type : uint8_t {
+        INT,
+        DOUBLE,
+        STRING,
+        ID,
+    };
+
+    const char* key;
+    Type type;
+    union {
+        int64_t i;
+        double d;
+        const char* s;
+        uint64_t id; // written as 16 hex digits, like TraceContext::to_header()
+    };
+};
+
+/// @brief Fixed-capacity list of event arguments stored inline in the event record.
+///
+/// Arguments beyond CAPACITY are silently dropped.
+struct EventArgs {
+    static constexpr size_t CAPACITY { 4 };
+
+    std::array<EventArg, CAPACITY> items;
+    uint8_t count { 0 };
+
+    bool empty() const { return count == 0; }
+    const EventArg* begin() const { return items.data(); }
+    const EventArg* end() const { return items.data() + count; }
+
+    template <class V, typename std::enable_if<std::is_integral<V>::value, int>::type = 0>
+    void add(const char* key, V value)
+    {
+        if (EventArg* arg = next(key, EventArg::Type::INT)) {
+            arg->i = static_cast<int64_t>(value);
+        }
+    }
+
+    template <class V, typename std::enable_if<std::is_floating_point<V>::value, int>::type = 0>
+    void add(const char* key, V value)
+    {
+        if (EventArg* arg = next(key, EventArg::Type::DOUBLE)) {
+            arg->d = static_cast<double>(value);
+        }
+    }
+
+    void add(const char* key, const char* value)
+    {
+        if (EventArg* arg = next(key, EventArg::Type::STRING)) {
+            arg->s = intern(value, std::char_traits<char>::length(value));
+        }
+    }
+
+    void add(const char* key, const std::string& value)
+    {
+        if (EventArg* arg = next(key, EventArg::Type::STRING)) {
+            arg->s = intern(value);
+        }
+    }
+
+    /// @brief Add an identifier, a string in JSON that doesn't take a place in the string table
+    void add_id(const char* key, uint64_t value)
+    {
+        if (EventArg* arg = next(key, EventArg::Type::ID)) {
+            arg->id = value;
+        }
+    }
+
+    /// @brief Add a string value without interning it, the caller keeps key and value alive
+    void add_unowned(const char* key, const char* value)
+    {
+        if (EventArg* arg = next(key, EventArg::Type::STRING)) {
+            arg->s = value;
+        }
+    }
+
+private:
+    EventArg* next(const char* key, EventArg::Type type)
+    {
+        if (count >= CAPACITY) {
+            return nullptr;
+        }
+        EventArg& arg = items[count++];
+        arg.key = key;
+        arg.type = type;
+        return &arg;
+    }
+};
+
+inline void add_args(EventArgs& /* args */) { }
+
+/// @brief Append key/value pairs to args: add_args(args, "bytes", 1024, "shard", "eu-1")
+template <class V, class... Rest>
+void add_args(EventArgs& args, const char* key, const V& value, const Rest&... rest)
+{
+    args.add(key, value);
+    add_args(args, rest...);
+}
+
 /// @brief Catapult - Trace Event Format
 /// @ref https://chromium.googlesource.com/catapult/+/HEAD/docs/trace-event-format.md
 ///
@@ -44,6 +162,11 @@ static constexpr const char* TRACE_EVENT_BODY {
 ///
 ///   An optional parameter tdur specifies the thread clock duration of complete events in
 ///   microseconds.
+///
+/// # Async Events:
+///   Async events are used to specify asynchronous operations. Events with the same category and id
+///   are considered to be from the same event tree, regardless of the thread they were emitted on.
+///   Nestable async events are designated by the b (begin), n (instant) and e (end) phase types.
 struct ChromeEvent {
 
     /// @var name The name of the event, as displayed in Trace Viewer
@@ -69,20 +192,37 @@ struct ChromeEvent {
     /// @var dur to specify the tracing clock duration of complete events in microseconds
     int64_t dur;
 
-    /// @var tts? The thread clock timestamp of the event. The timestamps are provided at
-    /// microsecond granularity.
-    // int64_t tts {};
-    //
+    /// @var id Correlates async events (b/n/e) that belong to the same operation. Only serialized for
+    /// the phases that use it.
+    uint64_t id;
+
     /// @var args Any arguments provided for the event. Some of the event types have required
     /// argument fields, otherwise, you can put any information you wish in here. The arguments are
     /// displayed in Trace Viewer when you view an event in the analysis section.
-    // char* args;
+    EventArgs args;
+
+    /// @var tts? The thread clock timestamp of the event. The timestamps are provided at
+    /// microsecond granularity.
+    // int64_t tts {};
     //
     /// @var cname? A fixed color name to associate with the event. If provided, cname must be one
     /// of the names listed in trace-viewer's base color scheme's reserved color names list.
     // char* cname { };
 };
 
+/// @brief Whether the event phase is an async one, correlated by ChromeEvent::id
+inline bool is_async_phase(char ph)
+{
+    return ph == 'b' || ph == 'n' || ph == 'e';
+}
+
+/// @brief Whether the event phase is a flow one, linking slices of any process by ChromeEvent::id.
+/// Flow ends ('f') bind to the slice enclosing them rather than to the next one.
+inline bool is_flow_phase(char ph)
+{
+    return ph == 's' || ph == 't' || ph == 'f';
+}
+
 /// @brief Serialize ChromeEvent to JSON format
 /// @param event The event to serialize
 /// @return JSON string representation
@@ -0,0 +1,107 @@
+#include "control.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <string_view>
+
+namespace Tracer {
+
+std::atomic<Control::Mode> Control::s_mode { Control::Mode::ALL };
+
+namespace {
+    [[maybe_unused]] const bool is_configured_from_environment = [] {
+        const char* value = std::getenv("TRACER_START_DISABLED");
+        if (value != nullptr && std::string_view(value) != "0") {
+            Control::instance().apply("tracing=off");
+            return true;
+        }
+        return false;
+    }();
+
+    /// @brief Whether one of the comma separated categories is in the list
+    bool matches(const std::vector<std::string>& categories, std::string_view cat)
+    {
+        while (true) {
+            const size_t end = cat.find(',');
+            const std::string_view name = cat.substr(0, end);
+            for (const std::string& category : categories) {
+                if (name == category) {
+                    return true;
+                }
+            }
+            if (end == std::string_view::npos) {
+                return false;
+            }
+            cat.remove_prefix(end + 1);
+        }
+    }
+} // namespace
+
+Control& Control::instance()
+{
+    static Control instance;
+    return instance;
+}
+
+bool Control::check(const char* cat, bool is_sampled) const
+{
+    const Categories* categories = m_categories.load(std::memory_order_acquire);
+    if (categories != nullptr && !matches(*categories, cat)) {
+        return false;
+    }
+    const uint32_t one_in = m_one_in.load(std::memory_order_relaxed);
+    if (!is_sampled || one_in <= 1) {
+        return true;
+    }
+    static thread_local uint32_t scopes = 0;
+    return ++scopes % one_in == 0;
+}
+
+bool Control::apply(const std::string& record)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    bool is_snapshot_requested = false;
+    std::istringstream fields(record);
+    std::string field;
+    while (fields >> field) {
+        const size_t separator = field.find('=');
+        if (separator == std::string::npos) {
+            continue;
+        }
+        const std::string key = field.substr(0, separator);
+        const std::string value = field.substr(separator + 1);
+        if (key == "tracing") {
+            m_is_enabled.store(value != "off", std::memory_order_relaxed);
+        } else if (key == "sample") {
+            m_one_in.store(static_cast<uint32_t>(std::max(std::strtoul(value.c_str(), nullptr, 10), 1UL)), std::memory_order_relaxed);
+        } else if (key == "categories") {
+            const Categories* categories = nullptr;
+            if (value != "*") {
+                auto list = std::make_unique<Categories>();
+                std::istringstream names(value);
+                std::string name;
+                while (std::getline(names, name, ',')) {
+                    list->push_back(name);
+                }
+                categories = list.get();
+                m_category_lists.push_back(std::move(list));
+            }
+            m_categories.store(categories, std::memory_order_release);
+        } else if (key == "snapshot") {
+            const uint64_t snapshot = std::strtoull(value.c_str(), nullptr, 10);
+            is_snapshot_requested = snapshot > m_snapshot;
+            m_snapshot = std::max(m_snapshot, snapshot);
+        }
+    }
+    Mode mode = Mode::ALL;
+    if (!m_is_enabled.load(std::memory_order_relaxed)) {
+        mode = Mode::NONE;
+    } else if (m_one_in.load(std::memory_order_relaxed) > 1 || m_categories.load(std::memory_order_relaxed) != nullptr) {
+        mode = Mode::FILTERED;
+    }
+    s_mode.store(mode, std::memory_order_relaxed);
+    return is_snapshot_requested;
+}
+
+} // namespace Tracer
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Tracer {
+
+/// @brief Tracing state of an IPC client, set by the TraceCollector over the control channel.
+///
+/// The collector sends records like "tracing=on categories=io,db sample=10 snapshot=2", which are
+/// applied to atomics that IPC scopes and events check before doing any work. While everything or
+/// nothing is traced the check is a single relaxed load, only category filters and sampling take
+/// a slower path. Clients start with tracing on, or off when TRACER_START_DISABLED=1 is set, so nothing is
+/// traced until the collector starts them.
+class Control {
+public:
+    static Control& instance();
+
+    /// @brief Whether events of the comma separated categories `cat` are traced
+    static bool allows(const char* cat)
+    {
+        const Mode mode = s_mode.load(std::memory_order_relaxed);
+        return mode == Mode::ALL || (mode == Mode::FILTERED && instance().check(cat, false));
+    }
+
+    /// @brief Like allows(), also counting the scope against the sampling rate
+    static bool samples(const char* cat)
+    {
+        const Mode mode = s_mode.load(std::memory_order_relaxed);
+        return mode == Mode::ALL || (mode == Mode::FILTERED && instance().check(cat, true));
+    }
+
+    /// @brief Apply a state record, keys it doesn't know are ignored.
+    ///
+    /// @return Whether the record requests a snapshot the client didn't take yet
+    bool apply(const std::string& record);
+
+    bool is_enabled() const { return m_is_enabled.load(std::memory_order_relaxed); }
+    uint32_t sample_one_in() const { return m_one_in.load(std::memory_order_relaxed); }
+
+private:
+    enum class Mode : uint8_t {
+        ALL,
+        NONE,
+        FILTERED, // by category or sampling
+    };
+
+    using Categories = std::vector<std::string>;
+
+    Control() = default;
+
+    bool check(const char* cat, bool is_sampled) const;
+
+    static std::atomic<Mode> s_mode;
+
+    std::atomic_bool m_is_enabled { true };
+    std::atomic<uint32_t> m_one_in { 1 };
+
+    /// @var m_categories Traced categories, nullptr for all. Replaced lists are kept in
+    /// m_category_lists, a scope may still be reading them.
+    std::atomic<const Categories*> m_categories { nullptr };
+
+    std::mutex m_lock;
+    std::vector<std::unique_ptr<Categories>> m_category_lists;
+    uint64_t m_snapshot { 0 };
+};
+
+} // namespace Tracer
@@ -0,0 +1,122 @@
+#pragma once
+
+// Requires C++20. Kept out of macros.hpp so C++14/17 clients are unaffected.
+
+#include <Profiler/trace.hpp>
+
+#include <coroutine>
+#include <utility>
+
+namespace Tracer {
+
+namespace detail {
+    /// @brief Resolve the awaiter of an awaitable the same way co_await does
+    template <class A>
+    decltype(auto) get_awaiter(A&& awaitable)
+    {
+        if constexpr (requires { std::forward<A>(awaitable).operator co_await(); }) {
+            return std::forward<A>(awaitable).operator co_await();
+        } else if constexpr (requires { operator co_await(std::forward<A>(awaitable)); }) {
+            return operator co_await(std::forward<A>(awaitable));
+        } else {
+            return std::forward<A>(awaitable);
+        }
+    }
+} // namespace detail
+
+/// @brief Awaiter wrapper that closes the span's running step before suspending and reopens it on
+/// resumption, on whatever thread the coroutine resumes.
+///
+/// When the awaitable is its own awaiter, m_awaiter refers to m_awaitable, so the wrapper can't be
+/// copied or moved. traced() returns it as a prvalue, which co_await consumes in place.
+template <class T, class A>
+class TracedAwaiter {
+    using Awaiter = decltype(detail::get_awaiter(std::declval<A&&>()));
+
+public:
+    TracedAwaiter(AsyncSpan<T>& span, const char* step, A&& awaitable)
+        : m_span(span)
+        , m_step(step)
+        , m_awaitable(std::forward<A>(awaitable))
+        , m_awaiter(detail::get_awaiter(std::forward<A>(m_awaitable)))
+    {
+    }
+
+    TracedAwaiter(const TracedAwaiter&) = delete;
+    TracedAwaiter(TracedAwaiter&&) = delete;
+    TracedAwaiter& operator=(const TracedAwaiter&) = delete;
+    TracedAwaiter& operator=(TracedAwaiter&&) = delete;
+
+    bool await_ready() { return m_awaiter.await_ready(); }
+
+    template <class Promise>
+    decltype(auto) await_suspend(std::coroutine_handle<Promise> handle)
+    {
+        // The coroutine may be resumed on another thread before await_suspend returns, so the step
+        // has to be closed before handing the handle over.
+        m_span.end_step(m_step);
+        m_is_suspended = true;
+        return m_awaiter.await_suspend(handle);
+    }
+
+    decltype(auto) await_resume()
+    {
+        // Ready awaitables resume without passing through await_suspend, the step is still open
+        if (m_is_suspended) {
+            m_span.begin_step(m_step);
+        }
+        return m_awaiter.await_resume();
+    }
+
+private:
+    AsyncSpan<T>& m_span;
+    const char* m_step;
+    bool m_is_suspended { false };
+    A m_awaitable;
+    Awaiter m_awaiter;
+};
+
+/// @brief Async span for a coroutine body.
+///
+/// Covers the logical operation from creation until destruction, with a nested "running" step for
+/// every stretch where the coroutine actually executes. Suspension points must be wrapped with
+/// traced() so the running steps are closed and reopened around them:
+///
+///     Task<size_t> fetch(int fd)
+///     {
+///         Tracer::CoroutineSpan<> span("fetch", "io");
+///         auto data = co_await span.traced(read_async(fd));
+///         co_return data.size();
+///     }
+template <class T = FileExporter>
+class CoroutineSpan {
+public:
+    static constexpr const char* RUNNING { "running" };
+
+    CoroutineSpan(const char* name, const char* cat = "Default", uint64_t id = next_async_id())
+        : m_span(name, cat, id)
+    {
+        m_span.begin_step(RUNNING);
+    }
+
+    CoroutineSpan(const CoroutineSpan&) = delete;
+    CoroutineSpan& operator=(const CoroutineSpan&) = delete;
+
+    ~CoroutineSpan() { m_span.end_step(RUNNING); }
+
+    template <class A>
+    TracedAwaiter<T, A> traced(A&& awaitable)
+    {
+        return TracedAwaiter<T, A>(m_span, RUNNING, std::forward<A>(awaitable));
+    }
+
+    AsyncSpan<T>& span() { return m_span; }
+
+private:
+    AsyncSpan<T> m_span;
+};
+
+using CoroutineTrace = CoroutineSpan<FileExporter>;
+using IPCCoroutineTrace = CoroutineSpan<IPCExporter>;
+
+} // namespace Tracer
@@ -1,6 +1,13 @@
 #include "file_exporter.hpp"
 
+#include <Profiler/exporters/flight_recorder.hpp>
+#include <Profiler/exporters/gzip_writer.hpp>
+#include <Profiler/exporters/mapped_writer.hpp>
+#include <Profiler/shutdown_hooks.hpp>
+
 #include <atomic>
+#include <iostream>
+#include <stdexcept>
 
 namespace Tracer {
 
@@ -10,33 +17,122 @@ FileExporter& FileExporter::instance(const char* output_file)
     return instance;
 }
 
+namespace {
+    bool is_gzip_path(const std::string& path)
+    {
+        const std::string suffix { ".gz" };
+        return path.size() > suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+} // namespace
+
 FileExporter::FileExporter(const char* output_file)
-    : m_trace_stream(std::ofstream(output_file))
+    : m_output_file(output_file)
 {
-    if (!m_trace_stream.is_open()) {
-        throw std::runtime_error("Failed to open trace output file.");
+    if (is_gzip_path(m_output_file)) {
+        if (!GzipWriter::is_supported()) {
+            throw std::runtime_error("Gzip trace output requires the tracer to be built with zlib.");
+        }
+        m_gzip.reset(new GzipWriter(m_output_file));
+        if (!m_gzip->is_open()) {
+            throw std::runtime_error("Failed to open trace output file.");
+        }
+    } else {
+        m_mapped.reset(new MappedWriter(m_output_file, std::string("\n") + TRACE_EVENT_BODY));
+        if (!m_mapped->is_open()) {
+            m_mapped.reset();
+            m_trace_stream.open(output_file);
+        }
+        if (!m_mapped && !m_trace_stream.is_open()) {
+            throw std::runtime_error("Failed to open trace output file.");
+        }
     }
-    m_trace_stream << TRACE_EVENTS;
+    write(TRACE_EVENTS);
 }
 
 FileExporter::~FileExporter()
 {
-    m_trace_stream << '\n'
-                   << TRACE_EVENT_BODY;
+    run_shutdown_hooks([this](const ChromeEvent& event) { push_trace(event); });
+    // Flight recorder dumps are written with async-signal-safe calls only, always as plain JSON
+    if (FlightRecorder::is_active()) {
+        if (m_gzip) {
+            m_gzip->close();
+        }
+        if (m_mapped) {
+            m_mapped->close();
+        }
+        m_trace_stream.close();
+        FlightRecorder::instance().dump_to(m_output_file.c_str());
+        return;
+    }
+    if (m_mapped) {
+        // The footer is always in place
+        m_mapped->close();
+        return;
+    }
+    std::string footer { "\n" };
+    footer += TRACE_EVENT_BODY;
+    write(footer);
+    if (m_dropped_writes != 0) {
+        std::cerr << "Warning: " << m_dropped_writes << " trace writes to " << m_output_file << " failed.\n";
+    }
+}
+
+void FileExporter::write(const std::string& text)
+{
+    if (m_gzip) {
+        m_gzip->write(text);
+        return;
+    }
+    if (m_mapped) {
+        if (m_mapped->append(text)) {
+            return;
+        }
+        fall_back_to_stream();
+    }
+    if (!m_trace_stream.is_open() || !(m_trace_stream << text)) {
+        ++m_dropped_writes;
+    }
+}
+
+void FileExporter::fall_back_to_stream()
+{
+    std::cerr << "Warning: Failed to grow the mapped trace file " << m_output_file << ", writing it as a stream.\n";
+    const bool is_detached = m_mapped->detach();
+    m_mapped.reset();
+    // A file that still ends with the footer can't be continued, the events before it stay valid
+    if (is_detached) {
+        m_trace_stream.open(m_output_file, std::ios::app);
+    }
+}
+
+void FileExporter::enable_flight_recorder(size_t capacity)
+{
+    FlightRecorder::instance().start(m_output_file.c_str(), capacity);
+}
+
+bool FileExporter::dump_flight_recorder()
+{
+    return FlightRecorder::instance().dump();
 }
 
 void FileExporter::push_trace(const ChromeEvent& result)
 {
-    static std::atomic_bool is_first_event { true };
+    if (FlightRecorder::is_active()) {
+        FlightRecorder::instance().record(result);
+        return;
+    }
 
-    const auto json = serialize_to_json(result);
+    push_json(serialize_to_json(result));
+}
+
+void FileExporter::push_json(const std::string& json)
+{
+    static std::atomic_bool is_first_event { true };
 
     std::lock_guard<std::mutex> lock(m_lock);
     {
         bool is_first = is_first_event.exchange(false);
-        std::ignore = !is_first && m_trace_stream << ',';
-        m_trace_stream << '\n'
-                       << json;
+        write(is_first ? "\n" + json : ",\n" + json);
     }
 }
 
@@ -3,24 +3,59 @@
 #include <Profiler/chrome_event.hpp>
 
 #include <fstream>
+#include <memory>
 #include <mutex>
+#include <string>
 
 namespace Tracer {
 
+class GzipWriter;
+class MappedWriter;
+
+/// @brief Writes the events of the process to a Chrome JSON trace.
+///
+/// Plain JSON goes through a MappedWriter, so the file is a complete trace after every event and
+/// survives a crash of the process. If the file can't be mapped, or the mapping can't grow later
+/// on, it's written as a stream that only gets its footer at shutdown.
+///
+/// An output path ending in ".gz" is written gzip-compressed by a background thread, when the
+/// tracer was built with zlib. Perfetto and the Firefox Profiler load such files directly.
 class FileExporter {
 public:
     static FileExporter& instance(const char* output_file = "trace.json");
 
     void push_trace(const ChromeEvent& result);
 
+    /// @brief Append an event that was already serialized to a JSON object, like the collector's
+    void push_json(const std::string& json);
+
+    /// @brief Keep only the last `capacity` events in memory instead of writing every event.
+    ///
+    /// The ring is dumped on SIGUSR1, on fatal signals and on dump_flight_recorder(); the output
+    /// file receives the ring when the exporter shuts down.
+    void enable_flight_recorder(size_t capacity);
+
+    /// @brief Dump the ring to the next `<output stem>.flight-<n>.json`
+    bool dump_flight_recorder();
+
 private:
     FileExporter(const char* output_file);
 
     ~FileExporter();
 
+    void write(const std::string& text);
+
+    /// @brief Continue the mapped file as a stream, after the mapping failed to grow
+    void fall_back_to_stream();
+
 private:
     std::mutex m_lock;
+    std::string m_output_file;
     std::ofstream m_trace_stream;
+    std::unique_ptr<GzipWriter> m_gzip;
+    std::unique_ptr<MappedWriter> m_mapped;
+    /// @var m_dropped_writes Events that couldn't be written at all, reported at shutdown
+    size_t m_dropped_writes { 0 };
 };
 
 } // namespace Tracer
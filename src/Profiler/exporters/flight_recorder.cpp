@@ -0,0 +1,580 @@
+#include "flight_recorder.hpp"
+
+#include <Profiler/trace.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+namespace Tracer {
+
+namespace {
+    constexpr size_t MAX_NAME_LENGTH { 64 };
+    constexpr size_t MAX_CAT_LENGTH { 32 };
+    constexpr size_t MAX_SCOPE_DEPTH { 64 };
+    constexpr size_t MAX_THREADS { 256 };
+    constexpr size_t ALTERNATE_STACK_SIZE { 64 * 1024 };
+    constexpr int FATAL_SIGNALS[] { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+
+    /// @brief ChromeEvent flattened into fixed-size storage, so a dump never follows a freed pointer
+    struct Record {
+        char name[MAX_NAME_LENGTH];
+        char cat[MAX_CAT_LENGTH];
+        char ph;
+        int64_t ts;
+        int pid;
+        size_t tid;
+        int64_t dur;
+        uint64_t id;
+        EventArgs args; // keys and string values are interned, so they stay valid
+    };
+
+    /// @brief Copied like Record, the scope may be gone by the time a dump reads it
+    struct OpenScope {
+        char name[MAX_NAME_LENGTH] {};
+        char cat[MAX_CAT_LENGTH] {};
+        int64_t start { 0 };
+    };
+
+    /// @brief Scopes currently open on one thread. Stacks are pooled and never freed.
+    struct ScopeStack {
+        std::atomic_bool is_used { false };
+        std::atomic<int> tid { 0 };
+        std::atomic<size_t> depth { 0 };
+        OpenScope scopes[MAX_SCOPE_DEPTH] {};
+    };
+
+    ScopeStack g_scope_stacks[MAX_THREADS];
+    thread_local ScopeStack* t_scope_stack { nullptr };
+
+    /// @brief Returns the scope stack to the pool when its thread exits
+    struct ScopeStackRelease {
+        void arm() { }
+
+        ~ScopeStackRelease()
+        {
+            if (t_scope_stack != nullptr) {
+                t_scope_stack->depth = 0;
+                t_scope_stack->is_used = false;
+                t_scope_stack = nullptr;
+            }
+        }
+    };
+    thread_local ScopeStackRelease t_scope_stack_release;
+
+    ScopeStack* acquire_scope_stack()
+    {
+        for (ScopeStack& stack : g_scope_stacks) {
+            bool is_used = false;
+            if (stack.is_used.compare_exchange_strong(is_used, true)) {
+                stack.tid = get_thread_id();
+                stack.depth = 0;
+                t_scope_stack_release.arm();
+                return &stack;
+            }
+        }
+        return nullptr;
+    }
+
+    /// @brief Signal stack of one thread, so a dump can run after that thread overflowed its stack.
+    /// Installed on the first event of the thread, unless it already has one.
+    struct AlternateStack {
+        char* memory { nullptr };
+        bool is_checked { false };
+
+        void install()
+        {
+            is_checked = true;
+            stack_t current {};
+            if (sigaltstack(nullptr, &current) != 0 || (current.ss_flags & SS_DISABLE) == 0) {
+                return;
+            }
+            memory = new char[ALTERNATE_STACK_SIZE];
+            stack_t stack {};
+            stack.ss_sp = memory;
+            stack.ss_size = ALTERNATE_STACK_SIZE;
+            if (sigaltstack(&stack, nullptr) != 0) {
+                delete[] memory;
+                memory = nullptr;
+            }
+        }
+
+        ~AlternateStack()
+        {
+            if (memory != nullptr) {
+                stack_t disable {};
+                disable.ss_flags = SS_DISABLE;
+                sigaltstack(&disable, nullptr);
+                delete[] memory;
+            }
+        }
+    };
+    thread_local AlternateStack t_alternate_stack;
+
+    void install_alternate_stack()
+    {
+        if (!t_alternate_stack.is_checked) {
+            t_alternate_stack.install();
+        }
+    }
+
+    struct sigaction g_previous_actions[std::size(FATAL_SIGNALS)] {};
+
+    void handle_dump_signal(int /* signal */)
+    {
+        const int saved_errno = errno;
+        FlightRecorder::instance().dump();
+        errno = saved_errno;
+    }
+
+    void handle_fatal_signal(int signal)
+    {
+        FlightRecorder::instance().dump();
+
+        // Hand the signal back to whoever handled it before, or to the default action
+        for (size_t i = 0; i < std::size(FATAL_SIGNALS); ++i) {
+            if (FATAL_SIGNALS[i] == signal) {
+                sigaction(signal, &g_previous_actions[i], nullptr);
+            }
+        }
+        raise(signal);
+    }
+
+    template <size_t N>
+    void copy_truncated(char (&target)[N], const std::string& value)
+    {
+        const size_t length = std::min(value.size(), N - 1);
+        std::memcpy(target, value.data(), length);
+        target[length] = '\0';
+    }
+
+    /// @brief Like above for C strings. The last byte only ever holds '\0', so a dump racing with the
+    /// copy still reads a terminated string.
+    template <size_t N>
+    void copy_truncated(char (&target)[N], const char* value)
+    {
+        size_t length = 0;
+        for (; length < N - 1 && value[length] != '\0'; ++length) {
+            target[length] = value[length];
+        }
+        target[length] = '\0';
+    }
+
+    /// @brief Buffered JSON writer built only on async-signal-safe calls
+    class SignalSafeWriter {
+    public:
+        explicit SignalSafeWriter(int fd)
+            : m_fd(fd)
+        {
+        }
+
+        ~SignalSafeWriter() { flush(); }
+
+        void put(char c)
+        {
+            if (m_length == sizeof(m_buffer)) {
+                flush();
+            }
+            m_buffer[m_length++] = c;
+        }
+
+        void put(const char* value)
+        {
+            for (; *value != '\0'; ++value) {
+                put(*value);
+            }
+        }
+
+        /// @brief Escaped as RFC 8259 asks, like serialize_to_json() does
+        void put_string(const char* value)
+        {
+            put('"');
+            for (; *value != '\0'; ++value) {
+                const auto c = static_cast<unsigned char>(*value);
+                if (c == '"' || c == '\\') {
+                    put('\\');
+                    put(*value);
+                } else if (c == '\n') {
+                    put(R"(\n)");
+                } else if (c == '\r') {
+                    put(R"(\r)");
+                } else if (c == '\t') {
+                    put(R"(\t)");
+                } else if (c < 0x20) {
+                    put(R"(\u00)");
+                    put("0123456789abcdef"[c >> 4]);
+                    put("0123456789abcdef"[c & 0xf]);
+                } else {
+                    put(*value);
+                }
+            }
+            put('"');
+        }
+
+        void put_uint(uint64_t value, unsigned base = 10)
+        {
+            char digits[20];
+            size_t count = 0;
+            do {
+                digits[count++] = "0123456789abcdef"[value % base];
+                value /= base;
+            } while (value != 0);
+            while (count != 0) {
+                put(digits[--count]);
+            }
+        }
+
+        /// @brief A quoted string of 16 hex digits, leading zeros included
+        void put_id(uint64_t value)
+        {
+            put('"');
+            for (int shift = 60; shift >= 0; shift -= 4) {
+                put("0123456789abcdef"[(value >> shift) & 0xf]);
+            }
+            put('"');
+        }
+
+        void put_int(int64_t value)
+        {
+            if (value < 0) {
+                put('-');
+                put_uint(0 - static_cast<uint64_t>(value));
+            } else {
+                put_uint(static_cast<uint64_t>(value));
+            }
+        }
+
+        /// @brief Fixed six decimals, printf isn't async-signal-safe
+        void put_double(double value)
+        {
+            static constexpr uint64_t SCALE { 1000000 };
+            if (!std::isfinite(value) || std::fabs(value) >= 1e18) {
+                put("null");
+                return;
+            }
+            if (value < 0) {
+                put('-');
+                value = -value;
+            }
+            auto whole = static_cast<uint64_t>(value);
+            auto fraction = static_cast<uint64_t>((value - static_cast<double>(whole)) * SCALE + 0.5);
+            if (fraction == SCALE) {
+                ++whole;
+                fraction = 0;
+            }
+            put_uint(whole);
+            put('.');
+            for (uint64_t digit = SCALE / 10; digit != 0; digit /= 10) {
+                put(static_cast<char>('0' + (fraction / digit) % 10));
+            }
+        }
+
+        void flush()
+        {
+            size_t offset = 0;
+            while (offset < m_length) {
+                const ssize_t written = write(m_fd, m_buffer + offset, m_length - offset);
+                if (written < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (written <= 0) {
+                    break;
+                }
+                offset += static_cast<size_t>(written);
+            }
+            m_length = 0;
+        }
+
+    private:
+        int m_fd;
+        size_t m_length { 0 };
+        char m_buffer[4096];
+    };
+
+    void write_args(SignalSafeWriter& out, const EventArgs& args)
+    {
+        out.put(R"(,"args":{)");
+        bool is_first = true;
+        for (const EventArg& arg : args) {
+            if (!is_first) {
+                out.put(',');
+            }
+            is_first = false;
+
+            out.put_string(arg.key);
+            out.put(':');
+            switch (arg.type) {
+            case EventArg::Type::INT:
+                out.put_int(arg.i);
+                break;
+            case EventArg::Type::DOUBLE:
+                out.put_double(arg.d);
+                break;
+            case EventArg::Type::STRING:
+                out.put_string(arg.s);
+                break;
+            case EventArg::Type::ID:
+                out.put_id(arg.id);
+                break;
+            }
+        }
+        out.put('}');
+    }
+
+    void write_event(SignalSafeWriter& out, const Record& record)
+    {
+        out.put(R"({"name":)");
+        out.put_string(record.name);
+        out.put(R"(,"cat":)");
+        out.put_string(record.cat);
+        out.put(R"(,"ph":")");
+        out.put(record.ph);
+        out.put(R"(","ts":)");
+        out.put_int(record.ts);
+        out.put(R"(,"pid":)");
+        out.put_int(record.pid);
+        out.put(R"(,"tid":)");
+        out.put_uint(record.tid);
+        if (record.ph == 'X') {
+            out.put(R"(,"dur":)");
+            out.put_int(record.dur);
+        }
+        if (is_async_phase(record.ph) || is_flow_phase(record.ph)) {
+            out.put(R"(,"id":"0x)");
+            out.put_uint(record.id, 16);
+            out.put('"');
+        }
+        if (record.ph == 'f') {
+            out.put(R"(,"bp":"e")");
+        }
+        if (!record.args.empty()) {
+            write_args(out, record.args);
+        }
+        out.put('}');
+    }
+
+    void write_open_scope(SignalSafeWriter& out, const OpenScope& scope, int pid, int tid)
+    {
+        out.put(R"({"name":)");
+        out.put_string(scope.name);
+        out.put(R"(,"cat":)");
+        out.put_string(scope.cat);
+        out.put(R"(,"ph":"B","ts":)");
+        out.put_int(scope.start);
+        out.put(R"(,"pid":)");
+        out.put_int(pid);
+        out.put(R"(,"tid":)");
+        out.put_int(tid);
+        out.put('}');
+    }
+} // namespace
+
+struct FlightRecorder::Slot {
+    /// @brief Seqlock: 2 * ticket + 1 while the record is written, 2 * ticket + 2 once it's
+    /// complete. Writers claim the slot from an even value, so only one writes it at a time.
+    std::atomic<uint64_t> sequence { 0 };
+    Record record;
+};
+
+std::atomic_bool FlightRecorder::s_is_active { false };
+
+FlightRecorder& FlightRecorder::instance()
+{
+    // Leaked on purpose: a fatal signal can arrive during static destruction.
+    static FlightRecorder* instance = new FlightRecorder;
+    return *instance;
+}
+
+void FlightRecorder::start(const char* output_file, size_t capacity)
+{
+    if (is_active()) {
+        return;
+    }
+    m_capacity = std::max<size_t>(capacity, 1);
+    m_slots = new Slot[m_capacity];
+
+    // "trace.json" dumps to "trace.flight-<n>.json"
+    std::string prefix { output_file };
+    static constexpr std::string_view EXTENSION { ".json" };
+    if (prefix.size() > EXTENSION.size() && prefix.compare(prefix.size() - EXTENSION.size(), EXTENSION.size(), EXTENSION) == 0) {
+        prefix.resize(prefix.size() - EXTENSION.size());
+    }
+    prefix += ".flight-";
+    const size_t length = std::min(prefix.size(), sizeof(m_dump_prefix) - 1);
+    std::memcpy(m_dump_prefix, prefix.data(), length);
+    m_dump_prefix[length] = '\0';
+
+    install_signal_handlers();
+    s_is_active = true;
+}
+
+void FlightRecorder::install_signal_handlers()
+{
+    // Other threads get their alternate stack with their first event
+    install_alternate_stack();
+
+    struct sigaction action {};
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    action.sa_handler = handle_dump_signal;
+    sigaction(SIGUSR1, &action, nullptr);
+
+    action.sa_flags = SA_ONSTACK;
+    action.sa_handler = handle_fatal_signal;
+    for (size_t i = 0; i < std::size(FATAL_SIGNALS); ++i) {
+        sigaction(FATAL_SIGNALS[i], &action, &g_previous_actions[i]);
+    }
+}
+
+void FlightRecorder::record(const ChromeEvent& event)
+{
+    install_alternate_stack();
+    const uint64_t ticket = m_next_ticket.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = m_slots[ticket % m_capacity];
+
+    // When the ring wrapped while the slot is still written, the event is dropped instead of
+    // mixing two records. A writer that fell a whole lap behind drops its older event as well.
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    do {
+        if (sequence % 2 != 0 || sequence > 2 * ticket) {
+            return;
+        }
+    } while (!slot.sequence.compare_exchange_weak(sequence, 2 * ticket + 1, std::memory_order_relaxed));
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Record& record = slot.record;
+    copy_truncated(record.name, event.name);
+    copy_truncated(record.cat, event.cat);
+    record.ph = event.ph;
+    record.ts = event.ts;
+    record.pid = event.pid;
+    record.tid = event.tid;
+    record.dur = event.dur;
+    record.id = event.id;
+    record.args = event.args;
+
+    slot.sequence.store(2 * ticket + 2, std::memory_order_release);
+}
+
+bool FlightRecorder::dump()
+{
+    if (!is_active()) {
+        return false;
+    }
+
+    // Built by hand, snprintf isn't async-signal-safe
+    char path[sizeof(m_dump_prefix) + 16];
+    size_t length = std::strlen(m_dump_prefix);
+    std::memcpy(path, m_dump_prefix, length);
+    char digits[10];
+    size_t count = 0;
+    uint32_t number = m_dump_count.fetch_add(1);
+    do {
+        digits[count++] = static_cast<char>('0' + number % 10);
+        number /= 10;
+    } while (number != 0);
+    while (count != 0) {
+        path[length++] = digits[--count];
+    }
+    std::memcpy(path + length, ".json", sizeof(".json"));
+
+    return dump_to(path);
+}
+
+bool FlightRecorder::dump_to(const char* path)
+{
+    if (!is_active() || m_is_dumping.exchange(true)) {
+        return false;
+    }
+
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        m_is_dumping = false;
+        return false;
+    }
+
+    {
+        SignalSafeWriter out { fd };
+        out.put(TRACE_EVENTS);
+        bool is_first = true;
+        const auto separate = [&out, &is_first] {
+            out.put(is_first ? "\n" : ",\n");
+            is_first = false;
+        };
+
+        const uint64_t end = m_next_ticket.load(std::memory_order_acquire);
+        const uint64_t begin = end > m_capacity ? end - m_capacity : 0;
+        for (uint64_t ticket = begin; ticket < end; ++ticket) {
+            const Slot& slot = m_slots[ticket % m_capacity];
+            const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence != 2 * ticket + 2) {
+                continue; // still being written, or already overwritten
+            }
+            const Record record = slot.record;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+                continue;
+            }
+            separate();
+            write_event(out, record);
+        }
+
+        const int pid = getpid();
+        for (const ScopeStack& stack : g_scope_stacks) {
+            if (!stack.is_used.load(std::memory_order_acquire)) {
+                continue;
+            }
+            const size_t depth = std::min(stack.depth.load(std::memory_order_acquire), MAX_SCOPE_DEPTH);
+            for (size_t i = 0; i < depth; ++i) {
+                separate();
+                write_open_scope(out, stack.scopes[i], pid, stack.tid.load(std::memory_order_relaxed));
+            }
+        }
+
+        out.put('\n');
+        out.put(TRACE_EVENT_BODY);
+    }
+    close(fd);
+
+    m_is_dumping = false;
+    return true;
+}
+
+void FlightRecorder::push_open_scope(const char* name, const char* cat, int64_t start)
+{
+    if (t_scope_stack == nullptr) {
+        install_alternate_stack();
+        t_scope_stack = acquire_scope_stack();
+        if (t_scope_stack == nullptr) {
+            return;
+        }
+    }
+    const size_t depth = t_scope_stack->depth.load(std::memory_order_relaxed);
+    if (depth < MAX_SCOPE_DEPTH) {
+        OpenScope& scope = t_scope_stack->scopes[depth];
+        copy_truncated(scope.name, name);
+        copy_truncated(scope.cat, cat);
+        scope.start = start;
+    }
+    t_scope_stack->depth.store(depth + 1, std::memory_order_release);
+}
+
+void FlightRecorder::pop_open_scope()
+{
+    if (t_scope_stack == nullptr) {
+        return;
+    }
+    const size_t depth = t_scope_stack->depth.load(std::memory_order_relaxed);
+    if (depth != 0) {
+        t_scope_stack->depth.store(depth - 1, std::memory_order_release);
+    }
+}
+
+} // namespace Tracer
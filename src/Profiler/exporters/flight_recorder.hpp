@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Profiler/chrome_event.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Tracer {
+
+/// @brief Bounded in-memory ring behind the FileExporter flight-recorder mode.
+///
+/// Recording copies the event into a fixed-size slot and nothing else: no serialization, no lock,
+/// no I/O. The oldest events are overwritten once the ring is full. Fatal signals are handled on a
+/// per-thread alternate stack, so a dump still runs after a stack overflow. Dumps are written with
+/// async-signal-safe calls only, so the same writer serves SIGUSR1, fatal signals and dump().
+/// Scopes that are still open at dump time are written as unfinished (ph B) slices.
+class FlightRecorder {
+public:
+    static constexpr size_t DEFAULT_CAPACITY { 16384 };
+
+    static FlightRecorder& instance();
+
+    /// @brief Start recording. Dumps go to `<output stem>.flight-<n>.json`.
+    void start(const char* output_file, size_t capacity);
+
+    static bool is_active() { return s_is_active.load(std::memory_order_relaxed); }
+
+    void record(const ChromeEvent& event);
+
+    /// @brief Write the ring to the next numbered dump file. Returns false if nothing was written.
+    bool dump();
+
+    /// @brief Write the ring to the given file. Async-signal-safe.
+    bool dump_to(const char* path);
+
+    /// @brief Track the scopes of the calling thread, so a dump can show where threads were.
+    ///
+    /// Name and category are copied, they only need to be valid during the call.
+    static void push_open_scope(const char* name, const char* cat, int64_t start);
+    static void pop_open_scope();
+
+private:
+    struct Slot;
+
+    FlightRecorder() = default;
+
+    void install_signal_handlers();
+
+    static std::atomic_bool s_is_active;
+
+    Slot* m_slots { nullptr };
+    size_t m_capacity { 0 };
+    std::atomic<uint64_t> m_next_ticket { 0 };
+    std::atomic<uint32_t> m_dump_count { 0 };
+    std::atomic_bool m_is_dumping { false };
+    char m_dump_prefix[256] {};
+};
+
+} // namespace Tracer
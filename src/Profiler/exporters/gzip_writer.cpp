@@ -0,0 +1,136 @@
+#include "gzip_writer.hpp"
+
+#include <Profiler/trace.hpp>
+
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#ifdef TRACER_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+namespace Tracer {
+
+namespace {
+    /// @brief Compress a block into a complete gzip member, header and trailer included
+    bool compress_member(const std::string& block, int level, std::vector<unsigned char>& member)
+    {
+#ifndef TRACER_HAS_ZLIB
+        static_cast<void>(block);
+        static_cast<void>(level);
+        static_cast<void>(member);
+        return false;
+#else
+        z_stream stream {};
+        // 15 window bits plus 16 selects the gzip wrapper
+        if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        member.resize(deflateBound(&stream, static_cast<uLong>(block.size())));
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(block.data()));
+        stream.avail_in = static_cast<uInt>(block.size());
+        stream.next_out = member.data();
+        stream.avail_out = static_cast<uInt>(member.size());
+        const int result = deflate(&stream, Z_FINISH);
+        member.resize(stream.total_out);
+        deflateEnd(&stream);
+        return result == Z_STREAM_END;
+#endif
+    }
+} // namespace
+
+bool GzipWriter::is_supported()
+{
+#ifdef TRACER_HAS_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+GzipWriter::GzipWriter(const std::string& path, int level)
+    : m_out(path, std::ios::binary)
+    , m_level(level)
+{
+    if (!m_out.is_open()) {
+        return;
+    }
+    m_block.reserve(BLOCK_SIZE);
+    m_writer = std::thread([this]() {
+        mark_exporter_thread();
+        run();
+    });
+}
+
+GzipWriter::~GzipWriter()
+{
+    close();
+}
+
+void GzipWriter::write(const char* data, size_t size)
+{
+    m_block.append(data, size);
+    if (m_block.size() >= BLOCK_SIZE) {
+        submit();
+    }
+}
+
+void GzipWriter::submit()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_changed.wait(lock, [this]() { return m_pending.size() < MAX_PENDING_BLOCKS; });
+    m_pending.push_back(std::move(m_block));
+    lock.unlock();
+    m_changed.notify_all();
+
+    m_block = std::string();
+    m_block.reserve(BLOCK_SIZE);
+}
+
+void GzipWriter::close()
+{
+    if (!m_writer.joinable()) {
+        return;
+    }
+    if (!m_block.empty()) {
+        submit();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_is_closing = true;
+    }
+    m_changed.notify_all();
+    m_writer.join();
+    m_out.close();
+}
+
+void GzipWriter::run()
+{
+    std::vector<unsigned char> member;
+    while (true) {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_changed.wait(lock, [this]() { return !m_pending.empty() || m_is_closing; });
+        if (m_pending.empty()) {
+            return;
+        }
+        // The block stays queued while it's compressed, so MAX_PENDING_BLOCKS counts it
+        const std::string& block = m_pending.front();
+        lock.unlock();
+
+        if (compress_member(block, m_level, member)) {
+            // One write and a flush per member, a reader never sees half a block unless the write fails
+            m_out.write(reinterpret_cast<const char*>(member.data()), static_cast<std::streamsize>(member.size()));
+            m_out.flush();
+        } else {
+            std::fprintf(stderr, "Tracer: failed to compress a block of %zu bytes\n", block.size());
+        }
+
+        lock.lock();
+        m_pending.pop_front();
+        lock.unlock();
+        m_changed.notify_all();
+    }
+}
+
+} // namespace Tracer
@@ -1,11 +1,30 @@
 #include "ipc_exporter.hpp"
 
+#include <Profiler/control.hpp>
+#include <Profiler/exporters/flight_recorder.hpp>
+#include <Profiler/shutdown_hooks.hpp>
+#include <Profiler/trace.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
 #include <iostream>
+#include <poll.h>
+#include <pthread.h> // pthread_atfork
 #include <sstream>
+#include <string_view>
+#include <sys/eventfd.h>
+#include <sys/stat.h> // mkfifo, fstat
 #include <unistd.h>
 
 namespace Tracer {
 
+namespace {
+    /// @brief Set while the exporter exists, for the fork handlers
+    std::atomic<IPCExporter*> exporter { nullptr };
+} // namespace
+
 IPCExporter& IPCExporter::instance(const char* pipe_path)
 {
     static IPCExporter instance { pipe_path };
@@ -23,6 +42,10 @@ void IPCExporter::push_trace(const ChromeEvent& result)
         /* body */ ss.str(),
     };
 
+    if (m_needs_control.load(std::memory_order_relaxed) && m_needs_control.exchange(false)) {
+        enable_control();
+    }
+
     std::lock_guard<std::mutex> lock(m_lock);
     if (!m_pipe.write_message(msg)) {
         std::cerr << "Failed to send message..\n";
@@ -32,14 +55,49 @@ void IPCExporter::push_trace(const ChromeEvent& result)
 
 IPCExporter::IPCExporter(const char* pipe_path)
     : m_pipe(pipe_path)
+    , m_pipe_path(pipe_path)
 {
     if (!m_pipe.init()) {
         std::exit(EXIT_FAILURE);
     }
+    const char* control = std::getenv("TRACER_CONTROL");
+    if (control != nullptr && std::string_view(control) != "0") {
+        open_control();
+    }
+
+    // The locks are held across fork, a child must not inherit them locked by another thread
+    static const int atfork_registered = pthread_atfork(
+        []() {
+            if (IPCExporter* instance = exporter.load()) {
+                instance->m_control_lock.lock();
+                instance->m_lock.lock();
+            }
+        },
+        []() {
+            if (IPCExporter* instance = exporter.load()) {
+                instance->m_lock.unlock();
+                instance->m_control_lock.unlock();
+            }
+        },
+        []() {
+            if (IPCExporter* instance = exporter.load()) {
+                instance->forget_control_after_fork();
+            }
+        });
+    std::ignore = atfork_registered;
+    exporter.store(this);
 }
 
 IPCExporter::~IPCExporter()
 {
+    exporter.store(nullptr);
+    {
+        std::lock_guard<std::mutex> lock(m_control_lock);
+        close_control();
+    }
+
+    run_shutdown_hooks([this](const ChromeEvent& event) { push_trace(event); });
+
     IPC::Message msg {
         /* kind */ IPC::MessageKind::STOP,
         /* pid  */ getpid(),
@@ -48,4 +106,150 @@ IPCExporter::~IPCExporter()
     std::ignore = m_pipe.write_message(msg);
 }
 
+void IPCExporter::enable_control()
+{
+    std::lock_guard<std::mutex> lock(m_control_lock);
+    if (!m_listener) {
+        open_control();
+    }
+}
+
+void IPCExporter::open_control()
+{
+    const std::string path = m_pipe_path + "." + std::to_string(getpid()) + ".ctl";
+    // Only this user may steer the process
+    if (mkfifo(path.c_str(), 0600) < 0 && errno != EEXIST) {
+        std::cerr << "Failed to create control pipe " << path << ", the collector can't control this process\n";
+        return;
+    }
+    m_control_fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC | O_NOFOLLOW);
+
+    // A FIFO left at the path by another user would let them send commands
+    struct stat info {};
+    if (m_control_fd >= 0 && (fstat(m_control_fd, &info) < 0 || !S_ISFIFO(info.st_mode) || info.st_uid != geteuid() || (info.st_mode & 077) != 0)) {
+        close(m_control_fd);
+        m_control_fd = -1;
+    }
+    m_control_keepalive_fd = m_control_fd < 0 ? -1 : open(path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    m_stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (m_control_fd < 0 || m_control_keepalive_fd < 0 || m_stop_fd < 0) {
+        std::cerr << "Failed to open control pipe " << path << ", the collector can't control this process\n";
+        m_control_path = path;
+        close_control();
+        return;
+    }
+    m_control_path = path;
+    m_listener = std::make_unique<std::thread>([this] {
+        mark_exporter_thread();
+        listen();
+    });
+
+    IPC::Message msg {
+        /* kind */ IPC::MessageKind::HELLO,
+        /* pid  */ getpid(),
+        /* body */ m_control_path,
+    };
+    std::lock_guard<std::mutex> lock(m_lock);
+    std::ignore = m_pipe.write_message(msg);
+}
+
+void IPCExporter::close_control()
+{
+    if (m_listener) {
+        const uint64_t one = 1;
+        std::ignore = write(m_stop_fd, &one, sizeof(one));
+        m_listener->join();
+        m_listener.reset();
+    }
+    for (int* fd : { &m_control_fd, &m_control_keepalive_fd, &m_stop_fd }) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    if (!m_control_path.empty()) {
+        unlink(m_control_path.c_str());
+        m_control_path.clear();
+    }
+}
+
+void IPCExporter::forget_control_after_fork()
+{
+    m_lock.unlock();
+    m_control_lock.unlock();
+    if (!m_listener) {
+        return;
+    }
+
+    // Only the forking thread made it into the child, the listener and the FIFO stay the parent's.
+    // Nothing here may allocate, the child's channel is opened with its first event.
+    std::ignore = m_listener.release();
+    for (int* fd : { &m_control_fd, &m_control_keepalive_fd, &m_stop_fd }) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    m_control_path.clear();
+    m_needs_control = true;
+}
+
+void IPCExporter::listen()
+{
+    std::string pending;
+    char buffer[512];
+    pollfd fds[] = {
+        { m_control_fd, POLLIN, 0 },
+        { m_stop_fd, POLLIN, 0 },
+    };
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+        const ssize_t size = read(m_control_fd, buffer, sizeof(buffer));
+        if (size <= 0) {
+            continue;
+        }
+        pending.append(buffer, static_cast<size_t>(size));
+
+        // The collector writes whole records, one per line
+        size_t end = 0;
+        while ((end = pending.find('\n')) != std::string::npos) {
+            if (Control::instance().apply(pending.substr(0, end))) {
+                take_snapshot();
+            }
+            pending.erase(0, end + 1);
+        }
+    }
+}
+
+void IPCExporter::take_snapshot()
+{
+    // The marker bypasses Control, a snapshot is requested even while tracing is stopped
+    push_trace(ChromeEvent {
+        /* name */ "snapshot",
+        /* cat  */ "control",
+        /* ph   */ 'i',
+        /* ts   */ get_unique_timestamp(),
+        /* pid  */ getpid(),
+        /* tid  */ static_cast<size_t>(get_thread_id()),
+        /* dur  */ 0,
+        /* id   */ 0,
+        /* args */ {},
+    });
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        std::ignore = m_pipe.flush();
+    }
+    if (FlightRecorder::is_active()) {
+        std::ignore = FlightRecorder::instance().dump();
+    }
+}
+
 } // namespace Tracer
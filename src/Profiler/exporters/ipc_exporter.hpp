@@ -3,24 +3,69 @@
 #include <IPC/client.hpp>
 #include <Profiler/chrome_event.hpp>
 
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
 
 namespace Tracer {
 
+/// @brief Sends events to a TraceCollector through its pipe.
+///
+/// With TRACER_CONTROL=1 in the environment, or after enable_control(), the exporter also creates
+/// a control FIFO, `<pipe>.<pid>.ctl`, and announces it with a HELLO message. A listener thread
+/// applies the state records the collector writes there to Control, and answers snapshot requests
+/// by flushing the queued events after a "snapshot" marker. The collector doesn't have to listen:
+/// clients of one without a control channel trace as before. Forked children of a controlled
+/// client open a channel of their own with their first event, keeping the parent's state until
+/// they get one.
 class IPCExporter {
 public:
     static IPCExporter& instance(const char* pipe_path = "/tmp/trace.pipe");
 
     void push_trace(const ChromeEvent& result);
 
+    /// @brief Create the control channel, if there isn't one yet
+    void enable_control();
+
+    /// @brief The FIFO the collector controls this client through, empty if it couldn't be created
+    const std::string& control_path() const { return m_control_path; }
+
 private:
     IPCExporter(const char* pipe_path);
 
     ~IPCExporter();
 
+    void open_control();
+    void close_control();
+    void forget_control_after_fork();
+    void listen();
+    void take_snapshot();
+
 private:
     std::mutex m_lock;
+
+    /// @var m_control_lock Serializes opening and closing the control channel, taken before m_lock
+    std::mutex m_control_lock;
     IPC::PipeClient m_pipe;
+    std::string m_pipe_path;
+
+    std::string m_control_path;
+    int m_control_fd { -1 };
+
+    /// @var m_needs_control Set in forked children of a controlled client, which open their own
+    /// channel with the first event: the fork handler must not allocate or start threads
+    std::atomic<bool> m_needs_control { false };
+
+    /// @var m_control_keepalive_fd Write end held open, so the FIFO doesn't hang up between writers
+    int m_control_keepalive_fd { -1 };
+
+    /// @var m_stop_fd Eventfd waking the listener when the exporter goes away
+    int m_stop_fd { -1 };
+
+    /// @var m_listener Leaked by forked children, the thread stays with the parent
+    std::unique_ptr<std::thread> m_listener;
 };
 
 } // namespace Tracer
@@ -0,0 +1,99 @@
+#include "mapped_writer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace Tracer {
+
+MappedWriter::MappedWriter(const std::string& path, const std::string& footer, size_t growth_step)
+    : m_growth_step(growth_step)
+    , m_footer(footer)
+{
+    m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        return;
+    }
+    if (!grow(m_footer.size())) {
+        ::close(m_fd);
+        m_fd = -1;
+        return;
+    }
+    std::memcpy(m_data, m_footer.data(), m_footer.size());
+}
+
+MappedWriter::~MappedWriter()
+{
+    close();
+}
+
+bool MappedWriter::grow(size_t needed)
+{
+    // Steps double from INITIAL_SIZE up to the growth step, short traces stay small
+    size_t capacity = m_capacity;
+    while (capacity < needed) {
+        capacity += std::min(std::max(capacity, INITIAL_SIZE), m_growth_step);
+    }
+
+    // Reserve the blocks up front, so running out of disk fails here and not as SIGBUS on a store
+    int result = posix_fallocate(m_fd, static_cast<off_t>(m_capacity), static_cast<off_t>(capacity - m_capacity));
+    if (result == EOPNOTSUPP || result == EINVAL) {
+        result = ftruncate(m_fd, static_cast<off_t>(capacity)) == 0 ? 0 : errno;
+    }
+    if (result != 0) {
+        return false;
+    }
+
+    void* data = m_data == nullptr
+        ? mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0)
+        : mremap(m_data, m_capacity, capacity, MREMAP_MAYMOVE);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    m_data = static_cast<char*>(data);
+    // Zeros after the footer would make the file invalid JSON, spaces are whitespace
+    std::memset(m_data + m_capacity, ' ', capacity - m_capacity);
+    m_capacity = capacity;
+    return true;
+}
+
+bool MappedWriter::append(const char* text, size_t size)
+{
+    if (m_data == nullptr || (m_end + size + m_footer.size() > m_capacity && !grow(m_end + size + m_footer.size()))) {
+        return false;
+    }
+    // The text replaces the old footer, then the footer follows it
+    std::memcpy(m_data + m_end, text, size);
+    std::memcpy(m_data + m_end + size, m_footer.data(), m_footer.size());
+    m_end += size;
+    return true;
+}
+
+void MappedWriter::close()
+{
+    // If this fails the padding stays, which is still a valid trace
+    static_cast<void>(close_at(m_end + m_footer.size()));
+}
+
+bool MappedWriter::detach()
+{
+    return close_at(m_end);
+}
+
+bool MappedWriter::close_at(size_t size)
+{
+    if (m_data == nullptr) {
+        return false;
+    }
+    munmap(m_data, m_capacity);
+    m_data = nullptr;
+    const bool is_cut = ftruncate(m_fd, static_cast<off_t>(size)) == 0;
+    ::close(m_fd);
+    m_fd = -1;
+    return is_cut;
+}
+
+} // namespace Tracer
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Tracer {
+
+/// @brief Append-only trace file that is a loadable trace after every event, even if the process
+/// crashes.
+///
+/// The file is preallocated in large steps and memory-mapped. The footer always follows the last
+/// complete event and the rest of the preallocated region is padded with spaces, which JSON allows
+/// after the closing brace. Appending is two memory copies, the text and the footer behind it, with
+/// no syscall until the region is full. The mapping is shared, so the kernel keeps everything
+/// copied so far when the process dies; only a crash in the middle of a copy can cut that one
+/// event. close() trims the padding.
+class MappedWriter {
+public:
+    static constexpr size_t INITIAL_SIZE { 1024 * 1024 };
+    static constexpr size_t DEFAULT_GROWTH_STEP { 32 * 1024 * 1024 };
+
+    MappedWriter(const std::string& path, const std::string& footer, size_t growth_step = DEFAULT_GROWTH_STEP);
+    ~MappedWriter();
+
+    MappedWriter(const MappedWriter&) = delete;
+    MappedWriter& operator=(const MappedWriter&) = delete;
+
+    /// @brief False if the file couldn't be created or mapped, e.g. on file systems without mmap
+    bool is_open() const { return m_data != nullptr; }
+
+    /// @brief Insert text before the footer. Returns false if the file couldn't grow.
+    bool append(const char* text, size_t size);
+    bool append(const std::string& text) { return append(text.data(), text.size()); }
+
+    /// @brief Unmap and cut the file after the footer
+    void close();
+
+    /// @brief Unmap and cut the file before the footer, so it can be continued as a plain stream.
+    /// Returns false if the file couldn't be cut.
+    bool detach();
+
+private:
+    bool grow(size_t needed);
+    bool close_at(size_t size);
+
+    int m_fd { -1 };
+    char* m_data { nullptr };
+    size_t m_capacity { 0 };
+    size_t m_end { 0 };
+    size_t m_growth_step;
+    std::string m_footer;
+};
+
+} // namespace Tracer
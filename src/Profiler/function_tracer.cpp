@@ -0,0 +1,411 @@
+#include "function_tracer.hpp"
+
+#include <Profiler/shutdown_hooks.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+// Nothing in this file may be instrumented, or the hooks would call themselves.
+#define NO_INSTRUMENT __attribute__((no_instrument_function))
+
+namespace Tracer {
+
+namespace {
+    /// @brief Records kept per thread before the buffer is exported
+    constexpr size_t BUFFER_CAPACITY { 16384 };
+    /// @brief Initial reservation, grown in steps up to BUFFER_CAPACITY by threads that need it
+    constexpr size_t INITIAL_CAPACITY { 256 };
+    constexpr int64_t DEFAULT_MIN_DURATION_US { 10 };
+
+    struct Frame {
+        void* function;
+        int64_t start_ns;
+    };
+
+    struct Record {
+        void* function;
+        int64_t start_ns;
+        int64_t dur_ns;
+    };
+
+    struct ThreadBuffer {
+        size_t tid;
+
+        // Owned by the thread itself
+        std::vector<Frame> stack;
+
+        // Drained by whichever thread exports
+        std::mutex lock;
+        std::vector<Record> records;
+    };
+
+    /// @brief The buffers of the running threads, so flush() can reach them
+    struct BufferRegistry {
+        std::mutex lock;
+        std::vector<ThreadBuffer*> buffers;
+    };
+
+    NO_INSTRUMENT BufferRegistry& registry()
+    {
+        // Leaked on purpose: buffers are exported from the exporter destructors.
+        static BufferRegistry* registry = new BufferRegistry;
+        return *registry;
+    }
+
+    thread_local ThreadBuffer* t_buffer { nullptr };
+    thread_local bool t_is_in_runtime { false };
+    thread_local bool t_is_thread_exiting { false };
+
+    NO_INSTRUMENT void retire_buffer(ThreadBuffer* buffer);
+
+    /// @brief Exports and frees the buffer when its thread exits
+    struct ThreadExit {
+        /// @brief Touching the thread_local registers its destructor for the calling thread
+        NO_INSTRUMENT void arm() { }
+
+        NO_INSTRUMENT ~ThreadExit()
+        {
+            t_is_thread_exiting = true;
+            if (t_buffer != nullptr) {
+                retire_buffer(t_buffer);
+                t_buffer = nullptr;
+            }
+        }
+    };
+    thread_local ThreadExit t_thread_exit;
+
+    NO_INSTRUMENT int64_t now_ns()
+    {
+        // Same clock as get_unique_timestamp(), without its per-call uniqueness bump
+        using namespace std::chrono;
+        return time_point_cast<nanoseconds>(high_resolution_clock::now()).time_since_epoch().count();
+    }
+
+    /// @brief Resolves function addresses to demangled names, once per address
+    class Symbolizer {
+    public:
+        NO_INSTRUMENT static Symbolizer& instance()
+        {
+            static Symbolizer* instance = new Symbolizer;
+            return *instance;
+        }
+
+        NO_INSTRUMENT const std::string& resolve(void* address)
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            auto [it, is_new] = m_names.try_emplace(address);
+            if (is_new) {
+                it->second = demangle(lookup(address));
+            }
+            return it->second;
+        }
+
+    private:
+        struct Symbol {
+            uintptr_t value;
+            uintptr_t size;
+            std::string name;
+        };
+
+        struct ObjectSymbols {
+            bool is_relocatable { false };
+            std::vector<Symbol> symbols;
+        };
+
+        NO_INSTRUMENT std::string lookup(void* address)
+        {
+            Dl_info info {};
+            if (dladdr(address, &info) == 0) {
+                return hex(address);
+            }
+            if (info.dli_sname != nullptr && info.dli_saddr == address) {
+                return info.dli_sname;
+            }
+
+            // dladdr only knows exported symbols, static and hidden functions need the full symtab
+            const ObjectSymbols& object = symbols_of(info.dli_fname);
+            const auto target = reinterpret_cast<uintptr_t>(address)
+                - (object.is_relocatable ? reinterpret_cast<uintptr_t>(info.dli_fbase) : 0);
+            auto it = std::upper_bound(object.symbols.begin(), object.symbols.end(), target,
+                [](uintptr_t value, const Symbol& symbol) { return value < symbol.value; });
+            if (it != object.symbols.begin()) {
+                --it;
+                if (target < it->value + std::max<uintptr_t>(it->size, 1)) {
+                    return it->name;
+                }
+            }
+            return info.dli_sname != nullptr ? info.dli_sname : hex(address);
+        }
+
+        NO_INSTRUMENT const ObjectSymbols& symbols_of(const char* path)
+        {
+            auto [it, is_new] = m_objects.try_emplace(path != nullptr ? path : "");
+            if (is_new) {
+                it->second = read_symbols(it->first);
+            }
+            return it->second;
+        }
+
+        NO_INSTRUMENT static ObjectSymbols read_symbols(const std::string& path)
+        {
+            ObjectSymbols object;
+            const int fd = open(path.empty() ? "/proc/self/exe" : path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return object;
+            }
+            struct stat st {};
+            void* data = fstat(fd, &st) == 0 && st.st_size > 0
+                ? mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0)
+                : MAP_FAILED;
+            close(fd);
+            if (data == MAP_FAILED) {
+                return object;
+            }
+
+            const auto* bytes = static_cast<const char*>(data);
+            const auto size = static_cast<size_t>(st.st_size);
+            const auto* header = reinterpret_cast<const Elf64_Ehdr*>(bytes);
+            const bool is_valid = size >= sizeof(Elf64_Ehdr)
+                && std::equal(header->e_ident, header->e_ident + SELFMAG, ELFMAG)
+                && header->e_ident[EI_CLASS] == ELFCLASS64
+                && header->e_shoff + header->e_shnum * sizeof(Elf64_Shdr) <= size;
+
+            if (is_valid) {
+                object.is_relocatable = header->e_type == ET_DYN;
+                const auto* sections = reinterpret_cast<const Elf64_Shdr*>(bytes + header->e_shoff);
+                for (size_t i = 0; i < header->e_shnum; ++i) {
+                    const Elf64_Shdr& section = sections[i];
+                    if (section.sh_type != SHT_SYMTAB || section.sh_link >= header->e_shnum) {
+                        continue;
+                    }
+                    const Elf64_Shdr& strings = sections[section.sh_link];
+                    if (section.sh_offset + section.sh_size > size || strings.sh_offset + strings.sh_size > size) {
+                        continue;
+                    }
+                    const auto* symbols = reinterpret_cast<const Elf64_Sym*>(bytes + section.sh_offset);
+                    const size_t count = section.sh_size / sizeof(Elf64_Sym);
+                    for (size_t j = 0; j < count; ++j) {
+                        const Elf64_Sym& symbol = symbols[j];
+                        if (ELF64_ST_TYPE(symbol.st_info) != STT_FUNC || symbol.st_value == 0
+                            || symbol.st_name >= strings.sh_size) {
+                            continue;
+                        }
+                        object.symbols.push_back({ symbol.st_value, symbol.st_size,
+                            bytes + strings.sh_offset + symbol.st_name });
+                    }
+                }
+                std::sort(object.symbols.begin(), object.symbols.end(),
+                    [](const Symbol& lhs, const Symbol& rhs) { return lhs.value < rhs.value; });
+            }
+            munmap(data, size);
+            return object;
+        }
+
+        NO_INSTRUMENT static std::string demangle(const std::string& name)
+        {
+            int status {};
+            std::unique_ptr<char, decltype(&std::free)> demangled {
+                abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status), &std::free
+            };
+            return status == 0 ? demangled.get() : name;
+        }
+
+        NO_INSTRUMENT static std::string hex(void* address)
+        {
+            char buffer[2 + 2 * sizeof(void*) + 1];
+            std::snprintf(buffer, sizeof(buffer), "%p", address);
+            return buffer;
+        }
+
+        std::mutex m_lock;
+        std::unordered_map<void*, std::string> m_names;
+        std::unordered_map<std::string, ObjectSymbols> m_objects;
+    };
+
+    /// @brief Marks the calling thread as inside the runtime for the current scope
+    class RuntimeGuard {
+    public:
+        NO_INSTRUMENT RuntimeGuard()
+            : m_is_nested(t_is_in_runtime)
+        {
+            t_is_in_runtime = true;
+        }
+
+        NO_INSTRUMENT ~RuntimeGuard() { t_is_in_runtime = m_is_nested; }
+
+        NO_INSTRUMENT bool is_nested() const { return m_is_nested; }
+
+    private:
+        bool m_is_nested;
+    };
+    NO_INSTRUMENT void export_buffer(ThreadBuffer& buffer, const EventSink& sink)
+    {
+        std::vector<Record> records;
+        {
+            std::lock_guard<std::mutex> lock(buffer.lock);
+            records.swap(buffer.records);
+        }
+
+        const int pid = getpid();
+        for (const Record& record : records) {
+            ChromeEvent event {
+                /* name */ Symbolizer::instance().resolve(record.function),
+                /* cat  */ "function",
+                /* ph   */ 'X',
+                /* ts   */ record.start_ns / 1000,
+                /* pid  */ pid,
+                /* tid  */ buffer.tid,
+                /* dur  */ record.dur_ns / 1000,
+                /* id   */ 0,
+                /* args */ {},
+            };
+            sink(event);
+        }
+    }
+
+    NO_INSTRUMENT void export_all(const EventSink& sink)
+    {
+        // The exporter may run instrumented inline code, which must not re-enter the registry
+        RuntimeGuard guard;
+        BufferRegistry& buffers = registry();
+        std::lock_guard<std::mutex> lock(buffers.lock);
+        for (ThreadBuffer* buffer : buffers.buffers) {
+            export_buffer(*buffer, sink);
+        }
+    }
+
+    NO_INSTRUMENT void retire_buffer(ThreadBuffer* buffer)
+    {
+        RuntimeGuard guard;
+        const FunctionTracer::Sink sink = FunctionTracer::instance().sink();
+        export_buffer(*buffer, [sink](const ChromeEvent& event) { sink(event); });
+
+        // export_all holds the registry lock while it reads the buffer
+        BufferRegistry& buffers = registry();
+        {
+            std::lock_guard<std::mutex> lock(buffers.lock);
+            buffers.buffers.erase(std::remove(buffers.buffers.begin(), buffers.buffers.end(), buffer), buffers.buffers.end());
+        }
+        delete buffer;
+    }
+
+    NO_INSTRUMENT ThreadBuffer* thread_buffer()
+    {
+        if (t_buffer != nullptr || t_is_thread_exiting) {
+            return t_buffer;
+        }
+
+        auto* buffer = new ThreadBuffer;
+        buffer->tid = static_cast<size_t>(get_thread_id());
+        buffer->stack.reserve(64);
+        buffer->records.reserve(INITIAL_CAPACITY);
+        {
+            BufferRegistry& buffers = registry();
+            std::lock_guard<std::mutex> lock(buffers.lock);
+            buffers.buffers.push_back(buffer);
+        }
+        register_shutdown_hook(export_all);
+        t_thread_exit.arm();
+        t_buffer = buffer;
+        return buffer;
+    }
+
+} // namespace
+
+FunctionTracer& FunctionTracer::instance()
+{
+    // Leaked on purpose: hooks keep firing during static destruction.
+    static FunctionTracer* instance = new FunctionTracer;
+    return *instance;
+}
+
+FunctionTracer::FunctionTracer()
+    : m_min_duration_ns(DEFAULT_MIN_DURATION_US * 1000)
+    , m_sink([](const ChromeEvent& event) { FileExporter::instance().push_trace(event); })
+{
+    if (const char* value = std::getenv("TRACER_INSTRUMENT_MIN_US")) {
+        m_min_duration_ns = std::strtoll(value, nullptr, 10) * 1000;
+    }
+}
+
+void FunctionTracer::set_min_duration_us(int64_t min_duration_us)
+{
+    m_min_duration_ns = min_duration_us * 1000;
+}
+
+void FunctionTracer::flush()
+{
+    const Sink sink = m_sink.load();
+    export_all([sink](const ChromeEvent& event) { sink(event); });
+}
+
+} // namespace Tracer
+
+extern "C" {
+
+NO_INSTRUMENT void __cyg_profile_func_enter(void* function, void* /* call_site */)
+{
+    using namespace Tracer;
+    RuntimeGuard guard;
+    if (guard.is_nested()) {
+        return;
+    }
+    if (ThreadBuffer* buffer = thread_buffer()) {
+        buffer->stack.push_back({ function, now_ns() });
+    }
+}
+
+NO_INSTRUMENT void __cyg_profile_func_exit(void* function, void* /* call_site */)
+{
+    using namespace Tracer;
+    const int64_t end_ns = now_ns();
+
+    RuntimeGuard guard;
+    if (guard.is_nested() || t_buffer == nullptr || t_buffer->stack.empty()) {
+        return;
+    }
+    ThreadBuffer& buffer = *t_buffer;
+
+    // Frames skipped by longjmp never see their exit hook
+    auto frame = std::find_if(buffer.stack.rbegin(), buffer.stack.rend(),
+        [function](const Frame& candidate) { return candidate.function == function; });
+    if (frame == buffer.stack.rend()) {
+        return;
+    }
+    const int64_t start_ns = frame->start_ns;
+    buffer.stack.erase(std::next(frame).base(), buffer.stack.end());
+
+    // Short calls die here, they never reach the exporter or the symbolizer
+    const int64_t dur_ns = end_ns - start_ns;
+    FunctionTracer& tracer = FunctionTracer::instance();
+    if (dur_ns < tracer.min_duration_ns()) {
+        return;
+    }
+
+    bool is_full {};
+    {
+        std::lock_guard<std::mutex> lock(buffer.lock);
+        buffer.records.push_back({ function, start_ns, dur_ns });
+        is_full = buffer.records.size() >= BUFFER_CAPACITY;
+    }
+    if (is_full) {
+        const FunctionTracer::Sink sink = tracer.sink();
+        export_buffer(buffer, [sink](const ChromeEvent& event) { sink(event); });
+    }
+}
+
+} // extern "C"
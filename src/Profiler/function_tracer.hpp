@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Profiler/trace.hpp>
+
+#include <atomic>
+#include <cstdint>
+
+namespace Tracer {
+
+/// @brief Runtime behind `-finstrument-functions`.
+///
+/// The compiler-inserted hooks only record raw function addresses and timestamps into per-thread
+/// buffers. Calls shorter than the minimum duration are discarded on exit without ever leaving the
+/// thread. Addresses are resolved to demangled names once per unique address, when a buffer is
+/// exported: when it fills up, when its thread exits, on flush() and when the exporter shuts down.
+///
+/// Enabled with the `instrument_functions` meson option; link against `function_tracer_dep` to
+/// instrument a target. The minimum duration defaults to TRACER_INSTRUMENT_MIN_US or 10us.
+class FunctionTracer {
+public:
+    using Sink = void (*)(const ChromeEvent& event);
+
+    static FunctionTracer& instance();
+
+    /// @brief Route full buffers to another exporter, FileExporter is used by default
+    template <class T>
+    void use_exporter()
+    {
+        m_sink = [](const ChromeEvent& event) { T::instance().push_trace(event); };
+    }
+
+    void set_min_duration_us(int64_t min_duration_us);
+
+    /// @brief Export the finished calls of every thread
+    void flush();
+
+    int64_t min_duration_ns() const { return m_min_duration_ns.load(std::memory_order_relaxed); }
+
+    Sink sink() const { return m_sink.load(); }
+
+private:
+    FunctionTracer();
+
+    std::atomic<int64_t> m_min_duration_ns;
+    std::atomic<Sink> m_sink;
+};
+
+} // namespace Tracer
@@ -0,0 +1,278 @@
+#include "governor.hpp"
+
+#include <Profiler/shutdown_hooks.hpp>
+#include <Profiler/trace.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <unistd.h>
+
+namespace Tracer {
+
+namespace {
+    int64_t steady_ns()
+    {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    const char* mode_name(CallSite::Mode mode)
+    {
+        switch (mode) {
+        case CallSite::Mode::FULL:
+            return "full";
+        case CallSite::Mode::SAMPLED:
+            return "sampled";
+        case CallSite::Mode::AGGREGATE:
+            return "aggregate";
+        }
+        return "unknown";
+    }
+
+    ChromeEvent governor_event(const char* name, const char* cat)
+    {
+        ChromeEvent event {};
+        event.name = name;
+        event.cat = cat;
+        event.ph = 'i';
+        event.ts = get_unique_timestamp();
+        event.pid = getpid();
+        event.tid = static_cast<size_t>(get_thread_id());
+        return event;
+    }
+
+    /// @brief Smallest power of two not below value, so N doesn't flap between windows
+    uint32_t sample_rate_for(double value)
+    {
+        static constexpr uint32_t MAX_ONE_IN { 1U << 20 };
+        uint32_t one_in = 2;
+        while (one_in < MAX_ONE_IN && one_in < value) {
+            one_in *= 2;
+        }
+        return one_in;
+    }
+
+    /// @brief Hit shard of the calling thread, assigned round robin on first use
+    size_t hit_shard()
+    {
+        static std::atomic<size_t> next_shard { 0 };
+        thread_local size_t shard { CallSite::HIT_SHARDS };
+        if (shard == CallSite::HIT_SHARDS) {
+            shard = next_shard.fetch_add(1, std::memory_order_relaxed) % CallSite::HIT_SHARDS;
+        }
+        return shard;
+    }
+
+    [[maybe_unused]] const bool is_configured_from_environment = [] {
+        if (const char* value = std::getenv("TRACER_OVERHEAD_BUDGET")) {
+            Governor::instance().configure(std::strtod(value, nullptr));
+            return true;
+        }
+        return false;
+    }();
+} // namespace
+
+CallSite::Action CallSite::enter(const char* name, Sink sink)
+{
+    // Counts of this shard, sampling 1-in-N of them samples 1-in-N of the site
+    const uint64_t hits = m_hit_shards[hit_shard()].hits.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (!Governor::is_active()) {
+        return Action::TRACE;
+    }
+
+    if (!m_is_registered.load(std::memory_order_relaxed) && !m_is_registered.exchange(true)) {
+        m_name = intern(name, std::char_traits<char>::length(name));
+        m_sink = sink;
+        Governor::instance().add(*this);
+    }
+    if (hits % Governor::SHARD_WINDOW_HITS == 0) {
+        const uint64_t folded = m_folded_hits.fetch_add(Governor::SHARD_WINDOW_HITS, std::memory_order_relaxed) + Governor::SHARD_WINDOW_HITS;
+        if (folded % Governor::WINDOW_HITS == 0) {
+            Governor::instance().evaluate(*this, sink);
+        }
+    }
+
+    switch (m_mode.load(std::memory_order_relaxed)) {
+    case Mode::FULL:
+        return Action::TRACE;
+    case Mode::SAMPLED:
+        return hits % m_one_in.load(std::memory_order_relaxed) == 0 ? Action::TRACE : Action::SKIP;
+    case Mode::AGGREGATE:
+        return Action::AGGREGATE;
+    }
+    return Action::TRACE;
+}
+
+uint64_t CallSite::hits() const
+{
+    uint64_t hits = 0;
+    for (const HitShard& shard : m_hit_shards) {
+        hits += shard.hits.load(std::memory_order_relaxed);
+    }
+    return hits;
+}
+
+void CallSite::exit_traced(int64_t dur_us, int64_t export_cost_ns)
+{
+    m_exported.fetch_add(1, std::memory_order_relaxed);
+    m_window_timed.fetch_add(1, std::memory_order_relaxed);
+    m_window_dur_us.fetch_add(dur_us, std::memory_order_relaxed);
+    m_window_exported.fetch_add(1, std::memory_order_relaxed);
+    m_window_cost_ns.fetch_add(export_cost_ns, std::memory_order_relaxed);
+}
+
+void CallSite::exit_aggregated(int64_t dur_us)
+{
+    m_aggregated.fetch_add(1, std::memory_order_relaxed);
+    m_aggregated_dur_us.fetch_add(dur_us, std::memory_order_relaxed);
+    m_window_timed.fetch_add(1, std::memory_order_relaxed);
+    m_window_dur_us.fetch_add(dur_us, std::memory_order_relaxed);
+}
+
+std::atomic_bool Governor::s_is_active { false };
+
+Governor& Governor::instance()
+{
+    // Leaked on purpose: sites are summarized from the exporter destructors.
+    static Governor* instance = new Governor;
+    return *instance;
+}
+
+void Governor::configure(double budget)
+{
+    m_budget = budget;
+    if (budget > 0) {
+        // Leaked with the governor, the thread sleeps until the process exits
+        std::call_once(m_ticks_started, [this] { std::thread([this] { run_ticks(); }).detach(); });
+    }
+    register_shutdown_hook([](const EventSink& sink) {
+        for (const SiteStats& stats : Governor::instance().sites()) {
+            if (stats.hits == stats.exported) {
+                continue;
+            }
+            ChromeEvent event = governor_event(stats.name, "governor_summary");
+            add_args(event.args,
+                "mode", mode_name(stats.mode),
+                "hits", stats.hits,
+                "exported", stats.exported,
+                "aggregated_dur_us", stats.aggregated_dur_us);
+            sink(event);
+        }
+    });
+    s_is_active = budget > 0;
+}
+
+std::vector<Governor::SiteStats> Governor::sites()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    std::vector<SiteStats> stats;
+    stats.reserve(m_sites.size());
+    for (const CallSite* site : m_sites) {
+        stats.push_back({
+            site->m_name.load(),
+            site->m_mode.load(),
+            site->m_one_in.load(),
+            site->hits(),
+            site->m_exported.load(),
+            site->m_aggregated_dur_us.load(),
+        });
+    }
+    return stats;
+}
+
+void Governor::add(CallSite& site)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_sites.push_back(&site);
+}
+
+void Governor::run_ticks()
+{
+    const int64_t tick_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(TICK).count();
+    while (true) {
+        std::this_thread::sleep_for(TICK);
+        std::vector<CallSite*> demoted;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            for (CallSite* site : m_sites) {
+                if (site->m_mode.load() != CallSite::Mode::FULL && steady_ns() - site->m_window_start_ns.load() >= tick_ns) {
+                    demoted.push_back(site);
+                }
+            }
+        }
+        for (CallSite* site : demoted) {
+            evaluate(*site, site->m_sink.load());
+        }
+    }
+}
+
+void Governor::evaluate(CallSite& site, CallSite::Sink sink)
+{
+    // The tick and a hit closing a window may evaluate a site at once, one of them is enough
+    if (site.m_is_evaluating.exchange(true, std::memory_order_acquire)) {
+        return;
+    }
+    struct Release {
+        std::atomic_bool& flag;
+        ~Release() { flag.store(false, std::memory_order_release); }
+    } release { site.m_is_evaluating };
+
+    const int64_t now = steady_ns();
+    const uint64_t hits = site.hits();
+    const uint64_t window_hits = hits - site.m_window_start_hits.exchange(hits);
+    const int64_t window_start = site.m_window_start_ns.exchange(now);
+    const uint64_t timed = site.m_window_timed.exchange(0);
+    const int64_t dur_us = site.m_window_dur_us.exchange(0);
+    const uint64_t exported = site.m_window_exported.exchange(0);
+    const int64_t cost_ns = site.m_window_cost_ns.exchange(0);
+    if (exported != 0) {
+        site.m_cost_ns = cost_ns / static_cast<int64_t>(exported);
+    }
+
+    // The first window only starts the clock, and nothing is known before an event was exported
+    const int64_t event_cost_ns = site.m_cost_ns.load();
+    if (window_start == 0 || now <= window_start || event_cost_ns <= 0) {
+        return;
+    }
+
+    // Fraction of a CPU the site would spend on tracing if every hit was exported
+    const double hits_per_sec = static_cast<double>(window_hits) * 1e9 / static_cast<double>(now - window_start);
+    const double overhead = hits_per_sec * static_cast<double>(event_cost_ns) / 1e9;
+    const double budget = m_budget.load();
+
+    const CallSite::Mode current_mode = site.m_mode.load();
+    CallSite::Mode mode = current_mode;
+    uint32_t one_in = site.m_one_in.load();
+    if (overhead <= budget / 2 || (current_mode == CallSite::Mode::FULL && overhead <= budget)) {
+        mode = CallSite::Mode::FULL;
+        one_in = 1;
+    } else if (overhead > budget) {
+        const double avg_dur_ns = timed != 0 ? static_cast<double>(dur_us) * 1000.0 / static_cast<double>(timed) : 0.0;
+        if (timed != 0 && avg_dur_ns < static_cast<double>(event_cost_ns)) {
+            mode = CallSite::Mode::AGGREGATE;
+            one_in = 1;
+        } else {
+            mode = CallSite::Mode::SAMPLED;
+            one_in = sample_rate_for(std::ceil(overhead / budget));
+        }
+    }
+    if (mode == current_mode && one_in == site.m_one_in.load()) {
+        return;
+    }
+
+    site.m_one_in = one_in;
+    site.m_mode = mode;
+
+    ChromeEvent event = governor_event(site.m_name.load(), "governor");
+    add_args(event.args,
+        "mode", mode_name(mode),
+        "one_in", one_in,
+        "hits_per_sec", static_cast<int64_t>(hits_per_sec),
+        "event_cost_ns", event_cost_ns);
+    sink(event);
+}
+
+} // namespace Tracer
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <Profiler/chrome_event.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Tracer {
+
+/// @brief Overhead bookkeeping of a single TRACE_SCOPE.
+///
+/// The macros give every scope a static CallSite. It's constant-initialized, so keeping one costs
+/// no guard on the hot path. Without a configured budget the only cost is the hit counter.
+///
+/// Hits are counted in HIT_SHARDS cache-line sized shards, each thread counting in its own, so hot
+/// sites hit from many threads don't bounce one counter between cores. A shard folds its hits into
+/// the site's window every SHARD_WINDOW_HITS hits.
+class CallSite {
+public:
+    static constexpr size_t HIT_SHARDS { 8 };
+    enum class Mode : uint8_t {
+        FULL, // every hit is exported
+        SAMPLED, // one hit out of `one_in` is exported
+        AGGREGATE, // nothing is exported, count and duration are summed up
+    };
+
+    enum class Action : uint8_t {
+        TRACE,
+        AGGREGATE,
+        SKIP,
+    };
+
+    using Sink = void (*)(const ChromeEvent& event);
+
+    constexpr CallSite() = default;
+
+    /// @brief Count a hit and decide what the scope does. Mode changes are reported through `sink`.
+    Action enter(const char* name, Sink sink);
+
+    void exit_traced(int64_t dur_us, int64_t export_cost_ns);
+    void exit_aggregated(int64_t dur_us);
+
+private:
+    friend class Governor;
+
+    struct alignas(64) HitShard {
+        std::atomic<uint64_t> hits { 0 };
+    };
+
+    uint64_t hits() const;
+
+    HitShard m_hit_shards[HIT_SHARDS] {};
+    std::atomic<const char*> m_name { nullptr };
+    std::atomic<Sink> m_sink { nullptr };
+    std::atomic<uint64_t> m_folded_hits { 0 };
+    std::atomic<uint64_t> m_exported { 0 };
+    std::atomic<Mode> m_mode { Mode::FULL };
+    std::atomic<uint32_t> m_one_in { 1 };
+    std::atomic_bool m_is_registered { false };
+
+    // Measurements of the current window
+    std::atomic_bool m_is_evaluating { false };
+    std::atomic<int64_t> m_window_start_ns { 0 };
+    std::atomic<uint64_t> m_window_start_hits { 0 };
+    std::atomic<uint64_t> m_window_timed { 0 };
+    std::atomic<int64_t> m_window_dur_us { 0 };
+    std::atomic<uint64_t> m_window_exported { 0 };
+    std::atomic<int64_t> m_window_cost_ns { 0 };
+    std::atomic<int64_t> m_cost_ns { 0 };
+
+    // Totals of hits that were not exported one by one
+    std::atomic<uint64_t> m_aggregated { 0 };
+    std::atomic<int64_t> m_aggregated_dur_us { 0 };
+};
+
+/// @brief Keeps the tracing overhead of every call site within a budget.
+///
+/// Every WINDOW_HITS hits a site is re-evaluated. Its projected overhead is the hit rate times the
+/// measured cost of exporting one event, as a fraction of one CPU. Over the budget the site is
+/// sampled 1-in-N, with N chosen to bring it back within the budget; if exporting an event costs
+/// more than the scope itself, the site only aggregates. Sites return to full tracing once they
+/// cool down: a demoted site that goes quiet doesn't reach its next window, so a governor thread
+/// re-checks demoted sites every TICK, rating them by the hits since their window started. Every
+/// change is reported as an instant event in category "governor", and sites that
+/// did not export everything get a "governor_summary" event at shutdown.
+class Governor {
+public:
+    static constexpr uint64_t WINDOW_HITS { 1024 };
+    static constexpr uint64_t SHARD_WINDOW_HITS { WINDOW_HITS / CallSite::HIT_SHARDS };
+    static constexpr std::chrono::seconds TICK { 1 };
+
+    struct SiteStats {
+        const char* name;
+        CallSite::Mode mode;
+        uint32_t one_in;
+        uint64_t hits;
+        uint64_t exported;
+        int64_t aggregated_dur_us;
+    };
+
+    static Governor& instance();
+
+    /// @brief Enable the governor. The budget is a fraction of one CPU per call site, e.g. 0.01.
+    ///
+    /// Also enabled by the TRACER_OVERHEAD_BUDGET environment variable.
+    void configure(double budget);
+
+    static bool is_active() { return s_is_active.load(std::memory_order_relaxed); }
+
+    std::vector<SiteStats> sites();
+
+private:
+    friend class CallSite;
+
+    Governor() = default;
+
+    void add(CallSite& site);
+    void evaluate(CallSite& site, CallSite::Sink sink);
+
+    /// @brief Re-check the demoted sites whose window is older than a TICK, forever
+    void run_ticks();
+
+    static std::atomic_bool s_is_active;
+
+    std::atomic<double> m_budget { 0.0 };
+    std::mutex m_lock;
+    std::vector<CallSite*> m_sites;
+    std::once_flag m_ticks_started;
+};
+
+} // namespace Tracer
@@ -0,0 +1,58 @@
+#include "lock_stats.hpp"
+
+#include <Profiler/shutdown_hooks.hpp>
+#include <Profiler/trace.hpp>
+
+#include <unistd.h>
+
+namespace Tracer {
+
+LockRegistry& LockRegistry::instance()
+{
+    // Leaked on purpose: exporters read it from their destructors during static destruction.
+    static LockRegistry* instance = new LockRegistry;
+    return *instance;
+}
+
+LockRegistry::LockRegistry()
+{
+    register_shutdown_hook([](const EventSink& sink) {
+        for (const ChromeEvent& event : LockRegistry::instance().summary_events()) {
+            sink(event);
+        }
+    });
+}
+
+LockStats& LockRegistry::add(const char* name)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto& [key, stats] = *m_stats.try_emplace(name).first;
+    stats.name = key.c_str();
+    return stats;
+}
+
+std::vector<ChromeEvent> LockRegistry::summary_events()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    std::vector<ChromeEvent> events;
+    events.reserve(m_stats.size());
+    for (const auto& [name, stats] : m_stats) {
+        ChromeEvent event {};
+        event.name = stats.name;
+        event.cat = "lock_summary";
+        event.ph = 'i';
+        event.ts = get_unique_timestamp();
+        event.pid = getpid();
+        event.tid = static_cast<size_t>(get_thread_id());
+        add_args(event.args,
+            "acquisitions", stats.acquisitions.load(),
+            "contended", stats.contended.load(),
+            "wait_us", stats.wait_us.load(),
+            "contended_hold_us", stats.contended_hold_us.load());
+        events.push_back(std::move(event));
+    }
+    return events;
+}
+
+} // namespace Tracer
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Profiler/chrome_event.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Tracer {
+
+/// @brief Contention counters of the traced locks of one name.
+///
+/// Owned by the LockRegistry, so they outlive the locks themselves and can be reported when the
+/// exporter shuts down.
+struct LockStats {
+    const char* name { nullptr }; // the registry's key
+    std::atomic<uint64_t> acquisitions { 0 };
+    std::atomic<uint64_t> contended { 0 };
+    std::atomic<int64_t> wait_us { 0 };
+    std::atomic<int64_t> contended_hold_us { 0 }; // the uncontended path takes no timestamps
+};
+
+/// @brief Process-wide counters of traced locks, keyed by lock name.
+///
+/// Locks created with the same name share their counters, so locks that are created and destroyed
+/// repeatedly don't grow the registry.
+class LockRegistry {
+public:
+    static LockRegistry& instance();
+
+    /// @brief The counters of the locks named `name`, created on first use
+    LockStats& add(const char* name);
+
+    /// @brief One instant event per lock with its contention counters as args.
+    ///
+    /// Registered as a shutdown hook, so exporters push these right before shutting down.
+    std::vector<ChromeEvent> summary_events();
+
+private:
+    LockRegistry();
+
+    std::mutex m_lock;
+    std::unordered_map<std::string, LockStats> m_stats;
+};
+
+} // namespace Tracer
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <Profiler/tail_sampler.hpp>
 #include <Profiler/trace.hpp>
 
 namespace Tracer {
@@ -9,35 +10,80 @@ class IPCExporter;
 
 using Trace = TraceScope<FileExporter>;
 using IPCTrace = TraceScope<IPCExporter>;
+using AsyncTrace = AsyncSpan<FileExporter>;
+using IPCAsyncTrace = AsyncSpan<IPCExporter>;
 
 } // namespace Tracer
 
 // Macros for file-based tracing (default)
 #ifdef ENABLE_TRACING
 #define TRACE_SETUP(file) Tracer::FileExporter::instance(file)
-#define TRACE_SCOPE_CAT(name, cat) Tracer::Trace trace_##__LINE__(name, cat)
-#define TRACE_SCOPE(name) Tracer::Trace trace_##__LINE__(name)
+#define TRACE_SETUP_FLIGHT_RECORDER(file, capacity) Tracer::FileExporter::instance(file).enable_flight_recorder(capacity)
+#define TRACE_FLIGHT_RECORDER_DUMP() Tracer::FileExporter::instance().dump_flight_recorder()
+#define TRACE_SCOPE_CAT(name, cat)                 \
+    static Tracer::CallSite trace_site_##__LINE__; \
+    Tracer::Trace trace_##__LINE__(trace_site_##__LINE__, name, cat)
+#define TRACE_SCOPE(name) TRACE_SCOPE_CAT(name, "Default")
+#define TRACE_SCOPE_ARGS(name, cat, ...)           \
+    static Tracer::CallSite trace_site_##__LINE__; \
+    Tracer::Trace trace_##__LINE__(trace_site_##__LINE__, name, cat, __VA_ARGS__)
 #define TRACE_FN_CAT(cat) TRACE_SCOPE_CAT(__FUNCTION__, cat)
 #define TRACE_FN() TRACE_SCOPE(__FUNCTION__)
+#define TRACE_ASYNC_BEGIN(name, cat, id) Tracer::write_async_event<Tracer::FileExporter>('b', name, cat, id)
+#define TRACE_ASYNC_END(name, cat, id) Tracer::write_async_event<Tracer::FileExporter>('e', name, cat, id)
+#define TRACE_CONTEXT_EXPORT() Tracer::export_context<Tracer::FileExporter>().to_header()
+#define TRACE_CONTEXT_SCOPE(header) \
+    Tracer::ContextScope<Tracer::FileExporter> trace_context_##__LINE__(Tracer::TraceContext::from_header(header))
 #else
 #define TRACE_SETUP(file)
+#define TRACE_SETUP_FLIGHT_RECORDER(file, capacity)
+#define TRACE_FLIGHT_RECORDER_DUMP()
 #define TRACE_SCOPE_CAT(name, cat)
 #define TRACE_SCOPE(name)
+#define TRACE_SCOPE_ARGS(name, cat, ...)
 #define TRACE_FN_CAT(cat)
 #define TRACE_FN()
+#define TRACE_ASYNC_BEGIN(name, cat, id)
+#define TRACE_ASYNC_END(name, cat, id)
+#define TRACE_CONTEXT_EXPORT() std::string()
+#define TRACE_CONTEXT_SCOPE(header)
+#endif // ENABLE_TRACING
+
+// Sampling, for both file and IPC tracing
+#ifdef ENABLE_TRACING
+#define TRACE_TAIL_SAMPLING(root_cat, threshold_us, one_in_n) Tracer::TailSampler::instance().configure(root_cat, threshold_us, one_in_n)
+#define TRACE_OVERHEAD_BUDGET(budget) Tracer::Governor::instance().configure(budget)
+#else
+#define TRACE_TAIL_SAMPLING(root_cat, threshold_us, one_in_n)
+#define TRACE_OVERHEAD_BUDGET(budget)
 #endif // ENABLE_TRACING
 
 // Macros for IPC-based tracing
 #ifdef ENABLE_TRACING
 #define IPC_TRACE_SETUP(pipe) Tracer::IPCExporter::instance(pipe)
-#define IPC_TRACE_SCOPE_CAT(name, cat) Tracer::IPCTrace trace_##__LINE__(name, cat)
-#define IPC_TRACE_SCOPE(name) Tracer::IPCTrace trace_##__LINE__(name)
+#define IPC_TRACE_SCOPE_CAT(name, cat)             \
+    static Tracer::CallSite trace_site_##__LINE__; \
+    Tracer::IPCTrace trace_##__LINE__(trace_site_##__LINE__, name, cat)
+#define IPC_TRACE_SCOPE(name) IPC_TRACE_SCOPE_CAT(name, "Default")
+#define IPC_TRACE_SCOPE_ARGS(name, cat, ...)       \
+    static Tracer::CallSite trace_site_##__LINE__; \
+    Tracer::IPCTrace trace_##__LINE__(trace_site_##__LINE__, name, cat, __VA_ARGS__)
 #define IPC_TRACE_FN_CAT(cat) IPC_TRACE_SCOPE_CAT(__FUNCTION__, cat)
 #define IPC_TRACE_FN() IPC_TRACE_SCOPE(__FUNCTION__)
+#define IPC_TRACE_ASYNC_BEGIN(name, cat, id) Tracer::write_async_event<Tracer::IPCExporter>('b', name, cat, id)
+#define IPC_TRACE_ASYNC_END(name, cat, id) Tracer::write_async_event<Tracer::IPCExporter>('e', name, cat, id)
+#define IPC_TRACE_CONTEXT_EXPORT() Tracer::export_context<Tracer::IPCExporter>().to_header()
+#define IPC_TRACE_CONTEXT_SCOPE(header) \
+    Tracer::ContextScope<Tracer::IPCExporter> trace_context_##__LINE__(Tracer::TraceContext::from_header(header))
 #else
 #define IPC_TRACE_SETUP(pipe)
 #define IPC_TRACE_SCOPE_CAT(name, cat)
 #define IPC_TRACE_SCOPE(name)
+#define IPC_TRACE_SCOPE_ARGS(name, cat, ...)
 #define IPC_TRACE_FN_CAT(cat)
 #define IPC_TRACE_FN()
+#define IPC_TRACE_ASYNC_BEGIN(name, cat, id)
+#define IPC_TRACE_ASYNC_END(name, cat, id)
+#define IPC_TRACE_CONTEXT_EXPORT() std::string()
+#define IPC_TRACE_CONTEXT_SCOPE(header)
 #endif // ENABLE_TRACING
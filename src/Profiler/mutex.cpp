@@ -0,0 +1,58 @@
+#include "mutex.hpp"
+
+namespace Tracer {
+
+namespace {
+    template <class T>
+    int64_t emit_wait(LockStats& stats, int64_t wait_start)
+    {
+        const int64_t wait_end = get_unique_timestamp();
+        const int64_t wait = wait_end - wait_start;
+
+        stats.contended.fetch_add(1, std::memory_order_relaxed);
+        stats.wait_us.fetch_add(wait, std::memory_order_relaxed);
+
+        // The name is the registry's key, it lives as long as the process
+        EventArgs args {};
+        args.add_unowned("lock", stats.name);
+        write_complete_event<T>("lock_wait", "lock", wait_start, wait, args);
+        return wait_end;
+    }
+} // namespace
+
+template <class T, class Mutex>
+void TracedMutex<T, Mutex>::lock_contended()
+{
+    const int64_t wait_start = get_unique_timestamp();
+    m_mutex.lock();
+    m_hold_start = emit_wait<T>(m_stats, wait_start);
+}
+
+template <class T, class Mutex>
+void TracedMutex<T, Mutex>::finish_hold(int64_t hold_start)
+{
+    const int64_t hold = get_unique_timestamp() - hold_start;
+    m_stats.contended_hold_us.fetch_add(hold, std::memory_order_relaxed);
+
+    EventArgs args {};
+    args.add_unowned("lock", m_stats.name);
+    write_complete_event<T>("lock_hold", "lock", hold_start, hold, args);
+}
+
+template <class T>
+void TracedSharedMutex<T>::lock_shared_contended()
+{
+    const int64_t wait_start = get_unique_timestamp();
+    this->m_mutex.lock_shared();
+    emit_wait<T>(this->m_stats, wait_start);
+}
+
+} // namespace Tracer
+
+// Explicit template instantiation
+template class Tracer::TracedMutex<Tracer::FileExporter>;
+template class Tracer::TracedMutex<Tracer::IPCExporter>;
+template class Tracer::TracedMutex<Tracer::FileExporter, std::shared_mutex>;
+template class Tracer::TracedMutex<Tracer::IPCExporter, std::shared_mutex>;
+template class Tracer::TracedSharedMutex<Tracer::FileExporter>;
+template class Tracer::TracedSharedMutex<Tracer::IPCExporter>;
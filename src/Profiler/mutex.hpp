@@ -0,0 +1,101 @@
+#pragma once
+
+// Requires C++17 (std::shared_mutex).
+
+#include <Profiler/lock_stats.hpp>
+#include <Profiler/trace.hpp>
+
+#include <mutex>
+#include <shared_mutex>
+
+namespace Tracer {
+
+/// @brief Drop-in mutex wrapper that traces lock contention.
+///
+/// The uncontended path is a plain try_lock: no timestamps, no events. Only when try_lock fails the
+/// waiter timestamps the wait and emits a "lock_wait" slice, and the hold time of that acquisition
+/// is emitted as a "lock_hold" slice on unlock. Both carry the lock name as the "lock" arg. The
+/// counters of every lock are reported as a "lock_summary" event when the exporter shuts down.
+template <class T = FileExporter, class Mutex = std::mutex>
+class TracedMutex {
+public:
+    explicit TracedMutex(const char* name = "mutex")
+        : m_stats(LockRegistry::instance().add(name))
+    {
+    }
+
+    TracedMutex(const TracedMutex&) = delete;
+    TracedMutex& operator=(const TracedMutex&) = delete;
+
+    void lock()
+    {
+        if (!m_mutex.try_lock()) {
+            lock_contended();
+        }
+        m_stats.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool try_lock()
+    {
+        const bool is_locked = m_mutex.try_lock();
+        std::ignore = is_locked && m_stats.acquisitions.fetch_add(1, std::memory_order_relaxed);
+        return is_locked;
+    }
+
+    void unlock()
+    {
+        // Only the owner touches m_hold_start, read it before releasing
+        const int64_t hold_start = m_hold_start;
+        m_hold_start = 0;
+        m_mutex.unlock();
+        if (hold_start != 0) {
+            finish_hold(hold_start);
+        }
+    }
+
+protected:
+    /// @brief Slow path: time the blocking acquisition
+    void lock_contended();
+
+    /// @brief Emit the hold slice of a contended acquisition
+    void finish_hold(int64_t hold_start);
+
+    Mutex m_mutex;
+    LockStats& m_stats;
+    int64_t m_hold_start { 0 };
+};
+
+/// @brief TracedMutex over std::shared_mutex.
+///
+/// Shared acquisitions report their wait time only: shared holders overlap, so there is no single
+/// hold interval to attribute.
+template <class T = FileExporter>
+class TracedSharedMutex : public TracedMutex<T, std::shared_mutex> {
+public:
+    using TracedMutex<T, std::shared_mutex>::TracedMutex;
+
+    void lock_shared()
+    {
+        if (!this->m_mutex.try_lock_shared()) {
+            lock_shared_contended();
+        }
+        this->m_stats.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool try_lock_shared()
+    {
+        const bool is_locked = this->m_mutex.try_lock_shared();
+        std::ignore = is_locked && this->m_stats.acquisitions.fetch_add(1, std::memory_order_relaxed);
+        return is_locked;
+    }
+
+    void unlock_shared() { this->m_mutex.unlock_shared(); }
+
+private:
+    void lock_shared_contended();
+};
+
+using IPCTracedMutex = TracedMutex<IPCExporter>;
+using IPCTracedSharedMutex = TracedSharedMutex<IPCExporter>;
+
+} // namespace Tracer
@@ -0,0 +1,45 @@
+#include "shutdown_hooks.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace Tracer {
+
+namespace {
+    struct HookList {
+        std::mutex lock;
+        std::vector<ShutdownHook> hooks;
+    };
+
+    HookList& hook_list()
+    {
+        // Leaked on purpose: exporters run the hooks during static destruction.
+        static HookList* list = new HookList;
+        return *list;
+    }
+} // namespace
+
+void register_shutdown_hook(ShutdownHook hook)
+{
+    HookList& list = hook_list();
+    std::lock_guard<std::mutex> lock(list.lock);
+    if (std::find(list.hooks.begin(), list.hooks.end(), hook) == list.hooks.end()) {
+        list.hooks.push_back(hook);
+    }
+}
+
+void run_shutdown_hooks(const EventSink& sink)
+{
+    std::vector<ShutdownHook> hooks;
+    {
+        HookList& list = hook_list();
+        std::lock_guard<std::mutex> lock(list.lock);
+        hooks = list.hooks;
+    }
+    for (ShutdownHook hook : hooks) {
+        hook(sink);
+    }
+}
+
+} // namespace Tracer
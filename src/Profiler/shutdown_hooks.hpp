@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Profiler/chrome_event.hpp>
+
+#include <functional>
+
+namespace Tracer {
+
+using EventSink = std::function<void(const ChromeEvent&)>;
+
+/// @brief Callback that hands its pending events to the exporter that is shutting down
+using ShutdownHook = void (*)(const EventSink& sink);
+
+/// @brief Register a hook that exporters run right before writing their last event.
+///
+/// Registering the same hook twice has no effect.
+void register_shutdown_hook(ShutdownHook hook);
+
+/// @brief Called by exporters from their destructors
+void run_shutdown_hooks(const EventSink& sink);
+
+} // namespace Tracer
@@ -0,0 +1,139 @@
+#include "tail_sampler.hpp"
+
+#include <Profiler/shutdown_hooks.hpp>
+#include <Profiler/trace.hpp>
+
+#include <algorithm>
+
+#include <unistd.h>
+
+namespace Tracer {
+
+namespace {
+    struct ThreadSubtree {
+        const void* exporter;
+        int depth { 0 };
+        std::vector<ChromeEvent> events;
+    };
+
+    /// @brief One subtree per exporter the thread traces to, usually just one
+    thread_local std::vector<ThreadSubtree> t_subtrees;
+
+    ThreadSubtree* find_subtree(const void* exporter)
+    {
+        auto it = std::find_if(t_subtrees.begin(), t_subtrees.end(),
+            [exporter](const ThreadSubtree& subtree) { return subtree.exporter == exporter; });
+        return it != t_subtrees.end() ? &*it : nullptr;
+    }
+} // namespace
+
+std::atomic_bool TailSampler::s_is_active { false };
+
+TailSampler& TailSampler::instance()
+{
+    // Leaked on purpose: scopes may still close during static destruction.
+    static TailSampler* instance = new TailSampler;
+    return *instance;
+}
+
+void TailSampler::configure(const char* root_cat, int64_t threshold_us, uint64_t one_in_n)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_configs.push_back(std::make_unique<Config>(Config { root_cat, threshold_us, one_in_n }));
+        m_config.store(m_configs.back().get(), std::memory_order_release);
+    }
+
+    register_shutdown_hook([](const EventSink& sink) {
+        const Stats stats = TailSampler::instance().stats();
+        ChromeEvent event {};
+        event.name = "tail_sampling";
+        event.cat = "sampling_summary";
+        event.ph = 'i';
+        event.ts = get_unique_timestamp();
+        event.pid = getpid();
+        event.tid = static_cast<size_t>(get_thread_id());
+        add_args(event.args,
+            "roots", stats.roots,
+            "kept_roots", stats.kept_roots,
+            "dropped_events", stats.dropped_events);
+        sink(event);
+    });
+    s_is_active = true;
+}
+
+bool TailSampler::begin_scope(const std::string& cat, const void* exporter)
+{
+    const Config* config = m_config.load(std::memory_order_acquire);
+    if (config == nullptr || cat != config->root_cat) {
+        return false;
+    }
+    ThreadSubtree* subtree = find_subtree(exporter);
+    if (subtree == nullptr) {
+        subtree = &t_subtrees.emplace_back(ThreadSubtree { exporter, 0, {} });
+    }
+    ++subtree->depth;
+    return true;
+}
+
+bool TailSampler::hold(const ChromeEvent& event, const void* exporter)
+{
+    // Async events may end on another thread, so they are never part of a subtree
+    ThreadSubtree* subtree = find_subtree(exporter);
+    if (subtree == nullptr || subtree->depth == 0 || is_async_phase(event.ph)) {
+        return false;
+    }
+    if (subtree->events.size() < MAX_BUFFERED_EVENTS) {
+        subtree->events.push_back(event);
+    } else {
+        m_dropped_events.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+std::vector<ChromeEvent> TailSampler::end_root(ChromeEvent root, const void* exporter)
+{
+    ThreadSubtree* found = find_subtree(exporter);
+    if (found == nullptr || found->depth == 0 || --found->depth != 0) {
+        hold(root, exporter);
+        return {};
+    }
+    ThreadSubtree& subtree = *found;
+
+    std::vector<ChromeEvent> events;
+    events.swap(subtree.events);
+
+    const uint64_t root_number = m_roots.fetch_add(1, std::memory_order_relaxed);
+    const Config& config = *m_config.load(std::memory_order_acquire);
+    const uint64_t one_in_n = config.one_in_n;
+    const char* rule = nullptr;
+    if (root.dur >= config.threshold_us) {
+        rule = "threshold";
+    } else if (one_in_n != 0 && root_number % one_in_n == 0) {
+        rule = "one_in_n";
+    }
+
+    if (rule == nullptr) {
+        m_dropped_events.fetch_add(events.size() + 1, std::memory_order_relaxed);
+        // Keep the capacity for the next root of this thread
+        events.clear();
+        subtree.events.swap(events);
+        return {};
+    }
+
+    m_kept_roots.fetch_add(1, std::memory_order_relaxed);
+    root.args.add("sampling", rule);
+    events.push_back(std::move(root));
+    return events;
+}
+
+TailSampler::Stats TailSampler::stats() const
+{
+    return {
+        m_roots.load(),
+        m_kept_roots.load(),
+        m_dropped_events.load(),
+    };
+}
+
+} // namespace Tracer
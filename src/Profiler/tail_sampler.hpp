@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Profiler/chrome_event.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Tracer {
+
+/// @brief Tail-based sampling of request subtrees.
+///
+/// Scopes of the root category open a subtree on the calling thread. Every complete event the
+/// thread emits until the outermost root closes is held back. The subtree is exported only if the
+/// root lasted at least the threshold, or if it is one of every `one_in_n` roots; otherwise it is
+/// dropped as a whole. Kept roots carry a `sampling` argument telling which rule kept them.
+///
+/// Subtrees are kept per exporter: `exporter` identifies the exporter a scope or event is bound
+/// for, and only events of the root's own exporter are held, so a subtree is always exported where
+/// it was recorded.
+class TailSampler {
+public:
+    /// @brief Limit on held back events per thread, later events of the subtree are dropped
+    static constexpr size_t MAX_BUFFERED_EVENTS { 65536 };
+
+    struct Stats {
+        uint64_t roots;
+        uint64_t kept_roots;
+        uint64_t dropped_events;
+    };
+
+    static TailSampler& instance();
+
+    /// @brief Enable sampling. A `one_in_n` of 0 keeps only the roots over the threshold.
+    ///
+    /// May be called again while scopes are open, they see either the old or the new settings.
+    void configure(const char* root_cat, int64_t threshold_us, uint64_t one_in_n = 0);
+
+    static bool is_active() { return s_is_active.load(std::memory_order_acquire); }
+
+    /// @brief Called when a scope opens. Returns true for root scopes, which must close with end_root().
+    bool begin_scope(const std::string& cat, const void* exporter);
+
+    /// @brief Hold back the event if the calling thread is inside a root of the same exporter.
+    /// Returns true if held.
+    bool hold(const ChromeEvent& event, const void* exporter);
+
+    /// @brief Close a root of the calling thread. Nested roots are held like any other event.
+    ///
+    /// Closing the outermost root returns the subtree to export including the root itself, empty when the root was not sampled.
+    std::vector<ChromeEvent> end_root(ChromeEvent root, const void* exporter);
+
+    Stats stats() const;
+
+private:
+    struct Config {
+        std::string root_cat;
+        int64_t threshold_us;
+        uint64_t one_in_n;
+    };
+
+    TailSampler() = default;
+
+    static std::atomic_bool s_is_active;
+
+    /// @var m_config Current settings. Replaced ones are kept in m_configs, a scope may still be
+    /// reading them.
+    std::atomic<const Config*> m_config { nullptr };
+
+    std::mutex m_lock;
+    std::vector<std::unique_ptr<Config>> m_configs;
+
+    std::atomic<uint64_t> m_roots { 0 };
+    std::atomic<uint64_t> m_kept_roots { 0 };
+    std::atomic<uint64_t> m_dropped_events { 0 };
+};
+
+} // namespace Tracer
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <limits>
+#include <sstream>
 
 int main(int /* argc */, char* /* argv */[])
 {
@@ -30,5 +31,45 @@ int main(int /* argc */, char* /* argv */[])
         std::cerr << "Expected: " << expected_json << '\n';
         throw std::logic_error("Validation failed: JSON output does not match expected output");
     }
+
+    Tracer::add_args(event.args, "bytes", 4096, "ratio", 0.5, "shard", "eu-\"1\"");
+    event_json = Tracer::serialize_to_json(event);
+
+    static constexpr std::string_view expected_args_json {
+        R"({"name":"Test Event","cat":"default","ph":"X","ts":9223372036854775807,"pid":2147483647,"tid":2147483647,"dur":1000,"args":{"bytes":4096,"ratio":0.5,"shard":"eu-\"1\""}})"
+    };
+
+    if (event_json.compare(expected_args_json) != 0) {
+        std::cerr << "TraceEvent: " << event_json << '\n';
+        std::cerr << "Expected: " << expected_args_json << '\n';
+        throw std::logic_error("Validation failed: JSON args do not match expected output");
+    }
+
+    // Async events carry an id and no duration
+    Tracer::ChromeEvent async_event = event;
+    async_event.ph = 'b';
+    async_event.id = 0x2a00000001;
+    async_event.args = {};
+
+    static constexpr std::string_view expected_async_json {
+        R"({"name":"Test Event","cat":"default","ph":"b","ts":9223372036854775807,"pid":2147483647,"tid":2147483647,"id":"0x2a00000001"})"
+    };
+
+    if (Tracer::serialize_to_json(async_event).compare(expected_async_json) != 0) {
+        std::cerr << "TraceEvent: " << Tracer::serialize_to_json(async_event) << '\n';
+        std::cerr << "Expected: " << expected_async_json << '\n';
+        throw std::logic_error("Validation failed: async JSON output does not match expected output");
+    }
+
+    // Arguments must survive the IPC stream round trip
+    Tracer::ChromeEvent decoded {};
+    std::stringstream ss;
+    ss << event;
+    ss >> decoded;
+
+    if (!ss || Tracer::serialize_to_json(decoded).compare(expected_args_json) != 0) {
+        std::cerr << "Decoded: " << Tracer::serialize_to_json(decoded) << '\n';
+        throw std::logic_error("Validation failed: stream round trip does not preserve the event");
+    }
     return 0;
 }
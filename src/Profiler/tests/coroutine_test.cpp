@@ -0,0 +1,209 @@
+#include <Profiler/coroutine.hpp>
+#include <Profiler/macros.hpp>
+
+#include <coroutine>
+#include <fstream>
+#include <future>
+#include <map>
+#include <mutex>
+#include <print>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// Fire-and-forget coroutine that signals completion through a promise
+struct Task {
+    struct promise_type {
+        std::promise<void> done;
+
+        Task get_return_object() { return { done.get_future() }; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() { done.set_value(); }
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    std::future<void> finished;
+};
+
+// Awaitable that resumes the coroutine on a freshly spawned thread
+class ResumeOnNewThread {
+public:
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        s_threads.emplace_back([handle]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            handle.resume();
+        });
+    }
+    void await_resume() { }
+
+    static void join_all()
+    {
+        std::vector<std::jthread> threads;
+        {
+            std::lock_guard<std::mutex> lock(s_lock);
+            threads.swap(s_threads);
+        }
+    }
+
+private:
+    static inline std::mutex s_lock;
+    static inline std::vector<std::jthread> s_threads;
+};
+
+// Awaitable that is ready immediately, so no steps are emitted
+struct AlreadyReady {
+    bool await_ready() { return true; }
+    void await_suspend(std::coroutine_handle<>) { }
+    int await_resume() { return 42; }
+};
+
+Task pipeline_stage(int stage)
+{
+    Tracer::CoroutineTrace span("pipeline_stage", "coroutine");
+    {
+        // Thread scopes must end before the first co_await, the coroutine may resume elsewhere
+        TRACE_SCOPE_ARGS("prepare", "coroutine", "stage", stage);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        co_await span.traced(ResumeOnNewThread {});
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    std::ignore = co_await span.traced(AlreadyReady {});
+}
+
+void manual_async_span()
+{
+    Tracer::AsyncTrace span("handoff", "async");
+    std::thread([span = std::move(span)]() mutable {
+        span.begin_step("worker");
+        std::this_thread::sleep_for(std::chrono::milliseconds(3));
+        span.end_step("worker");
+        span.end();
+    }).join();
+
+    const uint64_t id = Tracer::next_async_id();
+    TRACE_ASYNC_BEGIN("request", "async", id);
+    std::thread([id]() { TRACE_ASYNC_END("request", "async", id); }).join();
+}
+
+/// @brief The value of `"key":` in an event object of the dump, without quotes
+std::string field(const std::string& event, const std::string& key)
+{
+    const std::string pattern = "\"" + key + "\":";
+    size_t start = event.find(pattern);
+    if (start == std::string::npos) {
+        return {};
+    }
+    start += pattern.size();
+    const size_t end = event.find_first_of(",}", start);
+    std::string value = event.substr(start, end - start);
+    std::erase(value, '"');
+    return value;
+}
+
+/// @brief The events of a flight recorder dump
+std::vector<std::string> read_events(const char* path)
+{
+    std::ifstream in { path };
+    std::stringstream content;
+    content << in.rdbuf();
+    const std::string text = content.str();
+
+    std::vector<std::string> events;
+    const std::string start = R"({"name":)";
+    for (size_t pos = text.find(start); pos != std::string::npos;) {
+        const size_t next = text.find(start, pos + 1);
+        events.push_back(text.substr(pos, next - pos));
+        pos = next;
+    }
+    return events;
+}
+
+/// @brief Every async begin has an end with the same name and id, some of them on another thread
+bool check_async_pairs(const std::vector<std::string>& events)
+{
+    using Key = std::tuple<std::string, std::string>;
+    std::map<Key, std::vector<std::string>> open_tids;
+    size_t pairs = 0;
+    size_t moved = 0;
+    for (const std::string& event : events) {
+        const std::string ph = field(event, "ph");
+        const Key key { field(event, "name"), field(event, "id") };
+        if (ph == "b") {
+            open_tids[key].push_back(field(event, "tid"));
+        } else if (ph == "e") {
+            auto open = open_tids.find(key);
+            if (open == open_tids.end() || open->second.empty()) {
+                std::println(stderr, "End of {} {} without a begin", std::get<0>(key), std::get<1>(key));
+                return false;
+            }
+            moved += open->second.back() != field(event, "tid") ? 1 : 0;
+            open->second.pop_back();
+            ++pairs;
+        }
+    }
+    for (const auto& [key, tids] : open_tids) {
+        if (!tids.empty()) {
+            std::println(stderr, "Begin of {} {} without an end", std::get<0>(key), std::get<1>(key));
+            return false;
+        }
+    }
+    if (pairs == 0 || moved == 0) {
+        std::println(stderr, "Expected async spans ending on other threads, got {} pairs, {} moved", pairs, moved);
+        return false;
+    }
+    return true;
+}
+
+int main(int /* argc */, char* /* argv */[])
+{
+    TRACE_SETUP_FLIGHT_RECORDER("trace_coroutine.json", 4096);
+    TRACE_FN();
+
+    std::println("1. Testing coroutines resumed on other threads...");
+    std::vector<Task> tasks;
+    for (int i = 0; i < 4; ++i) {
+        tasks.push_back(pipeline_stage(i));
+    }
+    for (auto& task : tasks) {
+        task.finished.wait();
+    }
+    ResumeOnNewThread::join_all();
+
+    std::println("2. Testing async spans moved across threads...");
+    manual_async_span();
+
+    std::println("3. Checking the trace...");
+    TRACE_FLIGHT_RECORDER_DUMP();
+    const std::vector<std::string> events = read_events("trace_coroutine.flight-0.json");
+    if (!check_async_pairs(events)) {
+        return 1;
+    }
+    // The thread scope ends before the coroutine moves, it lasts about the 2ms it sleeps
+    size_t prepares = 0;
+    for (const std::string& event : events) {
+        if (field(event, "name") != "prepare") {
+            continue;
+        }
+        ++prepares;
+        if (std::stoll(field(event, "dur")) >= 15'000) {
+            std::println(stderr, "A prepare scope lasted {}us", field(event, "dur"));
+            return 1;
+        }
+    }
+    if (prepares != 4) {
+        std::println(stderr, "Expected 4 prepare scopes, got {}", prepares);
+        return 1;
+    }
+
+    std::println("\nCoroutine test complete.");
+    return 0;
+}
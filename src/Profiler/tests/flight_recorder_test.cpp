@@ -0,0 +1,167 @@
+#include <Profiler/exporters/flight_recorder.hpp>
+#include <Profiler/macros.hpp>
+
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <print>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static constexpr size_t CAPACITY { 64 };
+
+std::string read_file(const char* path)
+{
+    std::ifstream in { path };
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+size_t count_of(const std::string& content, const std::string& pattern)
+{
+    size_t count = 0;
+    for (size_t pos = content.find(pattern); pos != std::string::npos; pos = content.find(pattern, pos + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+bool check_dump(const char* path, size_t min_events)
+{
+    const std::string content = read_file(path);
+    if (content.rfind(R"({"traceEvents":[)", 0) != 0 || content.find(R"(],"displayTimeUnit":"ns"})") == std::string::npos) {
+        std::println(stderr, "{} is not a complete trace", path);
+        return false;
+    }
+    const size_t events = count_of(content, R"({"name":)");
+    if (events < min_events || events > CAPACITY + 2) {
+        std::println(stderr, "{} has {} events", path, events);
+        return false;
+    }
+    if (count_of(content, R"("name":"open_scope","cat":"flight","ph":"B")") != 1) {
+        std::println(stderr, "{} is missing the open scope", path);
+        return false;
+    }
+    return true;
+}
+
+volatile bool g_is_deep_enough { false };
+
+int overflow(int depth)
+{
+    volatile char frame[1024];
+    frame[0] = static_cast<char>(depth);
+    return g_is_deep_enough ? 0 : overflow(depth + 1) + frame[0];
+}
+
+/// @brief Every writer_<n> slice carries "writer":<n>, a record mixed from two writers doesn't
+bool check_records(const std::string& content)
+{
+    std::istringstream lines(content);
+    std::string line;
+    while (std::getline(lines, line)) {
+        // Open scopes (ph B) are written without args
+        const size_t name = line.find(R"("name":"writer_)");
+        if (name == std::string::npos || line.find(R"("ph":"X")") == std::string::npos) {
+            continue;
+        }
+        const std::string writer = line.substr(name + 15, line.find('"', name + 15) - name - 15);
+        if (line.find(R"("writer":)" + writer + "}") == std::string::npos) {
+            std::println(stderr, "Torn record: {}", line);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int /* argc */, char* /* argv */[])
+{
+    TRACE_SETUP_FLIGHT_RECORDER("trace_flight.json", CAPACITY);
+    TRACE_SCOPE_CAT("open_scope", "flight");
+
+    std::println("1. Testing ring overwrite...");
+    for (int i = 0; i < 1000; ++i) {
+        TRACE_SCOPE_ARGS("loop_iteration", "flight", "iteration", i);
+    }
+    std::thread([] {
+        for (int i = 0; i < 100; ++i) {
+            TRACE_SCOPE_ARGS("thread_iteration", "flight", "ratio", i / 3.0);
+        }
+    }).join();
+
+    std::println("2. Testing dump on API call...");
+    if (!TRACE_FLIGHT_RECORDER_DUMP() || !check_dump("trace_flight.flight-0.json", CAPACITY)) {
+        return 1;
+    }
+    if (count_of(read_file("trace_flight.flight-0.json"), R"("iteration":999)") != 0) {
+        std::println(stderr, "Thread events didn't overwrite the oldest events");
+        return 1;
+    }
+
+    std::println("3. Testing dump on SIGUSR1...");
+    {
+        TRACE_SCOPE_CAT("before_signal", "flight");
+    }
+    raise(SIGUSR1);
+    if (!check_dump("trace_flight.flight-1.json", CAPACITY)) {
+        return 1;
+    }
+    if (count_of(read_file("trace_flight.flight-1.json"), R"("name":"before_signal")") != 1) {
+        std::println(stderr, "Latest event missing from the signal dump");
+        return 1;
+    }
+
+    std::println("4. Testing a stack overflow on another thread...");
+    std::remove("trace_flight.flight-2.json");
+    const pid_t child = fork();
+    if (child == 0) {
+        std::thread([] {
+            TRACE_SCOPE_CAT("overflowing", "flight");
+            overflow(0);
+        }).join();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFSIGNALED(status) || WTERMSIG(status) != SIGSEGV || count_of(read_file("trace_flight.flight-2.json"), R"("name":"overflowing")") != 1) {
+        std::println(stderr, "No dump after the stack overflow");
+        return 1;
+    }
+
+    std::println("5. Testing dumps while the ring wraps...");
+    std::atomic_bool is_done { false };
+    std::vector<std::thread> writers;
+    for (int writer = 0; writer < 8; ++writer) {
+        writers.emplace_back([writer, &is_done] {
+            const std::string name = std::format("writer_{}", writer);
+            while (!is_done) {
+                TRACE_SCOPE_ARGS(name.c_str(), "flight", "writer", writer);
+            }
+        });
+    }
+    for (int dump = 0; dump < 20; ++dump) {
+        const std::string path = std::format("trace_flight.wrap-{}.json", dump);
+        if (!Tracer::FlightRecorder::instance().dump_to(path.c_str()) || !check_records(read_file(path.c_str()))) {
+            is_done = true;
+            for (std::thread& thread : writers) {
+                thread.join();
+            }
+            return 1;
+        }
+        std::remove(path.c_str());
+    }
+    is_done = true;
+    for (std::thread& thread : writers) {
+        thread.join();
+    }
+
+    std::println("\nFlight recorder test complete.");
+    return 0;
+}
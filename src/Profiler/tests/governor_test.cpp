@@ -0,0 +1,79 @@
+#include <Profiler/macros.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <print>
+#include <thread>
+#include <vector>
+
+int hot_work(int value)
+{
+    TRACE_SCOPE_CAT("hot_scope", "governor");
+    return value * 7 % 13;
+}
+
+void cold_work()
+{
+    TRACE_SCOPE_CAT("cold_scope", "governor");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+const Tracer::Governor::SiteStats* find_site(const std::vector<Tracer::Governor::SiteStats>& sites, const char* name)
+{
+    for (const auto& site : sites) {
+        if (std::strcmp(site.name, name) == 0) {
+            return &site;
+        }
+    }
+    return nullptr;
+}
+
+int main(int /* argc */, char* /* argv */[])
+{
+    TRACE_SETUP("trace_governor.json");
+    TRACE_OVERHEAD_BUDGET(0.01);
+
+    std::println("1. Testing a scope in a tight loop...");
+    int sum { 0 };
+    for (int i = 0; i < 200000; ++i) {
+        sum += hot_work(i);
+    }
+
+    std::println("2. Testing a scope that is cheap to trace...");
+    for (int i = 0; i < 50; ++i) {
+        cold_work();
+    }
+
+    const auto sites = Tracer::Governor::instance().sites();
+    const auto* hot = find_site(sites, "hot_scope");
+    const auto* cold = find_site(sites, "cold_scope");
+    if (hot == nullptr || cold == nullptr) {
+        std::println(stderr, "Call sites were not registered");
+        return 1;
+    }
+    if (hot->mode == Tracer::CallSite::Mode::FULL || hot->exported * 10 > hot->hits) {
+        std::println(stderr, "Hot scope was not throttled: {} of {} hits exported", hot->exported, hot->hits);
+        return 1;
+    }
+    if (cold->mode != Tracer::CallSite::Mode::FULL || cold->exported != cold->hits) {
+        std::println(stderr, "Cold scope was throttled");
+        return 1;
+    }
+
+    std::println("3. Testing a throttled scope that goes quiet...");
+    const auto deadline = std::chrono::steady_clock::now() + 3 * Tracer::Governor::TICK;
+    const Tracer::Governor::SiteStats* quiet = hot;
+    std::vector<Tracer::Governor::SiteStats> quiet_sites;
+    while (quiet->mode != Tracer::CallSite::Mode::FULL && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        quiet_sites = Tracer::Governor::instance().sites();
+        quiet = find_site(quiet_sites, "hot_scope");
+    }
+    if (quiet->mode != Tracer::CallSite::Mode::FULL) {
+        std::println(stderr, "A quiet scope stayed throttled");
+        return 1;
+    }
+
+    std::println("\nGovernor test complete ({} of {} hot hits exported, sum {}).", hot->exported, hot->hits, sum);
+    return 0;
+}
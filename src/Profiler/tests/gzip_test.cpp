@@ -0,0 +1,98 @@
+#include <Profiler/chrome_event.hpp>
+#include <Profiler/exporters/gzip_writer.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <zlib.h>
+
+namespace {
+constexpr const char* PATH { "/tmp/gzip_test.json.gz" };
+
+/// @brief Decompress a whole file, gzread continues across members
+bool read_gzip(const char* path, std::string& content)
+{
+    gzFile file = gzopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    char buffer[65536];
+    int read = 0;
+    while ((read = gzread(file, buffer, sizeof(buffer))) > 0) {
+        content.append(buffer, static_cast<size_t>(read));
+    }
+    const bool is_complete = read == 0;
+    gzclose(file);
+    return is_complete;
+}
+
+/// @brief Compressed size of the first member
+size_t first_member_size(const std::string& compressed)
+{
+    z_stream stream {};
+    inflateInit2(&stream, 15 + 16);
+    std::string out(Tracer::GzipWriter::BLOCK_SIZE * 2, '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+    stream.avail_in = static_cast<uInt>(compressed.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+    const int result = inflate(&stream, Z_FINISH);
+    const size_t size = result == Z_STREAM_END ? stream.total_in : 0;
+    inflateEnd(&stream);
+    return size;
+}
+} // namespace
+
+int main(int /* argc */, char* /* argv */[])
+{
+    // Three blocks of events: two full ones and the rest written at close
+    std::string expected { Tracer::TRACE_EVENTS };
+    {
+        Tracer::GzipWriter writer(PATH);
+        writer.write(expected);
+        Tracer::ChromeEvent event {};
+        event.name = "step";
+        event.cat = "test";
+        event.ph = 'X';
+        event.pid = 1;
+        event.dur = 25;
+        for (int64_t i = 0; expected.size() < Tracer::GzipWriter::BLOCK_SIZE * 5 / 2; ++i) {
+            event.ts = 1'700'000'000'000'000 + i * 40;
+            event.tid = static_cast<size_t>(i % 8);
+            const std::string json = (i == 0 ? "\n" : ",\n") + Tracer::serialize_to_json(event);
+            writer.write(json);
+            expected += json;
+        }
+        const std::string footer = std::string("\n") + Tracer::TRACE_EVENT_BODY;
+        writer.write(footer);
+        expected += footer;
+    }
+
+    std::string content;
+    if (!read_gzip(PATH, content) || content != expected) {
+        std::cerr << "Decompressed " << content.size() << " bytes, expected " << expected.size() << '\n';
+        return 1;
+    }
+    const auto compressed_size = std::filesystem::file_size(PATH);
+    std::cout << "Compressed " << expected.size() << " bytes to " << compressed_size << '\n';
+
+    // Cut after the first member, as if the process stopped there: still a valid gzip file
+    std::string compressed(compressed_size, '\0');
+    FILE* file = std::fopen(PATH, "rb");
+    const size_t read = std::fread(&compressed[0], 1, compressed.size(), file);
+    std::fclose(file);
+    const size_t member_size = first_member_size(compressed);
+    if (read != compressed.size() || member_size == 0 || member_size >= compressed.size()) {
+        std::cerr << "No member boundary found\n";
+        return 1;
+    }
+    std::filesystem::resize_file(PATH, member_size);
+    content.clear();
+    if (!read_gzip(PATH, content) || content != expected.substr(0, content.size()) || content.size() < Tracer::GzipWriter::BLOCK_SIZE) {
+        std::cerr << "Truncated file decompressed to " << content.size() << " bytes\n";
+        return 1;
+    }
+    std::filesystem::remove(PATH);
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <Profiler/function_tracer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @brief Stands in for an exporter, so the test can inspect what the runtime exported
+class CollectingExporter {
+public:
+    static CollectingExporter& instance()
+    {
+        static CollectingExporter instance;
+        return instance;
+    }
+
+    void push_trace(const Tracer::ChromeEvent& event)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        events.push_back(event);
+    }
+
+    size_t count(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return static_cast<size_t>(std::count_if(events.begin(), events.end(),
+            [&name](const Tracer::ChromeEvent& event) { return event.name == name; }));
+    }
+
+    std::vector<Tracer::ChromeEvent> events;
+
+private:
+    std::mutex m_lock;
+};
+
+__attribute__((noinline)) int fast_leaf(int value)
+{
+    return value * 3 + 1;
+}
+
+__attribute__((noinline)) static void slow_function()
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+}
+
+__attribute__((noinline)) void worker()
+{
+    for (int i = 0; i < 3; ++i) {
+        slow_function();
+    }
+}
+
+int main(int /* argc */, char* /* argv */[])
+{
+    auto& tracer = Tracer::FunctionTracer::instance();
+    tracer.use_exporter<CollectingExporter>();
+    tracer.set_min_duration_us(500);
+
+    std::println("1. Testing short call filtering...");
+    int sum { 0 };
+    for (int i = 0; i < 100000; ++i) {
+        sum += fast_leaf(i);
+    }
+    slow_function();
+
+    std::println("2. Testing calls on another thread...");
+    std::thread thread(worker);
+    thread.join();
+
+    tracer.flush();
+    auto& exporter = CollectingExporter::instance();
+
+    // A preempted call can still cross the threshold, but almost all of them must be dropped
+    if (exporter.count("fast_leaf(int)") > 10) {
+        std::println(stderr, "Short calls were not filtered");
+        return 1;
+    }
+    if (exporter.count("slow_function()") != 4) {
+        std::println(stderr, "Expected 4 slow_function() events, got {}", exporter.count("slow_function()"));
+        for (const auto& event : exporter.events) {
+            std::println(stderr, "  {}", event.name);
+        }
+        return 1;
+    }
+    if (exporter.count("worker()") != 1) {
+        std::println(stderr, "Missing worker() event of the exited thread");
+        return 1;
+    }
+
+    std::println("\nInstrument test complete ({} events, sum {}).", exporter.events.size(), sum);
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <Profiler/chrome_event.hpp>
+#include <Profiler/exporters/mapped_writer.hpp>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <csignal>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+constexpr const char* PATH { "/tmp/mapped_writer_test.json" };
+constexpr size_t EVENTS { 2000 };
+
+std::string footer()
+{
+    return std::string("\n") + Tracer::TRACE_EVENT_BODY;
+}
+
+/// @brief Header and events as the writer gets them, without the footer. Without a writer only the
+/// expected content is built.
+std::string write_events(Tracer::MappedWriter* writer)
+{
+    std::string expected { Tracer::TRACE_EVENTS };
+    if (writer != nullptr) {
+        writer->append(expected);
+    }
+    Tracer::ChromeEvent event {};
+    event.name = "step";
+    event.cat = "test";
+    event.ph = 'X';
+    event.pid = 1;
+    event.tid = 2;
+    event.dur = 5;
+    for (size_t i = 0; i < EVENTS; ++i) {
+        event.ts = static_cast<int64_t>(i) * 10;
+        const std::string json = (i == 0 ? "\n" : ",\n") + Tracer::serialize_to_json(event);
+        if (writer != nullptr) {
+            writer->append(json);
+        }
+        expected += json;
+    }
+    return expected;
+}
+
+std::string read_file()
+{
+    std::ifstream in(PATH, std::ios::binary);
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+} // namespace
+
+int main(int /* argc */, char* /* argv */[])
+{
+    // A child writes events through 4 KB growth steps and dies without closing
+    const pid_t child = fork();
+    if (child == 0) {
+        Tracer::MappedWriter writer(PATH, footer(), 4096);
+        if (!writer.is_open()) {
+            _exit(2);
+        }
+        write_events(&writer);
+        std::abort();
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFSIGNALED(status)) {
+        std::cerr << "Writer child didn't crash, status " << status << '\n';
+        return 1;
+    }
+
+    // Everything up to the crash is there, followed by the footer and space padding only
+    const std::string expected = write_events(nullptr) + footer();
+    const std::string crashed = read_file();
+    const size_t content_end = crashed.find_last_not_of(' ') + 1;
+    if (crashed.substr(0, content_end) != expected || content_end == crashed.size()) {
+        std::cerr << "Crashed trace has " << content_end << " bytes of content, expected " << expected.size() << " and padding\n";
+        return 1;
+    }
+
+    // A closed file has no padding
+    {
+        Tracer::MappedWriter writer(PATH, footer(), 4096);
+        write_events(&writer);
+    }
+    if (read_file() != expected) {
+        std::cerr << "Closed trace differs\n";
+        return 1;
+    }
+
+    // Past the file size limit the writer can't grow, its file is cut before the footer so a
+    // stream can continue it
+    const pid_t limited = fork();
+    if (limited == 0) {
+        std::signal(SIGXFSZ, SIG_IGN);
+        const rlimit limit { 64 * 1024, 64 * 1024 };
+        setrlimit(RLIMIT_FSIZE, &limit);
+        Tracer::MappedWriter writer(PATH, footer(), 4096);
+        if (!writer.is_open()) {
+            _exit(2);
+        }
+        std::string written;
+        const std::string line = ",\n" + std::string(100, 'x');
+        for (size_t i = 0; i < 1000; ++i) {
+            if (!writer.append(line)) {
+                _exit(writer.detach() && read_file() == written ? 0 : 3);
+            }
+            written += line;
+        }
+        _exit(4);
+    }
+    waitpid(limited, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "Detaching a full writer failed, status " << status << '\n';
+        return 1;
+    }
+    std::remove(PATH);
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include <Profiler/macros.hpp>
+#include <Profiler/mutex.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <print>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+Tracer::TracedMutex<> queue_lock { "queue" };
+Tracer::TracedSharedMutex<> config_lock { "config" };
+int shared_counter { 0 };
+
+size_t count_in_dump(const char* path, const std::string& pattern)
+{
+    std::ifstream in { path };
+    std::stringstream content;
+    content << in.rdbuf();
+    const std::string text = content.str();
+
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+void contended_worker()
+{
+    TRACE_FN_CAT("threads");
+    for (int i = 0; i < 5; ++i) {
+        std::lock_guard<Tracer::TracedMutex<>> lock(queue_lock);
+        ++shared_counter;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+void reader_worker()
+{
+    TRACE_FN_CAT("threads");
+    for (int i = 0; i < 5; ++i) {
+        std::shared_lock<Tracer::TracedSharedMutex<>> lock(config_lock);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void writer_worker()
+{
+    TRACE_FN_CAT("threads");
+    for (int i = 0; i < 3; ++i) {
+        std::unique_lock<Tracer::TracedSharedMutex<>> lock(config_lock);
+        std::this_thread::sleep_for(std::chrono::milliseconds(3));
+    }
+}
+
+int main(int /* argc */, char* /* argv */[])
+{
+    // The flight recorder lets the test read back what was exported
+    TRACE_SETUP_FLIGHT_RECORDER("trace_mutex.json", 4096);
+    TRACE_FN();
+
+    std::println("1. Testing uncontended locking...");
+    {
+        std::lock_guard<Tracer::TracedMutex<>> lock(queue_lock);
+        ++shared_counter;
+    }
+    if (!queue_lock.try_lock()) {
+        std::println(stderr, "try_lock failed on an unlocked mutex");
+        return 1;
+    }
+    queue_lock.unlock();
+
+    std::println("2. Testing contended exclusive locking...");
+    {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back(contended_worker);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+    if (shared_counter != 21) {
+        std::println(stderr, "Unexpected counter value {}", shared_counter);
+        return 1;
+    }
+
+    std::println("3. Testing shared locking with a writer...");
+    {
+        std::vector<std::thread> threads;
+        threads.emplace_back(writer_worker);
+        for (int i = 0; i < 3; ++i) {
+            threads.emplace_back(reader_worker);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    std::println("4. Testing the exported slices...");
+    Tracer::LockStats& queue_stats = Tracer::LockRegistry::instance().add("queue");
+    Tracer::LockStats& config_stats = Tracer::LockRegistry::instance().add("config");
+    TRACE_FLIGHT_RECORDER_DUMP();
+    const char* dump = "trace_mutex.flight-0.json";
+    const size_t waits = count_in_dump(dump, R"("name":"lock_wait")");
+    const size_t holds = count_in_dump(dump, R"("name":"lock_hold")");
+    if (queue_stats.contended == 0 || waits != queue_stats.contended + config_stats.contended) {
+        std::println(stderr, "Expected one lock_wait slice per contended acquisition, got {}", waits);
+        return 1;
+    }
+    if (holds == 0 || holds > waits) {
+        std::println(stderr, "Expected a lock_hold slice per contended exclusive acquisition, got {}", holds);
+        return 1;
+    }
+
+    std::println("5. Testing the lock summary...");
+    // Locks sharing a name share their counters, so short-lived locks don't grow the registry
+    for (int i = 0; i < 1000; ++i) {
+        Tracer::TracedMutex<> scratch_lock { "scratch" };
+        std::lock_guard<Tracer::TracedMutex<>> lock(scratch_lock);
+    }
+    const std::vector<Tracer::ChromeEvent> summary = Tracer::LockRegistry::instance().summary_events();
+    if (summary.size() != 3) {
+        std::println(stderr, "Expected one summary event per lock name, got {}", summary.size());
+        return 1;
+    }
+    for (const Tracer::ChromeEvent& event : summary) {
+        if (std::string_view(event.cat) != "lock_summary") {
+            std::println(stderr, "Unexpected summary category {}", event.cat);
+            return 1;
+        }
+    }
+    // One lock_guard and one try_lock outside the workers, 4 workers locking 5 times each
+    if (queue_stats.acquisitions != 22 || queue_stats.contended > 20 || queue_stats.contended_hold_us <= 0) {
+        std::println(stderr, "Unexpected queue counters: {} acquisitions, {} contended", queue_stats.acquisitions.load(), queue_stats.contended.load());
+        return 1;
+    }
+    // 3 readers locking 5 times each and a writer locking 3 times
+    if (config_stats.acquisitions != 18) {
+        std::println(stderr, "Unexpected config acquisitions {}", config_stats.acquisitions.load());
+        return 1;
+    }
+    if (Tracer::LockRegistry::instance().add("scratch").acquisitions != 1000) {
+        std::println(stderr, "Expected the scratch locks to share their counters");
+        return 1;
+    }
+
+    std::println("\nMutex test complete.");
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <Profiler/macros.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <print>
+#include <sstream>
+#include <string>
+#include <thread>
+
+size_t count_in_dump(const char* path, const std::string& pattern)
+{
+    std::ifstream in { path };
+    std::stringstream content;
+    content << in.rdbuf();
+    const std::string text = content.str();
+
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+void handle_request(int id, bool is_slow)
+{
+    TRACE_SCOPE_ARGS("handle_request", "request", "id", id);
+    {
+        TRACE_SCOPE_CAT("parse", "work");
+    }
+    {
+        TRACE_SCOPE_CAT("process", "work");
+        if (is_slow) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        }
+    }
+}
+
+int main(int /* argc */, char* /* argv */[])
+{
+    // The flight recorder lets the test read back what was exported
+    TRACE_SETUP_FLIGHT_RECORDER("trace_tail_sampling.json", 1024);
+
+    std::println("1. Testing threshold sampling...");
+    TRACE_TAIL_SAMPLING("request", 20000, 0);
+    for (int i = 0; i < 20; ++i) {
+        handle_request(i, i == 7);
+    }
+    {
+        TRACE_SCOPE_CAT("outside_request", "work");
+    }
+    TRACE_FLIGHT_RECORDER_DUMP();
+
+    const char* dump = "trace_tail_sampling.flight-0.json";
+    if (count_in_dump(dump, R"("name":"handle_request")") != 1 || count_in_dump(dump, R"("sampling":"threshold")") != 1) {
+        std::println(stderr, "Expected only the slow request to be exported");
+        return 1;
+    }
+    if (count_in_dump(dump, R"("name":"process")") != 1 || count_in_dump(dump, R"("name":"outside_request")") != 1) {
+        std::println(stderr, "Expected the slow subtree and events outside of requests");
+        return 1;
+    }
+
+    std::println("2. Testing 1-in-N sampling...");
+    TRACE_TAIL_SAMPLING("request", 1000000, 5);
+    for (int i = 0; i < 20; ++i) {
+        handle_request(i, false);
+    }
+    TRACE_FLIGHT_RECORDER_DUMP();
+
+    dump = "trace_tail_sampling.flight-1.json";
+    if (count_in_dump(dump, R"("sampling":"one_in_n")") != 4 || count_in_dump(dump, R"("name":"parse")") != 5) {
+        std::println(stderr, "Expected 4 sampled requests");
+        return 1;
+    }
+
+    const auto stats = Tracer::TailSampler::instance().stats();
+    if (stats.roots != 40 || stats.kept_roots != 5) {
+        std::println(stderr, "Unexpected stats: {} roots, {} kept", stats.roots, stats.kept_roots);
+        return 1;
+    }
+
+    std::println("\nTail sampling test complete ({} events dropped).", stats.dropped_events);
+    return 0;
+}
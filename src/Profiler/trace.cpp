@@ -1,9 +1,19 @@
 #include "trace.hpp"
 
+#include <Profiler/control.hpp>
+#include <Profiler/exporters/flight_recorder.hpp>
+#include <Profiler/tail_sampler.hpp>
+
+#include <atomic>
+#include <charconv>
 #include <chrono>
+#include <cinttypes>
+#include <cstdio>
 #include <iostream>
 #include <syscall.h>
+#include <type_traits>
 #include <unistd.h>
+#include <utility>
 
 namespace Tracer {
 
@@ -25,15 +35,191 @@ int64_t get_unique_timestamp()
     return current;
 }
 
+int get_thread_id()
+{
+    // ToDo: Make it platform independent.
+    // Perfetto needs 4 digits id, but hash for thread::id is 19 digits long.
+    // static thread_local auto tid = std::hash<std::thread::id> {}(std::this_thread::get_id());
+    static thread_local int tid = static_cast<int>(syscall(SYS_gettid));
+    return tid;
+}
+
+namespace {
+    thread_local bool t_is_exporter_thread { false };
+} // namespace
+
+void mark_exporter_thread()
+{
+    t_is_exporter_thread = true;
+}
+
+bool is_exporter_thread()
+{
+    return t_is_exporter_thread;
+}
+
+uint64_t next_async_id()
+{
+    static std::atomic<uint32_t> counter { 0 };
+    return (static_cast<uint64_t>(getpid()) << 32) | ++counter;
+}
+
+namespace {
+    int64_t steady_ns()
+    {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// @brief Identifies the exporter of a held back subtree
+    template <class T>
+    const void* exporter_key()
+    {
+        static const char key {};
+        return &key;
+    }
+
+    /// @brief Hand an event to the exporter, unless tail sampling holds it back
+    template <class T>
+    void submit(const ChromeEvent& event)
+    {
+        if (TailSampler::is_active() && TailSampler::instance().hold(event, exporter_key<T>())) {
+            return;
+        }
+        T::instance().push_trace(event);
+    }
+
+    /// @brief Whether the collector lets an event of `cat` through, only IPC clients are controlled
+    template <class T>
+    bool is_allowed(const char* cat)
+    {
+        return !std::is_same<T, IPCExporter>::value || Control::allows(cat);
+    }
+
+    /// @var t_context Set by ContextScope
+    thread_local TraceContext t_context { 0, 0 };
+
+    /// @brief Flow events of a context are told apart by phase only, so both ends match in viewers
+    template <class T>
+    void write_flow_event(char ph, const TraceContext& context)
+    {
+        constexpr const char* FLOW_CAT = "flow";
+        if (!is_allowed<T>(FLOW_CAT)) {
+            return;
+        }
+        ChromeEvent trace_data {
+            /* name */ "trace_context",
+            /* cat  */ FLOW_CAT,
+            /* ph   */ ph,
+            /* ts   */ get_unique_timestamp(),
+            /* pid  */ getpid(),
+            /* tid  */ static_cast<size_t>(get_thread_id()),
+            /* dur  */ 0,
+            /* id   */ context.span_id,
+            /* args */ {},
+        };
+        trace_data.args.add_id("trace_id", context.trace_id);
+        submit<T>(trace_data);
+    }
+
+    template <class T>
+    CallSite::Action sampled_action(const char* cat)
+    {
+        const bool is_sampled = !std::is_same<T, IPCExporter>::value || Control::samples(cat);
+        return is_sampled ? CallSite::Action::TRACE : CallSite::Action::SKIP;
+    }
+} // namespace
+
+template <class T>
+void write_async_event(char ph, const char* name, const char* cat, uint64_t id)
+{
+    if (!is_allowed<T>(cat)) {
+        return;
+    }
+    ChromeEvent trace_data {
+        /* name */ name,
+        /* cat  */ cat,
+        /* ph   */ ph,
+        /* ts   */ get_unique_timestamp(),
+        /* pid  */ getpid(),
+        /* tid  */ static_cast<size_t>(get_thread_id()),
+        /* dur  */ 0,
+        /* id   */ id,
+        /* args */ {},
+    };
+
+    submit<T>(trace_data);
+}
+
+template <class T>
+void write_complete_event(const char* name, const char* cat, int64_t start, int64_t dur, const EventArgs& args)
+{
+    if (!is_allowed<T>(cat)) {
+        return;
+    }
+    ChromeEvent trace_data {
+        /* name */ name,
+        /* cat  */ cat,
+        /* ph   */ 'X',
+        /* ts   */ start,
+        /* pid  */ getpid(),
+        /* tid  */ static_cast<size_t>(get_thread_id()),
+        /* dur  */ dur,
+        /* id   */ 0,
+        /* args */ args,
+    };
+
+    submit<T>(trace_data);
+}
+
 template <class T>
 TraceScope<T>::TraceScope(const char* name, const char* cat)
-    : m_name(name)
-    , m_cat(cat)
-    , m_start_time(get_unique_timestamp()) {};
+    : m_action(sampled_action<T>(cat))
+{
+    if (m_action == CallSite::Action::TRACE) {
+        open(name, cat);
+    }
+}
+
+template <class T>
+TraceScope<T>::TraceScope(CallSite& site, const char* name, const char* cat)
+    : m_site(&site)
+    , m_action(sampled_action<T>(cat) == CallSite::Action::SKIP
+              ? CallSite::Action::SKIP
+              : site.enter(name, [](const ChromeEvent& event) { submit<T>(event); }))
+{
+    if (m_action == CallSite::Action::TRACE) {
+        open(name, cat);
+    } else if (m_action == CallSite::Action::AGGREGATE) {
+        m_start_time = get_unique_timestamp();
+    }
+}
+
+template <class T>
+void TraceScope<T>::open(const char* name, const char* cat)
+{
+    m_name = name;
+    m_cat = cat;
+    m_args.count = 0;
+    m_start_time = get_unique_timestamp();
+
+    // Only the flight recorder reports scopes that haven't finished yet
+    if (std::is_same<T, FileExporter>::value && FlightRecorder::is_active()) {
+        FlightRecorder::push_open_scope(name, cat, m_start_time);
+        m_is_open_scope_tracked = true;
+    }
+    m_is_tail_root = TailSampler::is_active() && TailSampler::instance().begin_scope(m_cat, exporter_key<T>());
+}
 
 template <class T>
 TraceScope<T>::~TraceScope()
 {
+    if (m_action == CallSite::Action::SKIP) {
+        return;
+    }
+    if (m_is_open_scope_tracked) {
+        FlightRecorder::pop_open_scope();
+    }
     try {
         write_trace();
     } catch (...) {
@@ -44,11 +230,12 @@ TraceScope<T>::~TraceScope()
 template <class T>
 void TraceScope<T>::write_trace()
 {
-    // ToDo: Make it platform independent.
-    // Perfetto needs 4 digits id, but hash for thread::id is 19 digits long.
-    // static thread_local auto tid = std::hash<std::thread::id> {}(std::this_thread::get_id());
-    static thread_local int tid = static_cast<int>(syscall(SYS_gettid));
     const auto end_time = get_unique_timestamp();
+    const int64_t dur = end_time - m_start_time;
+    if (m_action == CallSite::Action::AGGREGATE) {
+        m_site->exit_aggregated(dur);
+        return;
+    }
 
     ChromeEvent trace_data {
         /* name */ std::move(m_name),
@@ -56,11 +243,129 @@ void TraceScope<T>::write_trace()
         /* ph   */ 'X',
         /* ts   */ m_start_time,
         /* pid  */ getpid(),
-        /* tid  */ static_cast<size_t>(tid),
-        /* dur  */ (end_time - m_start_time),
+        /* tid  */ static_cast<size_t>(get_thread_id()),
+        /* dur  */ dur,
+        /* id   */ 0,
+        /* args */ m_args,
     };
 
-    T::instance().push_trace(trace_data);
+    // The governor measures what exporting costs, the scope itself is already timed
+    const bool is_governed = m_site != nullptr && Governor::is_active();
+    const int64_t export_start = is_governed ? steady_ns() : 0;
+    if (m_is_tail_root) {
+        for (const ChromeEvent& event : TailSampler::instance().end_root(std::move(trace_data), exporter_key<T>())) {
+            T::instance().push_trace(event);
+        }
+    } else {
+        submit<T>(trace_data);
+    }
+    if (is_governed) {
+        m_site->exit_traced(dur, steady_ns() - export_start);
+    }
+}
+
+template <class T>
+AsyncSpan<T>::AsyncSpan(const char* name, const char* cat, uint64_t id)
+    : m_name(name)
+    , m_cat(cat)
+    , m_id(id)
+    , m_is_open(true)
+{
+    write_async_event<T>('b', m_name.c_str(), m_cat.c_str(), m_id);
+}
+
+template <class T>
+AsyncSpan<T>::AsyncSpan(AsyncSpan&& other) noexcept
+    : m_name(std::move(other.m_name))
+    , m_cat(std::move(other.m_cat))
+    , m_id(other.m_id)
+    , m_is_open(std::exchange(other.m_is_open, false))
+{
+}
+
+template <class T>
+AsyncSpan<T>::~AsyncSpan()
+{
+    try {
+        end();
+    } catch (...) {
+        std::cerr << "Warning: Exception occurred while writing trace event.";
+    }
+}
+
+template <class T>
+void AsyncSpan<T>::end()
+{
+    if (!std::exchange(m_is_open, false)) {
+        return;
+    }
+    write_async_event<T>('e', m_name.c_str(), m_cat.c_str(), m_id);
+}
+
+template <class T>
+void AsyncSpan<T>::begin_step(const char* name)
+{
+    write_async_event<T>('b', name, m_cat.c_str(), m_id);
+}
+
+template <class T>
+void AsyncSpan<T>::end_step(const char* name)
+{
+    write_async_event<T>('e', name, m_cat.c_str(), m_id);
+}
+
+std::string TraceContext::to_header() const
+{
+    char header[34];
+    std::snprintf(header, sizeof(header), "%016" PRIx64 "-%016" PRIx64, trace_id, span_id);
+    return header;
+}
+
+TraceContext TraceContext::from_header(const std::string& header)
+{
+    if (header.size() != 33 || header[16] != '-') {
+        return { 0, 0 };
+    }
+    TraceContext context { 0, 0 };
+    const char* begin = header.data();
+    const auto trace = std::from_chars(begin, begin + 16, context.trace_id, 16);
+    const auto span = std::from_chars(begin + 17, begin + 33, context.span_id, 16);
+    if (trace.ptr != begin + 16 || span.ptr != begin + 33) {
+        return { 0, 0 };
+    }
+    return context;
+}
+
+TraceContext current_context()
+{
+    return t_context;
+}
+
+template <class T>
+TraceContext export_context()
+{
+    const TraceContext context {
+        /* trace_id */ t_context.is_valid() ? t_context.trace_id : next_async_id(),
+        /* span_id  */ next_async_id(),
+    };
+    write_flow_event<T>('s', context);
+    return context;
+}
+
+template <class T>
+ContextScope<T>::ContextScope(const TraceContext& context)
+    : m_previous(t_context)
+{
+    if (context.is_valid()) {
+        write_flow_event<T>('f', context);
+        t_context = context;
+    }
+}
+
+template <class T>
+ContextScope<T>::~ContextScope()
+{
+    t_context = m_previous;
 }
 
 } // namespace Tracer
@@ -68,3 +373,13 @@ void TraceScope<T>::write_trace()
 // Explicit template instantiation
 template class Tracer::TraceScope<Tracer::FileExporter>;
 template class Tracer::TraceScope<Tracer::IPCExporter>;
+template class Tracer::AsyncSpan<Tracer::FileExporter>;
+template class Tracer::AsyncSpan<Tracer::IPCExporter>;
+template class Tracer::ContextScope<Tracer::FileExporter>;
+template class Tracer::ContextScope<Tracer::IPCExporter>;
+template Tracer::TraceContext Tracer::export_context<Tracer::FileExporter>();
+template Tracer::TraceContext Tracer::export_context<Tracer::IPCExporter>();
+template void Tracer::write_async_event<Tracer::FileExporter>(char, const char*, const char*, uint64_t);
+template void Tracer::write_async_event<Tracer::IPCExporter>(char, const char*, const char*, uint64_t);
+template void Tracer::write_complete_event<Tracer::FileExporter>(const char*, const char*, int64_t, int64_t, const EventArgs&);
+template void Tracer::write_complete_event<Tracer::IPCExporter>(const char*, const char*, int64_t, int64_t, const EventArgs&);
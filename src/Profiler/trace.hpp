@@ -2,21 +2,159 @@
 
 #include <Profiler/exporters/file_exporter.hpp>
 #include <Profiler/exporters/ipc_exporter.hpp>
+#include <Profiler/governor.hpp>
 
 namespace Tracer {
 
+/// @brief Get a unique timestamp in microseconds that's monotonically increasing per thread
+int64_t get_unique_timestamp();
+
+/// @brief Get the kernel id of the calling thread
+int get_thread_id();
+
+/// @brief Mark the calling thread as one an exporter started, its I/O is the tracer's own
+void mark_exporter_thread();
+
+/// @brief Whether an exporter started the calling thread, e.g. for the I/O shim to leave it alone
+bool is_exporter_thread();
+
+/// @brief Generate an id for async events.
+///
+/// The process id is folded into the high bits, so ids from processes that report to the same
+/// TraceCollector don't collide.
+uint64_t next_async_id();
+
+/// @brief Emit a single async event (ph b, n or e) correlated by id instead of by thread.
+///
+/// Events and scopes sent to the IPCExporter are dropped when the collector's Control disallows
+/// their category, scopes also obey its sampling rate.
+template <class T = FileExporter>
+void write_async_event(char ph, const char* name, const char* cat, uint64_t id);
+
+/// @brief Emit a complete event (ph X) on the calling thread for an already measured interval
+template <class T = FileExporter>
+void write_complete_event(const char* name, const char* cat, int64_t start, int64_t dur, const EventArgs& args = {});
+
 template <class T = FileExporter>
 class TraceScope {
 public:
     TraceScope(const char* name, const char* cat = "Default");
+
+    /// @brief Scope with typed arguments given as key/value pairs: ("bytes", 1024, "shard", "eu-1")
+    template <class... Args>
+    TraceScope(const char* name, const char* cat, const char* key, const Args&... args)
+        : TraceScope(name, cat)
+    {
+        if (m_action == CallSite::Action::TRACE) {
+            add_args(m_args, key, args...);
+        }
+    }
+
+    /// @brief Scope whose overhead is kept in check by the Governor, used by the TRACE_SCOPE macros
+    TraceScope(CallSite& site, const char* name, const char* cat = "Default");
+
+    template <class... Args>
+    TraceScope(CallSite& site, const char* name, const char* cat, const char* key, const Args&... args)
+        : TraceScope(site, name, cat)
+    {
+        if (m_action == CallSite::Action::TRACE) {
+            add_args(m_args, key, args...);
+        }
+    }
+
     ~TraceScope();
 
 private:
+    void open(const char* name, const char* cat);
     void write_trace();
 
+    CallSite* m_site { nullptr };
+    CallSite::Action m_action { CallSite::Action::TRACE };
+
+    // Only set for traced scopes, skipped ones neither copy their names nor read the clock
     std::string m_name;
     std::string m_cat;
-    const int64_t m_start_time;
+    EventArgs m_args;
+    int64_t m_start_time { 0 };
+    bool m_is_open_scope_tracked { false };
+    bool m_is_tail_root { false };
+};
+
+/// @brief Async span, correlated by id instead of by thread.
+///
+/// Unlike TraceScope it isn't tied to the thread that opened it: the span can be moved to another
+/// thread (or live in a coroutine frame) and be ended there. Nested steps are rendered inside the
+/// span, which is how CoroutineSpan shows the stretches where a coroutine was actually running.
+template <class T = FileExporter>
+class AsyncSpan {
+public:
+    AsyncSpan(const char* name, const char* cat = "Default", uint64_t id = next_async_id());
+    AsyncSpan(AsyncSpan&& other) noexcept;
+    AsyncSpan(const AsyncSpan&) = delete;
+    AsyncSpan& operator=(const AsyncSpan&) = delete;
+    AsyncSpan& operator=(AsyncSpan&&) = delete;
+    ~AsyncSpan();
+
+    /// @brief Close the span. Only the first call has effect.
+    void end();
+
+    /// @brief Open a nested step. Steps must be closed in reverse order.
+    void begin_step(const char* name);
+    void end_step(const char* name);
+
+    uint64_t id() const { return m_id; }
+
+private:
+    std::string m_name;
+    std::string m_cat;
+    uint64_t m_id;
+    bool m_is_open;
+};
+
+/// @brief Identity of a request crossing processes, carried in the application's own RPC headers.
+///
+/// The caller exports a context, which starts a flow in its current scope, and sends it along;
+/// the callee opens a ContextScope with it inside the scope handling the call, which ends the flow
+/// there. Perfetto draws the flow as an arrow from the call to the work it triggered, once the
+/// TraceCollector stitched the halves reported by both processes.
+struct TraceContext {
+    /// @var trace_id Shared by every hop of the request
+    uint64_t trace_id;
+
+    /// @var span_id The flow started by the hop that sent the context
+    uint64_t span_id;
+
+    bool is_valid() const { return span_id != 0; }
+
+    /// @brief Compact header value: trace and span id as 16 hex digits each, separated by '-'
+    std::string to_header() const;
+
+    /// @brief Parse a to_header() value, an invalid context for anything else
+    static TraceContext from_header(const std::string& header);
+};
+
+/// @brief The context of the innermost ContextScope of the calling thread, invalid outside of one
+TraceContext current_context();
+
+/// @brief Start a flow in the calling scope and return the context to send with the call.
+///
+/// Inside a ContextScope the new context continues its trace, otherwise it starts a new one.
+template <class T = FileExporter>
+TraceContext export_context();
+
+/// @brief Ends the flow of a received context in the enclosing scope, and makes the context current
+/// for the calling thread until the ContextScope is destroyed. Invalid contexts are ignored.
+template <class T = FileExporter>
+class ContextScope {
+public:
+    explicit ContextScope(const TraceContext& context);
+    ~ContextScope();
+
+    ContextScope(const ContextScope&) = delete;
+    ContextScope& operator=(const ContextScope&) = delete;
+
+private:
+    TraceContext m_previous;
 };
 
 } // namespace Tracer
@@ -0,0 +1,152 @@
+#include "aggregator.hpp"
+
+#include <algorithm>
+#include <format>
+#include <functional>
+#include <iterator>
+#include <print>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+constexpr std::string_view OTHER_KEY { "[other]" };
+
+std::string json_string(std::string_view value)
+{
+    std::string quoted;
+    quoted.reserve(value.size() + 2);
+    append_json_string(quoted, value);
+    return quoted;
+}
+
+int64_t now_us()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
+} // namespace
+
+size_t Aggregator::KeyHash::operator()(const KeyView& key) const
+{
+    const size_t name = std::hash<std::string_view> {}(key.name);
+    const size_t cat = std::hash<std::string_view> {}(key.cat);
+    return name ^ (cat * 31) ^ (static_cast<size_t>(key.pid) * 0x9e3779b97f4a7c15ULL);
+}
+
+Aggregator::Aggregator(std::string_view summary_file, std::chrono::milliseconds snapshot_interval, size_t max_keys, size_t top_k)
+    : m_max_keys(max_keys)
+    , m_top_k(top_k)
+    , m_top_by_count(std::max<size_t>(top_k * SKETCH_COUNTERS_PER_KEY, 1))
+    , m_top_by_time(std::max<size_t>(top_k * SKETCH_COUNTERS_PER_KEY, 1))
+    , m_summary(std::string(summary_file), std::ios::app)
+    , m_snapshot_interval(snapshot_interval)
+{
+    if (!m_summary.is_open()) {
+        throw std::runtime_error("Failed to open summary file.");
+    }
+    m_timer = std::jthread([this](std::stop_token stop) { run_timer(std::move(stop)); });
+}
+
+void Aggregator::add_batch(uint64_t sequence, std::span<const EventRecord> events)
+{
+    auto lock = m_sequencer.enter(sequence);
+    for (const EventRecord& event : events) {
+        add(event);
+    }
+    m_sequencer.leave(lock);
+}
+
+void Aggregator::finish(uint64_t sequence)
+{
+    m_timer.request_stop();
+    m_timer.join();
+    const auto lock = m_sequencer.wait_for(sequence);
+    write_snapshot();
+    print_top();
+}
+
+void Aggregator::add(const EventRecord& event)
+{
+    if (event.ph != 'X') {
+        return;
+    }
+    const int64_t self_time = m_self_time.add(Analysis::SelfTimeTracker::thread_key(event.pid, event.tid), event.ts, event.dur);
+
+    auto it = m_entries.find(KeyView { event.pid, event.name, event.cat });
+    if (it == m_entries.end()) {
+        const bool is_full = m_entries.size() >= m_max_keys;
+        Key key = is_full ? Key { 0, std::string(OTHER_KEY), std::string(OTHER_KEY) } : Key { event.pid, std::string(event.name), std::string(event.cat) };
+        it = m_entries.try_emplace(std::move(key)).first;
+    }
+    it->second.histogram.record(event.dur);
+    it->second.self_time += self_time;
+
+    if (m_top_k != 0) {
+        m_top_by_count.add(event.name);
+        m_top_by_time.add(event.name, static_cast<uint64_t>(std::max<int64_t>(event.dur, 0)));
+    }
+}
+
+void Aggregator::run_timer(std::stop_token stop)
+{
+    std::unique_lock lock(m_timer_lock);
+    while (!m_timer_wakeup.wait_for(lock, stop, m_snapshot_interval, [] { return false; }) && !stop.stop_requested()) {
+        // Between two batches, so a snapshot never shows half of one
+        const auto sequence_lock = m_sequencer.lock();
+        write_snapshot();
+    }
+}
+
+void Aggregator::print_top() const
+{
+    if (m_top_k == 0) {
+        return;
+    }
+    std::println("Top {} names by count:", m_top_k);
+    for (const auto& counter : m_top_by_count.top(m_top_k)) {
+        std::println("  {:>12} (+/- {}) {}", counter.weight, counter.error, counter.key);
+    }
+    std::println("Top {} names by total time (us):", m_top_k);
+    for (const auto& counter : m_top_by_time.top(m_top_k)) {
+        std::println("  {:>12} (+/- {}) {}", counter.weight, counter.error, counter.key);
+    }
+}
+
+void Aggregator::write_snapshot()
+{
+    std::string line = std::format(R"({{"ts":{},"entries":[)", now_us());
+    bool is_first = true;
+    for (const auto& [key, entry] : m_entries) {
+        const Analysis::HdrHistogram& histogram = entry.histogram;
+        std::format_to(std::back_inserter(line),
+            R"({}{{"pid":{},"name":{},"cat":{},"count":{},"sum_us":{},"self_us":{},"min_us":{},)"
+            R"("p50_us":{},"p90_us":{},"p99_us":{},"p999_us":{},"max_us":{}}})",
+            is_first ? "" : ",", key.pid, json_string(key.name), json_string(key.cat),
+            histogram.count(), histogram.sum(), entry.self_time, histogram.min(),
+            histogram.value_at_percentile(50.0), histogram.value_at_percentile(90.0),
+            histogram.value_at_percentile(99.0), histogram.value_at_percentile(99.9), histogram.max());
+        is_first = false;
+    }
+    line += "]";
+
+    if (m_top_k != 0) {
+        for (const auto& [field, weight_field, sketch] : { std::tuple { "top_by_count", "count", &m_top_by_count },
+                 { "top_by_time", "total_us", &m_top_by_time } }) {
+            std::format_to(std::back_inserter(line), R"(,"{}":[)", field);
+            is_first = true;
+            for (const auto& counter : sketch->top(m_top_k)) {
+                std::format_to(std::back_inserter(line), R"({}{{"name":{},"{}":{},"error":{}}})",
+                    is_first ? "" : ",", json_string(counter.key), weight_field, counter.weight, counter.error);
+                is_first = false;
+            }
+            line += "]";
+        }
+    }
+    line += "}\n";
+
+    m_summary << line;
+    m_summary.flush();
+    if (!m_summary) {
+        std::println(stderr, "Failed to write summary snapshot");
+    }
+}
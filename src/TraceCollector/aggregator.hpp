@@ -0,0 +1,104 @@
+#pragma once
+
+#include "event_batch.hpp"
+#include "sequencer.hpp"
+
+#include <Analysis/hdr_histogram.hpp>
+#include <Analysis/self_time.hpp>
+#include <Analysis/space_saving.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+/// @brief Live per-scope latency distributions, the collector's aggregation mode.
+///
+/// Complete events are folded into one HDR histogram per (pid, name, cat) together with their self
+/// time. Every snapshot interval a timer thread appends the cumulative statistics to the summary
+/// file as one JSON line, whether batches arrive or not. Memory is bounded by the number of keys: past `max_keys`, new keys are folded into a
+/// single "[other]" entry.
+///
+/// With `top_k` set, Space-Saving sketches also track the heaviest event names by count and by total
+/// time. They see every event, including those folded into "[other]", so dynamic names stay visible
+/// at fixed memory. Top lists are part of every snapshot and printed at shutdown.
+class Aggregator {
+public:
+    /// @brief Counters kept per reported name, more counters tighten the error bound
+    static constexpr size_t SKETCH_COUNTERS_PER_KEY { 8 };
+
+    Aggregator(std::string_view summary_file, std::chrono::milliseconds snapshot_interval, size_t max_keys, size_t top_k = 0);
+
+    /// @brief Fold a batch of events. Batches are applied in sequence order whatever thread brings them,
+    /// self time depends on seeing a thread's events in the order they were sent.
+    void add_batch(uint64_t sequence, std::span<const EventRecord> events);
+
+    /// @brief Stop the timer, wait until every batch before `sequence` was applied, then write a
+    /// final snapshot
+    void finish(uint64_t sequence);
+
+private:
+    struct Key {
+        int pid;
+        std::string name;
+        std::string cat;
+    };
+
+    struct KeyView {
+        int pid;
+        std::string_view name;
+        std::string_view cat;
+    };
+
+    struct KeyHash {
+        using is_transparent = void;
+        size_t operator()(const KeyView& key) const;
+        size_t operator()(const Key& key) const { return (*this)(KeyView { key.pid, key.name, key.cat }); }
+    };
+
+    struct KeyEqual {
+        using is_transparent = void;
+        static KeyView view(const Key& key) { return { key.pid, key.name, key.cat }; }
+        static KeyView view(const KeyView& key) { return key; }
+        bool operator()(const auto& lhs, const auto& rhs) const
+        {
+            const KeyView a = view(lhs);
+            const KeyView b = view(rhs);
+            return a.pid == b.pid && a.name == b.name && a.cat == b.cat;
+        }
+    };
+
+    struct Entry {
+        Analysis::HdrHistogram histogram;
+        int64_t self_time { 0 };
+    };
+
+    void add(const EventRecord& event);
+    void run_timer(std::stop_token stop);
+    void write_snapshot();
+    void print_top() const;
+
+    Sequencer m_sequencer;
+
+    std::unordered_map<Key, Entry, KeyHash, KeyEqual> m_entries;
+    size_t m_max_keys;
+    Analysis::SelfTimeTracker m_self_time;
+
+    size_t m_top_k;
+    Analysis::SpaceSaving m_top_by_count;
+    Analysis::SpaceSaving m_top_by_time;
+
+    std::ofstream m_summary;
+    std::chrono::milliseconds m_snapshot_interval;
+
+    std::mutex m_timer_lock;
+    std::condition_variable_any m_timer_wakeup;
+    /// @var m_timer Last member, so it's stopped before anything it reads is destroyed
+    std::jthread m_timer;
+};
@@ -2,13 +2,43 @@
 
 #include <Args/args.hpp>
 
+#include <charconv>
 #include <string>
 
 struct ArgsOpts {
     std::string pipe_path = "/tmp/tracer.pipe";
     std::string output_file = "trace.json";
+    bool write_events = true;
+    std::string summary_file = "";
+    size_t snapshot_interval_ms = 10000;
+    size_t max_keys = 1024;
+    size_t top_k = 0;
+    bool is_ordered = false;
+    size_t reorder_window_ms = 1000;
+    size_t reorder_max_events = 1'000'000;
+    size_t chunk_kb = 0;
+    std::string columnar_file = "";
+    size_t rotate_mb = 0;
+    size_t rotate_s = 0;
+    size_t keep_segments = 0;
+    size_t keep_mb = 0;
+    bool use_uring = false;
+    std::string sessions_file = "";
+    size_t workers = 4;
+    size_t budget_mb = 64;
+    std::string control_pipe = "";
+    bool is_tracing = true;
 };
 
+inline Args::Result parse_count(std::string_view key, std::string_view value, size_t& count)
+{
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), count);
+    if (error != std::errc {} || end != value.data() + value.size() || count == 0) {
+        return { Args::Result::Code::ERROR, std::string("Error: ") + std::string(key) + " expects a positive number" };
+    }
+    return { Args::Result::Code::OK };
+}
+
 inline Args::Result command_handler(std::string_view key, std::string_view value, ArgsOpts& options)
 {
     if (key == "--pipe" && !value.empty()) {
@@ -19,5 +49,104 @@ inline Args::Result command_handler(std::string_view key, std::string_view value
         options.output_file = value;
         return { Args::Result::Code::OK };
     }
+    if (key == "--no-events" && value.empty()) {
+        options.write_events = false;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--summary" && !value.empty()) {
+        options.summary_file = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--snapshot-ms") {
+        return parse_count(key, value, options.snapshot_interval_ms);
+    }
+    if (key == "--max-keys") {
+        return parse_count(key, value, options.max_keys);
+    }
+    if (key == "--ordered" && value.empty()) {
+        options.is_ordered = true;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--reorder-window-ms") {
+        return parse_count(key, value, options.reorder_window_ms);
+    }
+    if (key == "--reorder-max-events") {
+        return parse_count(key, value, options.reorder_max_events);
+    }
+    if (key == "--chunked") {
+        options.is_ordered = true;
+        options.chunk_kb = 1024;
+        return value.empty() ? Args::Result { Args::Result::Code::OK } : parse_count(key, value, options.chunk_kb);
+    }
+    if (key == "--columnar" && !value.empty()) {
+        options.columnar_file = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--rotate-mb") {
+        return parse_count(key, value, options.rotate_mb);
+    }
+    if (key == "--rotate-s") {
+        return parse_count(key, value, options.rotate_s);
+    }
+    if (key == "--keep-segments") {
+        return parse_count(key, value, options.keep_segments);
+    }
+    if (key == "--keep-mb") {
+        return parse_count(key, value, options.keep_mb);
+    }
+    if (key == "--io-uring" && value.empty()) {
+        options.use_uring = true;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--sessions" && !value.empty()) {
+        options.sessions_file = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--workers") {
+        return parse_count(key, value, options.workers);
+    }
+    if (key == "--budget-mb") {
+        return parse_count(key, value, options.budget_mb);
+    }
+    if (key == "--control" && !value.empty()) {
+        options.control_pipe = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--tracing" && (value == "on" || value == "off")) {
+        options.is_tracing = value == "on";
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--top-k") {
+        return parse_count(key, value, options.top_k);
+    }
     return { Args::Result::Code::UNHANDLED };
 }
+
+/// @brief Check the combination of options, the error message or an empty string. Sessions of a
+/// daemon don't write through the FileExporter, `use_exporter` false.
+inline std::string check_options(const ArgsOpts& options, bool use_exporter = true)
+{
+    if (options.top_k != 0 && options.summary_file.empty()) {
+        return "--top-k requires --summary";
+    }
+    if (options.is_ordered && options.write_events && options.output_file.ends_with(".gz")) {
+        return "--ordered and --chunked write uncompressed output, drop the .gz suffix";
+    }
+    const bool is_rotating = options.rotate_mb != 0 || options.rotate_s != 0;
+    if (is_rotating && options.is_ordered) {
+        return "--rotate-mb and --rotate-s can't be combined with --ordered or --chunked";
+    }
+    if ((options.keep_segments != 0 || options.keep_mb != 0) && !is_rotating) {
+        return "--keep-segments and --keep-mb require --rotate-mb or --rotate-s";
+    }
+    if (options.use_uring && (options.chunk_kb != 0 || (use_exporter && !is_rotating && !options.is_ordered))) {
+        return use_exporter ? "--io-uring applies to --ordered and --rotate-mb/--rotate-s output" : "--io-uring doesn't apply to --chunked";
+    }
+    if (!options.is_tracing && options.control_pipe.empty()) {
+        return "--tracing off requires --control, nothing could start the clients";
+    }
+    if (!options.write_events && options.summary_file.empty() && options.columnar_file.empty()) {
+        return "--no-events requires --summary or --columnar";
+    }
+    return "";
+}
@@ -0,0 +1,25 @@
+#include "column_writer.hpp"
+
+#include <print>
+
+ColumnWriter::ColumnWriter(const std::string& output_file)
+    : m_output_file(output_file)
+    , m_store(output_file)
+{
+}
+
+void ColumnWriter::add_batch(uint64_t sequence, std::span<const EventRecord> events)
+{
+    auto lock = m_sequencer.enter(sequence);
+    for (const EventRecord& event : events) {
+        m_store.write(event.name, event.cat, event.ph, event.ts, event.ph == 'X' ? event.dur : 0, event.pid, event.tid);
+    }
+    m_sequencer.leave(lock);
+}
+
+void ColumnWriter::finish(uint64_t sequence)
+{
+    const auto lock = m_sequencer.wait_for(sequence);
+    m_store.close();
+    std::println("Wrote {} events in {} row groups to {}", m_store.rows(), m_store.row_group_count(), m_output_file);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "event_batch.hpp"
+#include "sequencer.hpp"
+
+#include <Analysis/column_store.hpp>
+
+#include <span>
+#include <string>
+
+/// @brief Writes the collected events to a columnar store for trace_query.
+///
+/// Batches are appended in sequence order, so every row group holds events that arrived close in
+/// time and its ts zone map stays narrow. Arguments are dropped; write JSON events as well to keep
+/// them.
+class ColumnWriter {
+public:
+    explicit ColumnWriter(const std::string& output_file);
+
+    void add_batch(uint64_t sequence, std::span<const EventRecord> events);
+
+    /// @brief Wait until every batch before `sequence` was applied, then write the footer
+    void finish(uint64_t sequence);
+
+private:
+    Sequencer m_sequencer;
+    std::string m_output_file;
+    Analysis::ColumnStoreWriter m_store;
+};
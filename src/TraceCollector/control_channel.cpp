@@ -0,0 +1,245 @@
+#include "control_channel.hpp"
+
+#include <array>
+#include <charconv>
+#include <csignal>
+#include <format>
+#include <optional>
+#include <print>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h> // open
+#include <poll.h> // poll
+#include <string.h> // strerror
+#include <sys/eventfd.h> // eventfd
+#include <sys/stat.h> // mkfifo, fstat
+#include <unistd.h> // read, write
+
+std::string ControlChannel::State::to_record() const
+{
+    return std::format("tracing={} categories={} sample={} snapshot={}\n", is_enabled ? "on" : "off", categories, sample_one_in, snapshot);
+}
+
+ControlChannel::ControlChannel(std::string command_pipe, bool is_enabled)
+    : m_command_pipe(std::move(command_pipe))
+{
+    m_global.is_enabled = is_enabled;
+}
+
+ControlChannel::~ControlChannel()
+{
+    if (m_listener.joinable()) {
+        const uint64_t wakeup = 1;
+        std::ignore = ::write(m_stop_fd, &wakeup, sizeof(wakeup));
+        m_listener.join();
+    }
+    for (const auto& [pid, client] : m_clients) {
+        close(client.fd);
+    }
+    for (const int fd : { m_read_fd, m_keepalive_fd, m_stop_fd }) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    if (m_read_fd >= 0) {
+        unlink(m_command_pipe.c_str());
+    }
+}
+
+bool ControlChannel::init()
+{
+    // A client that exited must fail the write with EPIPE, not kill the collector
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if (mkfifo(m_command_pipe.c_str(), 0666) < 0 && errno != EEXIST) {
+        std::println(stderr, "Error when creating FIFO {}. {}.", m_command_pipe, strerror(errno));
+        return false;
+    }
+    m_read_fd = open(m_command_pipe.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    // Keeps the FIFO from hanging up after every `echo`
+    m_keepalive_fd = m_read_fd < 0 ? -1 : open(m_command_pipe.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    m_stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (m_read_fd < 0 || m_keepalive_fd < 0 || m_stop_fd < 0) {
+        std::println(stderr, "Failed to open control pipe {}. {}", m_command_pipe, strerror(errno));
+        return false;
+    }
+    m_listener = std::thread([this]() { listen(); });
+    return true;
+}
+
+void ControlChannel::add_client(int pid, const std::string& control_path)
+{
+    const int fd = open(control_path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC | O_NOFOLLOW | O_NOCTTY);
+    if (fd < 0) {
+        std::println(stderr, ">> Can't control client [{}] through {}. {}", pid, control_path, strerror(errno));
+        return;
+    }
+    // Anyone may write to the collector's pipe, a HELLO must not name a file the collector can write
+    struct stat info {};
+    if (fstat(fd, &info) < 0 || !S_ISFIFO(info.st_mode) || info.st_uid != geteuid()) {
+        std::println(stderr, ">> Not controlling client [{}], {} isn't a FIFO of this user", pid, control_path);
+        close(fd);
+        return;
+    }
+    const std::lock_guard lock(m_lock);
+    if (const auto client = m_clients.find(pid); client != m_clients.end()) {
+        close(client->second.fd);
+    }
+    const Client& client = m_clients[pid] = { fd, control_path };
+    if (!send(pid, client)) {
+        drop(pid);
+    }
+}
+
+std::string ControlChannel::execute(std::string_view command)
+{
+    std::vector<std::string> words;
+    std::optional<int> pid;
+    std::istringstream stream { std::string(command) };
+    for (std::string word; stream >> word;) {
+        if (word.starts_with("pid=")) {
+            int value = 0;
+            const auto [end, error] = std::from_chars(word.data() + 4, word.data() + word.size(), value);
+            if (error != std::errc {} || end != word.data() + word.size()) {
+                return "Invalid " + word;
+            }
+            pid = value;
+        } else {
+            words.push_back(std::move(word));
+        }
+    }
+    if (words.empty()) {
+        return "Empty command";
+    }
+
+    // Checked before anything changes, a bad command leaves every state alone
+    const std::string& verb = words.front();
+    size_t sample_one_in = 0;
+    if (verb == "sample") {
+        const std::string_view value = words.size() == 2 ? std::string_view(words[1]) : std::string_view();
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), sample_one_in);
+        if (error != std::errc {} || end != value.data() + value.size() || sample_one_in == 0) {
+            return "sample expects a positive number";
+        }
+    } else if (verb == "categories") {
+        if (words.size() != 2) {
+            return "categories expects a comma separated list or *";
+        }
+    } else if ((verb != "start" && verb != "stop" && verb != "snapshot") || words.size() != 1) {
+        return "Unknown command: " + std::string(command);
+    }
+
+    const auto apply = [&](State& state) {
+        if (verb == "start" || verb == "stop") {
+            state.is_enabled = verb == "start";
+        } else if (verb == "categories") {
+            state.categories = words[1];
+        } else if (verb == "sample") {
+            state.sample_one_in = sample_one_in;
+        } else {
+            ++state.snapshot;
+        }
+    };
+
+    const std::lock_guard lock(m_lock);
+    std::vector<int> gone;
+    if (pid) {
+        apply(m_overrides.try_emplace(*pid, m_global).first->second);
+        if (const auto client = m_clients.find(*pid); client != m_clients.end() && !send(*pid, client->second)) {
+            gone.push_back(*pid);
+        }
+    } else {
+        apply(m_global);
+        for (auto& [_, state] : m_overrides) {
+            apply(state);
+        }
+        for (const auto& [client_pid, client] : m_clients) {
+            if (!send(client_pid, client)) {
+                gone.push_back(client_pid);
+            }
+        }
+    }
+    for (const int client_pid : gone) {
+        drop(client_pid);
+    }
+    return "";
+}
+
+ControlChannel::State ControlChannel::state(int pid) const
+{
+    const std::lock_guard lock(m_lock);
+    const auto state = m_overrides.find(pid);
+    return state != m_overrides.end() ? state->second : m_global;
+}
+
+size_t ControlChannel::client_count() const
+{
+    const std::lock_guard lock(m_lock);
+    return m_clients.size();
+}
+
+bool ControlChannel::send(int pid, const Client& client) const
+{
+    const auto state = m_overrides.find(pid);
+    const std::string record = (state != m_overrides.end() ? state->second : m_global).to_record();
+    // Records are far below PIPE_BUF, a write is all or nothing
+    if (::write(client.fd, record.data(), record.size()) >= 0) {
+        return true;
+    }
+    if (errno == EAGAIN) {
+        std::println(stderr, ">> Control pipe of client [{}] is full, it gets the state with the next command", pid);
+        return true;
+    }
+    return false;
+}
+
+void ControlChannel::drop(int pid)
+{
+    const auto client = m_clients.find(pid);
+    std::println(">> Client [{}] no longer reads {}", pid, client->second.path);
+    close(client->second.fd);
+    m_clients.erase(client);
+    // Pids are reused, a new process must not inherit the commands addressed to this one
+    m_overrides.erase(pid);
+}
+
+void ControlChannel::listen()
+{
+    std::string pending;
+    std::array<char, 1024> buffer;
+    pollfd fds[] = {
+        { m_read_fd, POLLIN, 0 },
+        { m_stop_fd, POLLIN, 0 },
+    };
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::println(stderr, "Poll error {}: {}", errno, strerror(errno));
+            return;
+        }
+        if (fds[1].revents != 0) {
+            return;
+        }
+        const ssize_t count = ::read(m_read_fd, buffer.data(), buffer.size());
+        if (count <= 0) {
+            continue;
+        }
+        pending.append(buffer.data(), static_cast<size_t>(count));
+        for (size_t end = pending.find('\n'); end != std::string::npos; end = pending.find('\n')) {
+            const std::string command = pending.substr(0, end);
+            pending.erase(0, end + 1);
+            if (command.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+            if (const std::string error = execute(command); !error.empty()) {
+                std::println(stderr, ">> Control: {}", error);
+            } else {
+                std::println(">> Control: {}", command);
+            }
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+/// @brief Operator commands for the clients of the collector, `--control <fifo>`.
+///
+/// Commands are lines written to the command FIFO, e.g. `echo "categories io,db" > ctl.fifo`:
+///
+///   start | stop            resume or pause tracing
+///   categories <a,b|*>      trace only these categories, or all
+///   sample <n>              keep one scope in n
+///   snapshot                flush the clients' queued events after a "snapshot" marker
+///
+/// A `pid=<pid>` token addresses a single client, which keeps its own state from then on;
+/// commands without it address every client. Clients announce their control FIFO with a HELLO
+/// message and get the current state right away, then a full state record after every command
+/// that concerns them, so a lost record is made up by the next. Only FIFOs owned by the
+/// collector's user are accepted. Clients that went away are dropped, along with their own state,
+/// on the first failed write.
+class ControlChannel {
+public:
+    struct State {
+        bool is_enabled { true };
+        std::string categories { "*" };
+        size_t sample_one_in { 1 };
+        uint64_t snapshot { 0 };
+
+        /// @brief The line sent to clients, "tracing=on categories=* sample=1 snapshot=0"
+        std::string to_record() const;
+    };
+
+    ControlChannel(std::string command_pipe, bool is_enabled);
+    ~ControlChannel();
+
+    ControlChannel(const ControlChannel&) = delete;
+    ControlChannel& operator=(const ControlChannel&) = delete;
+
+    /// @brief Create the command FIFO and start reading commands
+    bool init();
+
+    /// @brief Start controlling a client through the FIFO it announced
+    void add_client(int pid, const std::string& control_path);
+
+    /// @brief Run a command and send the new state to the clients it concerns. Returns the error
+    /// message, or an empty string.
+    std::string execute(std::string_view command);
+
+    /// @brief The state a client gets
+    State state(int pid) const;
+
+    size_t client_count() const;
+
+private:
+    struct Client {
+        int fd;
+        std::string path;
+    };
+
+    /// @brief Write the client's state, false if it went away
+    bool send(int pid, const Client& client) const;
+    void drop(int pid);
+    void listen();
+
+    std::string m_command_pipe;
+    int m_read_fd { -1 };
+    int m_keepalive_fd { -1 };
+    int m_stop_fd { -1 };
+    std::thread m_listener;
+
+    mutable std::mutex m_lock;
+    State m_global;
+    std::map<int, State> m_overrides;
+    std::map<int, Client> m_clients;
+};
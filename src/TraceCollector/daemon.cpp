@@ -0,0 +1,287 @@
+#include "daemon.hpp"
+
+#include "control_channel.hpp"
+#include "event_batch.hpp"
+#include "session.hpp"
+
+#include <IPC/pipe_reader.hpp>
+
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <print>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <poll.h> // poll
+#include <string.h> // strerror
+#include <sys/eventfd.h> // eventfd
+#include <unistd.h> // read, write
+
+struct Daemon::SessionState {
+    SessionState(const SessionConfig& config)
+        : name(config.name)
+        , reader(config.options.pipe_path)
+        , session(config.options, false)
+        , budget(config.options.budget_mb << 20)
+    {
+        if (!config.options.control_pipe.empty()) {
+            control = std::make_unique<ControlChannel>(config.options.control_pipe, config.options.is_tracing);
+        }
+    }
+
+    std::string name;
+    IPC::PipeReader reader;
+    Session session;
+    size_t budget;
+    std::unique_ptr<ControlChannel> control;
+
+    // Only touched by the event loop
+    std::unique_ptr<EventBatch> batch { std::make_unique<EventBatch>() };
+    std::chrono::steady_clock::time_point batch_started;
+    std::set<int> clients;
+    uint64_t next_sequence { 0 };
+
+    // Guarded by Daemon::m_lock
+    std::deque<std::pair<uint64_t, std::unique_ptr<EventBatch>>> queue;
+    size_t queued_bytes { 0 };
+
+    /// @var is_scheduled In the ready list or taken by a worker
+    bool is_scheduled { false };
+};
+
+std::vector<Daemon::SessionConfig> Daemon::load_sessions(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        throw std::runtime_error("Failed to open sessions file " + path);
+    }
+    std::vector<SessionConfig> sessions;
+    std::set<std::string> names;
+    std::set<std::string> files;
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); ++number) {
+        std::istringstream words(line);
+        std::vector<std::string> tokens { std::istream_iterator<std::string>(words), std::istream_iterator<std::string>() };
+        if (tokens.empty() || tokens.front().starts_with('#')) {
+            continue;
+        }
+        const std::string where = std::format("{}:{}: ", path, number);
+        // The name takes the place of the program name
+        std::vector<char*> argv;
+        for (std::string& token : tokens) {
+            argv.push_back(token.data());
+        }
+        SessionConfig config { tokens.front(), {} };
+        const auto handler = [&](std::string_view key, std::string_view value) { return command_handler(key, value, config.options); };
+        if (argv.size() < 2 || !Args::parse_args_impl(static_cast<int>(argv.size()), argv.data(), handler)) {
+            throw std::runtime_error(where + "invalid options for session " + config.name);
+        }
+        if (const std::string error = check_options(config.options, false); !error.empty()) {
+            throw std::runtime_error(where + error);
+        }
+        if (!names.insert(config.name).second) {
+            throw std::runtime_error(where + "duplicate session " + config.name);
+        }
+        // Sessions share nothing, files written twice would be corrupted
+        std::vector<std::string> session_files { config.options.pipe_path, config.options.summary_file, config.options.columnar_file,
+            config.options.control_pipe };
+        if (config.options.write_events) {
+            session_files.push_back(config.options.output_file);
+        }
+        for (const std::string& file : session_files) {
+            if (!file.empty() && !files.insert(file).second) {
+                throw std::runtime_error(where + file + " is used by another session");
+            }
+        }
+        sessions.push_back(std::move(config));
+    }
+    if (sessions.empty()) {
+        throw std::runtime_error(path + " has no sessions");
+    }
+    return sessions;
+}
+
+Daemon::Daemon(const std::vector<SessionConfig>& sessions, size_t workers)
+    : m_worker_count(std::max<size_t>(workers, 1))
+    , m_wake_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    if (m_wake_fd < 0) {
+        throw std::runtime_error(std::string("Failed to create eventfd: ") + strerror(errno));
+    }
+    for (const SessionConfig& config : sessions) {
+        auto& state = m_sessions.emplace_back(std::make_unique<SessionState>(config));
+        if (!state->reader.init()) {
+            throw std::runtime_error("Failed to open the pipe of session " + config.name);
+        }
+        if (state->control && !state->control->init()) {
+            throw std::runtime_error("Failed to open the control pipe of session " + config.name);
+        }
+    }
+}
+
+Daemon::~Daemon()
+{
+    if (m_wake_fd >= 0) {
+        close(m_wake_fd);
+    }
+}
+
+void Daemon::run()
+{
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < m_worker_count; ++i) {
+        workers.emplace_back([this]() { work(); });
+    }
+
+    std::vector<pollfd> fds;
+    std::vector<SessionState*> polled;
+    while (!m_should_stop.load()) {
+        fds.assign(1, { m_wake_fd, POLLIN, 0 });
+        polled.clear();
+        {
+            const std::lock_guard lock(m_lock);
+            for (const auto& state : m_sessions) {
+                // Over its budget, a session's clients wait on the pipe instead of growing the queue
+                if (state->queued_bytes < state->budget) {
+                    fds.push_back({ state->reader.fd(), POLLIN, 0 });
+                    polled.push_back(state.get());
+                }
+            }
+        }
+        if (poll(fds.data(), fds.size(), static_cast<int>(FLUSH_INTERVAL.count())) < 0 && errno != EINTR) {
+            std::println(stderr, "Poll error {}: {}", errno, strerror(errno));
+            break;
+        }
+        if ((fds.front().revents & POLLIN) != 0) {
+            uint64_t wakeups = 0;
+            std::ignore = ::read(m_wake_fd, &wakeups, sizeof(wakeups));
+        }
+        for (size_t i = 1; i < fds.size(); ++i) {
+            if ((fds[i].revents & POLLIN) != 0) {
+                read(*polled[i - 1]);
+            }
+        }
+        // Quiet sessions don't keep their events waiting for a full batch
+        const auto now = std::chrono::steady_clock::now();
+        for (const auto& state : m_sessions) {
+            if (!state->batch->empty() && now - state->batch_started >= FLUSH_INTERVAL) {
+                enqueue(*state);
+            }
+        }
+    }
+
+    // Whatever the clients already wrote still goes to the outputs
+    for (const auto& state : m_sessions) {
+        while (read(*state) != 0) {
+        }
+        if (!state->batch->empty()) {
+            enqueue(*state);
+        }
+    }
+    {
+        const std::lock_guard lock(m_lock);
+        m_is_stopping = true;
+    }
+    m_work_ready.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (const auto& state : m_sessions) {
+        state->session.finish(state->next_sequence);
+    }
+}
+
+void Daemon::stop()
+{
+    m_should_stop.store(true);
+    wake();
+}
+
+void Daemon::wake()
+{
+    const uint64_t wakeup = 1;
+    std::ignore = ::write(m_wake_fd, &wakeup, sizeof(wakeup));
+}
+
+size_t Daemon::read(SessionState& state)
+{
+    return state.reader.read([&](const IPC::Message& msg) {
+        if (state.clients.insert(msg.pid).second) {
+            std::println(">> [{}] New client PID [{}]", state.name, msg.pid);
+        }
+        if (msg.kind == IPC::MessageKind::STOP) {
+            state.clients.erase(msg.pid);
+            std::println(">> [{}] Client [{}] disconnected. Clients {}", state.name, msg.pid, state.clients.size());
+            if (state.clients.empty() && !state.batch->empty()) {
+                enqueue(state);
+            }
+            return;
+        }
+        if (msg.kind == IPC::MessageKind::HELLO) {
+            if (state.control) {
+                state.control->add_client(msg.pid, msg.body);
+            }
+            return;
+        }
+        if (state.batch->empty()) {
+            state.batch_started = std::chrono::steady_clock::now();
+        }
+        state.batch->add(msg.body);
+        if (state.batch->is_full()) {
+            enqueue(state);
+        }
+    });
+}
+
+void Daemon::enqueue(SessionState& state)
+{
+    std::unique_ptr<EventBatch> batch = std::exchange(state.batch, std::make_unique<EventBatch>());
+    {
+        const std::lock_guard lock(m_lock);
+        state.queued_bytes += batch->bytes();
+        state.queue.emplace_back(state.next_sequence++, std::move(batch));
+        if (state.is_scheduled) {
+            return;
+        }
+        state.is_scheduled = true;
+        m_ready.push_back(&state);
+    }
+    m_work_ready.notify_one();
+}
+
+void Daemon::work()
+{
+    std::unique_lock lock(m_lock);
+    while (true) {
+        m_work_ready.wait(lock, [&]() { return !m_ready.empty() || m_is_stopping; });
+        if (m_ready.empty()) {
+            return;
+        }
+        SessionState& state = *m_ready.front();
+        m_ready.pop_front();
+        auto [sequence, batch] = std::move(state.queue.front());
+        state.queue.pop_front();
+        const size_t bytes = batch->bytes();
+
+        lock.unlock();
+        state.session.flush(std::move(batch), sequence);
+        lock.lock();
+
+        const bool was_over_budget = state.queued_bytes >= state.budget;
+        state.queued_bytes -= bytes;
+        if (state.queue.empty()) {
+            state.is_scheduled = false;
+        } else {
+            // Back to the end of the list, the other sessions go first
+            m_ready.push_back(&state);
+            m_work_ready.notify_one();
+        }
+        if (was_over_budget && state.queued_bytes < state.budget) {
+            wake();
+        }
+    }
+}
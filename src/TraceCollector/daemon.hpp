@@ -0,0 +1,80 @@
+#pragma once
+
+#include "args.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// @brief One collector process serving many independent sessions, `--sessions <file>`.
+///
+/// Every session has its own pipe, outputs and buffer budget, configured with the collector's
+/// options. A single event loop polls all pipes and reads at most IPC::PipeReader::READ_LIMIT
+/// bytes from each ready one per round, appending the events to the session's current batch. Full
+/// batches, and partial ones that waited FLUSH_INTERVAL, go to the session's queue.
+///
+/// A shared pool of workers decodes and writes the batches. Sessions with queued batches wait in
+/// a round-robin list and a worker takes one batch of the first session, which rejoins the end of
+/// the list if it has more. A session is served by one worker at a time, keeping its batches in
+/// order, so a busy session gets at most one worker while the others still get their turn. A
+/// session whose queue reaches its budget isn't read until the workers catch up: its clients
+/// block on the full pipe, the other sessions carry on.
+///
+/// Sessions last until the daemon stops, clients come and go.
+class Daemon {
+public:
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL { 100 };
+
+    struct SessionConfig {
+        std::string name;
+        ArgsOpts options;
+    };
+
+    /// @brief Read the sessions of a file, one per line: a name followed by collector options.
+    /// Empty lines and lines starting with '#' are skipped. Throws std::runtime_error for an
+    /// invalid session or sessions sharing a pipe or an output file.
+    static std::vector<SessionConfig> load_sessions(const std::string& path);
+
+    /// @brief Open the pipes and outputs of every session, throws std::runtime_error on failure
+    Daemon(const std::vector<SessionConfig>& sessions, size_t workers);
+    ~Daemon();
+
+    Daemon(const Daemon&) = delete;
+    Daemon& operator=(const Daemon&) = delete;
+
+    /// @brief Serve the sessions until stop(). Events already in the pipes are still written before
+    /// the outputs are closed.
+    void run();
+
+    /// @brief Make run() return, from any thread or a signal handler
+    void stop();
+
+private:
+    struct SessionState;
+
+    /// @brief Batch the messages of one read of the session's pipe, the bytes read
+    size_t read(SessionState& state);
+    void enqueue(SessionState& state);
+    void work();
+    void wake();
+
+    std::vector<std::unique_ptr<SessionState>> m_sessions;
+    size_t m_worker_count;
+
+    /// @var m_wake_fd Eventfd interrupting the poll of the event loop
+    int m_wake_fd { -1 };
+    std::atomic_bool m_should_stop { false };
+
+    std::mutex m_lock;
+    std::condition_variable m_work_ready;
+
+    /// @var m_ready Sessions with queued batches that no worker is serving, in round-robin order
+    std::deque<SessionState*> m_ready;
+    bool m_is_stopping { false };
+};
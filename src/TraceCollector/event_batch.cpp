@@ -0,0 +1,308 @@
+#include "event_batch.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <print>
+
+namespace {
+/// @brief Take the text up to the next newline off the front of `body`
+bool next_line(std::string_view& body, std::string_view& line)
+{
+    const size_t end = body.find('\n');
+    if (end == std::string_view::npos) {
+        return false;
+    }
+    line = body.substr(0, end);
+    body.remove_prefix(end + 1);
+    return true;
+}
+
+template <class T>
+bool next_number(std::string_view& body, T& value)
+{
+    std::string_view line;
+    if (!next_line(body, line)) {
+        return false;
+    }
+    const auto [end, error] = std::from_chars(line.data(), line.data() + line.size(), value);
+    return error == std::errc {} && end == line.data() + line.size();
+}
+
+template <class T>
+bool next_binary(std::string_view& body, T& value)
+{
+    if (body.size() < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, body.data(), sizeof(T));
+    body.remove_prefix(sizeof(T));
+    return true;
+}
+
+/// @brief Copy text into `strings` with a trailing NUL, as the arguments of an event expect
+const char* copy_string(std::pmr::memory_resource& strings, std::string_view text)
+{
+    auto* copy = static_cast<char*>(strings.allocate(text.size() + 1, 1));
+    std::memcpy(copy, text.data(), text.size());
+    copy[text.size()] = '\0';
+    return copy;
+}
+
+/// @brief Argument keys and string values. They're copied into `strings` rather than interned:
+/// values like ids are unique per event and would grow the tracer's table without bound.
+bool next_string(std::string_view& body, std::pmr::memory_resource& strings, const char*& value)
+{
+    // Keys and values are short labels, anything larger is a corrupted stream
+    static constexpr size_t MAX_LENGTH { 4096 };
+
+    size_t length = 0;
+    if (!next_binary(body, length) || length > MAX_LENGTH || length > body.size()) {
+        return false;
+    }
+    value = copy_string(strings, body.substr(0, length));
+    body.remove_prefix(length);
+    return true;
+}
+
+bool decode_args(std::string_view body, std::pmr::memory_resource& strings, Tracer::EventArgs& args)
+{
+    uint8_t count = 0;
+    if (!next_binary(body, count)) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; ++i) {
+        const char* key = nullptr;
+        Tracer::EventArg::Type type {};
+        if (!next_string(body, strings, key) || !next_binary(body, type)) {
+            return false;
+        }
+        switch (type) {
+        case Tracer::EventArg::Type::INT: {
+            int64_t value = 0;
+            if (!next_binary(body, value)) {
+                return false;
+            }
+            args.add(key, value);
+            break;
+        }
+        case Tracer::EventArg::Type::DOUBLE: {
+            double value = 0;
+            if (!next_binary(body, value)) {
+                return false;
+            }
+            args.add(key, value);
+            break;
+        }
+        case Tracer::EventArg::Type::STRING: {
+            const char* value = nullptr;
+            if (!next_string(body, strings, value)) {
+                return false;
+            }
+            args.add_unowned(key, value);
+            break;
+        }
+        case Tracer::EventArg::Type::ID: {
+            uint64_t value = 0;
+            if (!next_binary(body, value)) {
+                return false;
+            }
+            args.add_id(key, value);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Integers go through to_chars, the hot path of the collector shouldn't parse format strings
+template <class T>
+void append_number(std::string& out, T value, int base = 10)
+{
+    std::array<char, 24> text {};
+    const auto result = std::to_chars(text.data(), text.data() + text.size(), value, base);
+    out.append(text.data(), result.ptr);
+}
+
+void append_json_args(std::string& out, const Tracer::EventArgs& args)
+{
+    out += R"(,"args":{)";
+    bool is_first = true;
+    for (const Tracer::EventArg& arg : args) {
+        if (!is_first) {
+            out += ',';
+        }
+        is_first = false;
+
+        append_json_string(out, arg.key);
+        out += ':';
+        switch (arg.type) {
+        case Tracer::EventArg::Type::INT:
+            append_number(out, arg.i);
+            break;
+        case Tracer::EventArg::Type::DOUBLE:
+            if (std::isfinite(arg.d)) {
+                // The 6 significant digits of an ostream, as the tracer writes them
+                std::array<char, 32> text {};
+                const auto result = std::to_chars(text.data(), text.data() + text.size(), arg.d, std::chars_format::general, 6);
+                out.append(text.data(), result.ptr);
+            } else {
+                // JSON has no representation for NaN or infinity
+                out += "null";
+            }
+            break;
+        case Tracer::EventArg::Type::STRING:
+            append_json_string(out, arg.s);
+            break;
+        case Tracer::EventArg::Type::ID: {
+            // All 16 digits, leading zeros included
+            std::array<char, 16> digits {};
+            const auto result = std::to_chars(digits.data(), digits.data() + digits.size(), arg.id, 16);
+            out += '"';
+            out.append(digits.size() - static_cast<size_t>(result.ptr - digits.data()), '0');
+            out.append(digits.data(), result.ptr);
+            out += '"';
+            break;
+        }
+        }
+    }
+    out += '}';
+}
+} // namespace
+
+EventBatch::EventBatch()
+    : m_arena(m_initial_arena.data(), m_initial_arena.size())
+    , m_bodies(&m_arena)
+    , m_events(&m_arena)
+{
+    m_bodies.reserve(CAPACITY);
+}
+
+void EventBatch::add(std::string_view body)
+{
+    auto* copy = static_cast<char*>(m_arena.allocate(body.size(), 1));
+    std::memcpy(copy, body.data(), body.size());
+    m_bodies.emplace_back(copy, body.size());
+    m_bytes += body.size();
+}
+
+void EventBatch::decode()
+{
+    m_events.reserve(m_bodies.size());
+    for (const std::string_view body : m_bodies) {
+        EventRecord& event = m_events.emplace_back();
+        if (!decode_event(body, m_arena, event)) {
+            std::println(stderr, "Dropping malformed event");
+            m_events.pop_back();
+        }
+    }
+}
+
+void EventBatch::add_event(const EventRecord& event)
+{
+    const auto copy = [this](std::string_view text) {
+        auto* data = static_cast<char*>(m_arena.allocate(text.size(), 1));
+        std::memcpy(data, text.data(), text.size());
+        return std::string_view(data, text.size());
+    };
+    EventRecord& added = m_events.emplace_back(event);
+    added.name = copy(event.name);
+    added.cat = copy(event.cat);
+    for (uint8_t i = 0; i < added.args.count; ++i) {
+        Tracer::EventArg& arg = added.args.items[i];
+        arg.key = copy_string(m_arena, arg.key);
+        if (arg.type == Tracer::EventArg::Type::STRING) {
+            arg.s = copy_string(m_arena, arg.s);
+        }
+    }
+}
+
+bool decode_event(std::string_view body, std::pmr::memory_resource& strings, EventRecord& event)
+{
+    std::string_view ph;
+    const bool is_decoded = next_line(body, event.name) && next_line(body, event.cat) && next_line(body, ph) && ph.size() == 1
+        && next_number(body, event.ts) && next_number(body, event.pid) && next_number(body, event.tid)
+        && next_number(body, event.dur) && next_number(body, event.id);
+    if (!is_decoded) {
+        return false;
+    }
+    event.ph = ph.front();
+    event.args = {};
+    // Events without arguments section end after the id
+    return body.empty() || decode_args(body, strings, event.args);
+}
+
+void append_json_string(std::string& out, std::string_view value)
+{
+    static constexpr std::string_view HEX_DIGITS { "0123456789abcdef" };
+    out += '"';
+    // Runs that need no escape are appended at once, names rarely have any
+    size_t run = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        const auto c = static_cast<unsigned char>(value[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        out.append(value.substr(run, i - run));
+        run = i + 1;
+        switch (c) {
+        case '"':
+            out += R"(\")";
+            break;
+        case '\\':
+            out += R"(\\)";
+            break;
+        case '\n':
+            out += R"(\n)";
+            break;
+        case '\r':
+            out += R"(\r)";
+            break;
+        case '\t':
+            out += R"(\t)";
+            break;
+        default:
+            out += R"(\u00)";
+            out += HEX_DIGITS[c >> 4];
+            out += HEX_DIGITS[c & 0xf];
+            break;
+        }
+    }
+    out.append(value.substr(run));
+    out += '"';
+}
+
+void append_json(std::string& out, const EventRecord& event)
+{
+    out += R"({"name":)";
+    append_json_string(out, event.name);
+    out += R"(,"cat":)";
+    append_json_string(out, event.cat);
+    out += R"(,"ph":")";
+    out += event.ph;
+    out += R"(","ts":)";
+    append_number(out, event.ts);
+    out += R"(,"pid":)";
+    append_number(out, event.pid);
+    out += R"(,"tid":)";
+    append_number(out, event.tid);
+    if (event.ph == 'X') {
+        out += R"(,"dur":)";
+        append_number(out, event.dur);
+    }
+    if (Tracer::is_async_phase(event.ph) || Tracer::is_flow_phase(event.ph)) {
+        out += R"(,"id":"0x)";
+        append_number(out, event.id, 16);
+        out += '"';
+    }
+    if (event.ph == 'f') {
+        out += R"(,"bp":"e")";
+    }
+    if (!event.args.empty()) {
+        append_json_args(out, event.args);
+    }
+    out += '}';
+}
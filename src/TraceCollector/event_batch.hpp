@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Profiler/chrome_event.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief An event as the collector decodes it. Unlike Tracer::ChromeEvent, name and category are
+/// views into the message body and argument strings are copies in the batch's arena, all valid as
+/// long as the batch.
+struct EventRecord {
+    std::string_view name;
+    std::string_view cat;
+    char ph;
+    int64_t ts;
+    int pid;
+    uint64_t tid;
+    int64_t dur;
+    uint64_t id;
+    Tracer::EventArgs args;
+};
+
+/// @brief Messages received together, and the events decoded from them.
+///
+/// Message bodies are copied back to back into a monotonic arena and the events are decoded from
+/// them in place, so a batch costs a handful of allocations instead of several per event. Nothing
+/// is freed per event: the whole arena goes away with the batch, once every sink consumed it.
+class EventBatch {
+public:
+    static constexpr size_t CAPACITY { 100 };
+
+    EventBatch();
+
+    EventBatch(const EventBatch&) = delete;
+    EventBatch& operator=(const EventBatch&) = delete;
+
+    /// @brief Copy a message body into the batch
+    void add(std::string_view body);
+
+    bool empty() const { return m_bodies.empty(); }
+    bool is_full() const { return m_bodies.size() >= CAPACITY; }
+
+    /// @brief Size of the message bodies
+    size_t bytes() const { return m_bytes; }
+
+    /// @brief Decode the bodies into events, dropping malformed ones
+    void decode();
+
+    std::span<const EventRecord> events() const { return m_events; }
+    std::span<EventRecord> events() { return m_events; }
+
+    /// @brief Add a decoded event, its name, category and argument strings are copied into the batch
+    void add_event(const EventRecord& event);
+
+    /// @brief Drop the decoded events matching `predicate`
+    template <class Predicate>
+    void remove_events(Predicate predicate)
+    {
+        std::erase_if(m_events, predicate);
+    }
+
+private:
+    /// @brief Bodies of about 100 bytes and their events fit without asking the heap for more
+    static constexpr size_t INITIAL_ARENA_SIZE { CAPACITY * (128 + sizeof(EventRecord)) };
+
+    alignas(std::max_align_t) std::array<std::byte, INITIAL_ARENA_SIZE> m_initial_arena;
+    std::pmr::monotonic_buffer_resource m_arena;
+    std::pmr::vector<std::string_view> m_bodies;
+    std::pmr::vector<EventRecord> m_events;
+    size_t m_bytes { 0 };
+};
+
+/// @brief Decode a body in the stream format of Tracer::serialize_to_stream, false if it's malformed.
+/// Argument strings are allocated from `strings`, name and category point into `body`.
+bool decode_event(std::string_view body, std::pmr::memory_resource& strings, EventRecord& event);
+
+/// @brief Append a JSON string literal, escaped as RFC 8259 asks
+void append_json_string(std::string& out, std::string_view value);
+
+/// @brief Append the event as a JSON object, the same text Tracer::serialize_to_json writes
+void append_json(std::string& out, const EventRecord& event);
@@ -1,54 +1,130 @@
 #pragma once
 
+#include "args.hpp"
+#include "control_channel.hpp"
+#include "event_batch.hpp"
+#include "session.hpp"
+
 #include <IPC/message.hpp>
 #include <IPC/server.hpp>
-#include <Profiler/chrome_event.hpp>
-#include <Profiler/exporters/file_exporter.hpp>
 
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <print>
-#include <sstream>
 #include <thread>
+#include <utility>
 
-inline void flush_events(Tracer::FileExporter& exporter, std::vector<std::string> events)
-{
-    for (const auto& raw_event : events) {
-        Tracer::ChromeEvent event {};
-        std::stringstream ss(raw_event);
-        ss >> event;
-        exporter.push_trace(event);
+/// @brief Flushes the batches of the single-session collector on one thread, in order.
+///
+/// Once `budget` bytes of batches are queued, add() blocks until the worker catches up: the reader
+/// stops draining the pipe and the clients wait, like the daemon does for a session over budget.
+class FlushWorker {
+public:
+    FlushWorker(const Session& session, size_t budget)
+        : m_session(session)
+        , m_budget(budget)
+        , m_thread([this]() { work(); })
+    {
     }
-}
 
-inline void async_flush_events(Tracer::FileExporter& exporter, std::vector<std::string>&& raw_events)
-{
-    std::vector<std::string> events_to_flush;
-    events_to_flush.reserve(raw_events.size());
-    events_to_flush.swap(raw_events);
+    /// @brief Flushes what is still queued
+    ~FlushWorker()
+    {
+        {
+            const std::lock_guard lock(m_lock);
+            m_is_stopping = true;
+        }
+        m_changed.notify_all();
+        m_thread.join();
+    }
 
-    std::thread([&exporter, events_to_flush = std::move(events_to_flush)]() {
-        flush_events(exporter, std::move(events_to_flush));
-    }).detach();
-}
+    FlushWorker(const FlushWorker&) = delete;
+    FlushWorker& operator=(const FlushWorker&) = delete;
+
+    void add(std::unique_ptr<EventBatch> batch, uint64_t sequence)
+    {
+        std::unique_lock lock(m_lock);
+        m_changed.wait(lock, [&]() { return m_queued_bytes < m_budget; });
+        m_queued_bytes += batch->bytes();
+        m_queue.emplace_back(sequence, std::move(batch));
+        lock.unlock();
+        m_changed.notify_all();
+    }
+
+private:
+    void work()
+    {
+        std::unique_lock lock(m_lock);
+        while (true) {
+            m_changed.wait(lock, [&]() { return !m_queue.empty() || m_is_stopping; });
+            if (m_queue.empty()) {
+                return;
+            }
+            auto [sequence, batch] = std::move(m_queue.front());
+            m_queue.pop_front();
+            const size_t bytes = batch->bytes();
+
+            lock.unlock();
+            m_session.flush(std::move(batch), sequence);
+            lock.lock();
 
-inline void run(IPC::PipeServer& server, std::string_view output_file)
+            m_queued_bytes -= bytes;
+            m_changed.notify_all();
+        }
+    }
+
+    const Session& m_session;
+    size_t m_budget;
+
+    std::mutex m_lock;
+    std::condition_variable m_changed;
+    std::deque<std::pair<uint64_t, std::unique_ptr<EventBatch>>> m_queue;
+    size_t m_queued_bytes { 0 };
+    bool m_is_stopping { false };
+
+    /// @var m_thread Last member, it runs work() as soon as it's constructed
+    std::thread m_thread;
+};
+
+inline void run(IPC::PipeServer& server, const ArgsOpts& options)
 {
-    Tracer::FileExporter& exporter = Tracer::FileExporter::instance(output_file.data());
+    Session session(options, true);
 
-    std::vector<std::string> raw_events {};
-    raw_events.reserve(100);
+    std::unique_ptr<ControlChannel> control;
+    if (!options.control_pipe.empty()) {
+        control = std::make_unique<ControlChannel>(options.control_pipe, options.is_tracing);
+        if (!control->init()) {
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    auto batch = std::make_unique<EventBatch>();
+    uint64_t next_sequence { 0 };
+    auto flush_worker = std::make_unique<FlushWorker>(session, options.budget_mb << 20);
 
     const auto message_handler = [&](const IPC::Message& msg) {
         // std::println("Received message:\n{}", IPC::to_string(msg));
-        raw_events.emplace_back(msg.body);
-        if (raw_events.size() >= raw_events.capacity()) {
-            async_flush_events(exporter, std::move(raw_events));
+        if (msg.kind == IPC::MessageKind::HELLO) {
+            if (control) {
+                control->add_client(msg.pid, msg.body);
+            }
+            return;
+        }
+        batch->add(msg.body);
+        if (batch->is_full()) {
+            flush_worker->add(std::exchange(batch, std::make_unique<EventBatch>()), next_sequence++);
         }
     };
 
     const auto stop_handler = [&]() {
-        if (!raw_events.empty()) {
-            flush_events(exporter, raw_events);
+        if (!batch->empty()) {
+            flush_worker->add(std::move(batch), next_sequence++);
         }
+        flush_worker.reset();
+        session.finish(next_sequence);
         std::println("Trace collector shutdown complete");
     };
 
@@ -0,0 +1,131 @@
+#include "flow_stitcher.hpp"
+
+#include <utility>
+
+namespace {
+/// @brief Phase of the ends held back, removed from their batch
+constexpr char HELD { '\0' };
+} // namespace
+
+void FlowStitcher::stitch(uint64_t sequence, EventBatch& batch)
+{
+    auto lock = m_sequencer.enter(sequence);
+
+    // Events added below may move the batch's events, they are looked up by index
+    const size_t count = batch.events().size();
+    bool has_held = false;
+    for (size_t i = 0; i < count; ++i) {
+        EventRecord& event = batch.events()[i];
+        if (event.ph == 's') {
+            const uint64_t id = event.id;
+            const auto [entry, is_new] = m_starts.insert_or_assign(id, Start { KeptEvent(event), false });
+            Start& start = entry->second;
+            if (is_new) {
+                m_start_order.push_back(id);
+            }
+            if (const auto held = m_held.find(id); held != m_held.end()) {
+                for (const KeptEvent& end : held->second) {
+                    EventRecord record = end.record();
+                    record.id = this->end(start, batch);
+                    batch.add_event(record);
+                }
+                m_held_count -= held->second.size();
+                m_held.erase(held);
+            }
+        } else if (event.ph == 'f') {
+            if (const auto start = m_starts.find(event.id); start != m_starts.end()) {
+                const uint64_t id = end(start->second, batch);
+                batch.events()[i].id = id;
+                continue;
+            }
+            m_held[event.id].emplace_back(event);
+            m_held_order.push_back(event.id);
+            ++m_held_count;
+            event.ph = HELD;
+            has_held = true;
+        }
+    }
+    if (has_held) {
+        batch.remove_events([](const EventRecord& event) { return event.ph == HELD; });
+    }
+    forget_oldest();
+
+    m_sequencer.leave(lock);
+}
+
+FlowStitcher::Stats FlowStitcher::finish(uint64_t sequence)
+{
+    const auto lock = m_sequencer.wait_for(sequence);
+    m_stats.unmatched += std::exchange(m_held_count, 0);
+    m_held.clear();
+    m_held_order.clear();
+    return m_stats;
+}
+
+uint64_t FlowStitcher::end(Start& start, EventBatch& batch)
+{
+    EventRecord copy = start.event.record();
+    if (!start.is_ended) {
+        start.is_ended = true;
+        ++m_stats.stitched;
+        return copy.id;
+    }
+    copy.id = m_next_id++;
+    batch.add_event(copy);
+    ++m_stats.fanned_out;
+    return copy.id;
+}
+
+FlowStitcher::KeptEvent::KeptEvent(const EventRecord& event)
+    : m_name(event.name)
+    , m_cat(event.cat)
+    , m_event(event)
+{
+    for (const Tracer::EventArg& arg : event.args) {
+        m_strings.emplace_back(arg.key);
+        if (arg.type == Tracer::EventArg::Type::STRING) {
+            m_strings.emplace_back(arg.s);
+        }
+    }
+}
+
+EventRecord FlowStitcher::KeptEvent::record() const
+{
+    EventRecord record = m_event;
+    record.name = m_name;
+    record.cat = m_cat;
+    auto text = m_strings.begin();
+    for (uint8_t i = 0; i < record.args.count; ++i) {
+        Tracer::EventArg& arg = record.args.items[i];
+        arg.key = (text++)->c_str();
+        if (arg.type == Tracer::EventArg::Type::STRING) {
+            arg.s = (text++)->c_str();
+        }
+    }
+    return record;
+}
+
+void FlowStitcher::forget_oldest()
+{
+    while (m_starts.size() > MAX_FLOWS) {
+        m_starts.erase(m_start_order.front());
+        m_start_order.pop_front();
+    }
+    // Ids of released ends stay in the order, they are skipped
+    while (m_held_count > MAX_FLOWS) {
+        const auto held = m_held.find(m_held_order.front());
+        m_held_order.pop_front();
+        if (held == m_held.end()) {
+            continue;
+        }
+        held->second.erase(held->second.begin());
+        if (held->second.empty()) {
+            m_held.erase(held);
+        }
+        --m_held_count;
+        ++m_stats.unmatched;
+    }
+    if (m_held_order.size() > 2 * MAX_FLOWS) {
+        std::erase_if(m_held_order, [this](uint64_t id) { return !m_held.contains(id); });
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "event_batch.hpp"
+#include "sequencer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// @brief Links the flow halves that the processes of a session report for a Tracer::TraceContext.
+///
+/// A flow starts ('s') in the process that exported a context and ends ('f') in the one that
+/// imported it, both with the context's span id. The halves arrive independently: clients buffer
+/// their events, so the callee often reports before the caller. Ends whose start didn't arrive yet
+/// are held back and go out with the batch that brings it. A context imported more than once, by a
+/// fan-out or a retry, would end an already ended flow, which viewers ignore: each further end gets
+/// a flow of its own, started by a copy of the original start.
+///
+/// At most MAX_FLOWS starts and held ends are remembered, the oldest are forgotten first. Ends whose
+/// start never arrived are dropped when the session finishes.
+class FlowStitcher {
+public:
+    static constexpr size_t MAX_FLOWS { 65536 };
+
+    struct Stats {
+        uint64_t stitched;
+        uint64_t fanned_out;
+        uint64_t unmatched;
+    };
+
+    /// @brief Stitch the flows of a decoded batch, after the batches before `sequence`
+    void stitch(uint64_t sequence, EventBatch& batch);
+
+    /// @brief Wait until every batch before `sequence` was stitched, then drop the held ends
+    Stats finish(uint64_t sequence);
+
+private:
+    /// @brief An event kept across batches, with copies of the text that lives in its batch
+    class KeptEvent {
+    public:
+        explicit KeptEvent(const EventRecord& event);
+
+        /// @brief The event, pointing into this copy
+        EventRecord record() const;
+
+    private:
+        std::string m_name;
+        std::string m_cat;
+        std::vector<std::string> m_strings; // keys and string values of the arguments, in order
+        EventRecord m_event;
+    };
+
+    struct Start {
+        KeptEvent event;
+        bool is_ended;
+    };
+
+    /// @brief Count an end of a started flow and return the id it must carry: the start's, or the
+    /// id of a copy of the start added to `batch` when another end already took it
+    uint64_t end(Start& start, EventBatch& batch);
+
+    void forget_oldest();
+
+    Sequencer m_sequencer;
+    std::unordered_map<uint64_t, Start> m_starts;
+    std::deque<uint64_t> m_start_order;
+    std::unordered_map<uint64_t, std::vector<KeptEvent>> m_held;
+    std::deque<uint64_t> m_held_order;
+    size_t m_held_count { 0 };
+
+    /// @var m_next_id Ids of flows added for fan-outs. Clients fold their pid into the upper half of
+    /// their ids, which never reaches the top bit.
+    uint64_t m_next_id { uint64_t { 1 } << 63 };
+    Stats m_stats {};
+};
@@ -1,15 +1,71 @@
 #include "args.hpp"
+#include "daemon.hpp"
 #include "events.hpp"
 
+#include <csignal>
+#include <stdexcept>
+
+namespace {
+Daemon* running_daemon = nullptr;
+
+int run_daemon(const ArgsOpts& options)
+{
+    try {
+        const std::vector<Daemon::SessionConfig> sessions = Daemon::load_sessions(options.sessions_file);
+        std::println("Starting trace collector daemon with {} sessions and {} workers:", sessions.size(), options.workers);
+        for (const auto& [name, session] : sessions) {
+            std::println("  {}: {} -> {}, {} MB budget", name, session.pipe_path, session.write_events ? session.output_file : "no events",
+                session.budget_mb);
+        }
+        Daemon daemon(sessions, options.workers);
+        running_daemon = &daemon;
+        const auto handler = [](int /* signal */) { running_daemon->stop(); };
+        std::signal(SIGINT, handler);
+        std::signal(SIGTERM, handler);
+        daemon.run();
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        running_daemon = nullptr;
+    } catch (const std::exception& error) {
+        std::println(stderr, "{}", error.what());
+        return EXIT_FAILURE;
+    }
+    std::println("Trace collector daemon shutdown complete");
+    return 0;
+}
+} // namespace
+
 int main(int argc, char** argv)
 {
     const ArgsOpts options = Args::parse<ArgsOpts>(argc, argv, command_handler);
     std::string_view pipe_path = options.pipe_path;
     std::string_view output_file = options.output_file;
+    if (!options.sessions_file.empty()) {
+        return run_daemon(options);
+    }
+    if (const std::string error = check_options(options); !error.empty()) {
+        std::println(stderr, "{}", error);
+        std::exit(EXIT_FAILURE);
+    }
+    const bool is_rotating = options.rotate_mb != 0 || options.rotate_s != 0;
 
     std::println("Starting trace collector:");
     std::println("  Pipe: {}", pipe_path);
-    std::println("  Output: {}", output_file);
+    std::println("  Output: {}{}", options.write_events ? output_file : "none",
+        !options.write_events ? "" : options.chunk_kb != 0 ? " (chunk store)" : options.is_ordered ? " (ordered by timestamp)" : "");
+    if (options.write_events && is_rotating) {
+        std::println("  Segments: {} every {} MB / {} s (0 = no limit), keeping {} segments / {} MB (0 = all)",
+            SegmentWriter::segment_path(output_file, 1), options.rotate_mb, options.rotate_s, options.keep_segments, options.keep_mb);
+    }
+    if (!options.summary_file.empty()) {
+        std::println("  Summary: {} every {} ms", options.summary_file, options.snapshot_interval_ms);
+    }
+    if (!options.columnar_file.empty()) {
+        std::println("  Columnar: {}", options.columnar_file);
+    }
+    if (!options.control_pipe.empty()) {
+        std::println("  Control: {}, tracing {}", options.control_pipe, options.is_tracing ? "on" : "off");
+    }
 
     // Initialize server
     IPC::PipeServer server { pipe_path };
@@ -18,7 +74,7 @@ int main(int argc, char** argv)
         std::exit(EXIT_FAILURE);
     }
 
-    run(server, output_file);
+    run(server, options);
 
     return 0;
 }
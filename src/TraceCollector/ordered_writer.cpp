@@ -0,0 +1,149 @@
+#include "ordered_writer.hpp"
+
+#include <Analysis/self_time.hpp>
+#include <Analysis/trace_merge.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <print>
+#include <stdexcept>
+
+void OrderedWriter::EventFile::open(const std::string& path, bool use_uring)
+{
+    out = std::make_unique<UringWriter>(path, use_uring);
+    if (!out->is_open()) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    if (use_uring && !out->is_uring()) {
+        std::println(stderr, "io_uring is not available, writing {} with pwrite", path);
+    }
+    out->write(Tracer::TRACE_EVENTS);
+}
+
+void OrderedWriter::EventFile::write(std::string_view json)
+{
+    out->write(events++ == 0 ? "\n" : ",\n");
+    out->write(json);
+}
+
+void OrderedWriter::EventFile::close()
+{
+    out->write("\n");
+    out->write(Tracer::TRACE_EVENT_BODY);
+    out->close();
+}
+
+OrderedWriter::OrderedWriter(std::string_view output_file, int64_t window_us, size_t max_buffered, size_t chunk_size, bool use_uring)
+    : m_output_file(output_file)
+    , m_window_us(window_us)
+    , m_max_buffered(max_buffered)
+    , m_use_uring(use_uring)
+{
+    if (chunk_size != 0) {
+        m_store = std::make_unique<Analysis::ChunkStoreWriter>(m_output_file, chunk_size);
+    } else {
+        m_output.open(m_output_file, m_use_uring);
+    }
+}
+
+void OrderedWriter::add_batch(uint64_t sequence, std::span<const EventRecord> events)
+{
+    auto lock = m_sequencer.enter(sequence);
+    for (const EventRecord& event : events) {
+        add(event);
+    }
+    write_until(watermark());
+    m_sequencer.leave(lock);
+}
+
+void OrderedWriter::add(const EventRecord& event)
+{
+    const int64_t end = event.ph == 'X' ? event.ts + event.dur : event.ts;
+    const uint64_t thread_key = Analysis::SelfTimeTracker::thread_key(event.pid, event.tid);
+    int64_t& stream_end = m_stream_end[thread_key];
+    stream_end = std::max(stream_end, end);
+    m_newest_end = std::max(m_newest_end, end);
+
+    std::string json;
+    append_json(json, event);
+    if (event.ts < m_last_written && m_store) {
+        m_store->write_late(event.ts, end, thread_key, json);
+        return;
+    }
+    if (event.ts < m_last_written) {
+        if (m_late.events == 0) {
+            m_late.open(m_output_file + ".late", m_use_uring);
+        }
+        m_late.write(json);
+        return;
+    }
+    m_pending.push({ event.ts, m_next_order++, end, thread_key, std::move(json) });
+
+    while (m_pending.size() > m_max_buffered) {
+        write_until(m_pending.top().ts);
+    }
+}
+
+int64_t OrderedWriter::watermark()
+{
+    // The slowest active stream may still deliver scopes that started up to a window before its end
+    const int64_t idle_before = m_newest_end - m_window_us;
+    int64_t slowest_end = m_newest_end;
+    std::erase_if(m_stream_end, [&](const auto& stream) {
+        if (stream.second < idle_before) {
+            return true;
+        }
+        slowest_end = std::min(slowest_end, stream.second);
+        return false;
+    });
+    return slowest_end - m_window_us;
+}
+
+void OrderedWriter::write_until(int64_t watermark)
+{
+    while (!m_pending.empty() && m_pending.top().ts <= watermark) {
+        const Pending& pending = m_pending.top();
+        m_last_written = pending.ts;
+        if (m_store) {
+            m_store->write(pending.ts, pending.end, pending.thread_key, pending.json);
+        } else {
+            m_output.write(pending.json);
+        }
+        m_pending.pop();
+    }
+}
+
+void OrderedWriter::finish(uint64_t sequence)
+{
+    const auto lock = m_sequencer.wait_for(sequence);
+    write_until(INT64_MAX);
+    if (m_store) {
+        m_store->close();
+        std::println("Wrote {} chunks to {}", m_store->chunk_count(), m_output_file);
+        return;
+    }
+    m_output.close();
+    if (m_late.events != 0) {
+        merge_late_events();
+    }
+}
+
+void OrderedWriter::merge_late_events()
+{
+    m_late.close();
+    const std::string late_file = m_output_file + ".late";
+    const std::string ordered_file = m_output_file + ".ordered";
+    std::filesystem::rename(m_output_file, ordered_file);
+
+    const std::filesystem::path directory = std::filesystem::absolute(m_output_file).parent_path();
+    const Analysis::MergeResult result = Analysis::merge_traces({
+        { ordered_file, late_file },
+        m_output_file,
+        directory.string(),
+        1,
+        m_max_buffered,
+    });
+    std::filesystem::remove(ordered_file);
+    std::filesystem::remove(late_file);
+    std::println("Merged {} events started before the reorder window, {} events in total", m_late.events, result.events);
+}
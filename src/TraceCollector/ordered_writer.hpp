@@ -0,0 +1,83 @@
+#pragma once
+
+#include "event_batch.hpp"
+#include "sequencer.hpp"
+#include "uring_writer.hpp"
+
+#include <Analysis/chunk_store.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// @brief Writes the collected events ordered by timestamp.
+///
+/// Every (pid, tid) stream delivers its events in the order they end. Events wait in a heap until
+/// every active stream has moved `window` past them, then they are written in `ts` order. Streams
+/// that fell more than `window` behind the newest one are considered idle. A scope longer than the
+/// window can still start before events already written; such late events go to a side file, and
+/// at shutdown both files are merged with the spilling k-way merge of trace_merge. The heap holds at
+/// most `max_buffered` events, past that the oldest are written early.
+///
+/// With a `chunk_size`, the output is a chunk store instead of JSON. Late events then go to chunks
+/// of their own in the store, the index finds them without a merge.
+class OrderedWriter {
+public:
+    /// @brief `use_uring` writes JSON output through io_uring where the kernel allows it
+    OrderedWriter(std::string_view output_file, int64_t window_us, size_t max_buffered, size_t chunk_size = 0, bool use_uring = false);
+
+    /// @brief Buffer a batch of events. Batches are applied in sequence order whatever thread
+    /// brings them, which keeps every stream in the order it was sent.
+    void add_batch(uint64_t sequence, std::span<const EventRecord> events);
+
+    /// @brief Wait until every batch before `sequence` was applied, then write everything out
+    void finish(uint64_t sequence);
+
+private:
+    struct Pending {
+        int64_t ts;
+        uint64_t order;
+        int64_t end;
+        uint64_t thread_key;
+        std::string json;
+
+        bool operator>(const Pending& other) const { return ts != other.ts ? ts > other.ts : order > other.order; }
+    };
+
+    /// @brief A JSON array of events written one per line
+    struct EventFile {
+        std::unique_ptr<UringWriter> out;
+        uint64_t events { 0 };
+
+        void open(const std::string& path, bool use_uring);
+        void write(std::string_view json);
+        void close();
+    };
+
+    void add(const EventRecord& event);
+    int64_t watermark();
+    void write_until(int64_t watermark);
+    void merge_late_events();
+
+    Sequencer m_sequencer;
+
+    std::string m_output_file;
+    int64_t m_window_us;
+    size_t m_max_buffered;
+    bool m_use_uring;
+
+    std::priority_queue<Pending, std::vector<Pending>, std::greater<>> m_pending;
+    uint64_t m_next_order { 0 };
+    std::unordered_map<uint64_t, int64_t> m_stream_end;
+    int64_t m_newest_end { INT64_MIN };
+    int64_t m_last_written { INT64_MIN };
+
+    EventFile m_output;
+    EventFile m_late;
+    std::unique_ptr<Analysis::ChunkStoreWriter> m_store;
+};
@@ -0,0 +1,166 @@
+#include "segment_writer.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <print>
+#include <stdexcept>
+
+void SegmentWriter::Segment::write(const std::string& text)
+{
+    if (gzip) {
+        gzip->write(text);
+    } else {
+        out->write(text);
+    }
+    bytes += text.size();
+}
+
+SegmentWriter::SegmentWriter(Options options)
+    : m_options(std::move(options))
+{
+    if (m_options.output_file.ends_with(".gz") && !Tracer::GzipWriter::is_supported()) {
+        throw std::runtime_error("Gzip segments require the collector to be built with zlib");
+    }
+    open_segment();
+    if (m_options.max_age.count() != 0) {
+        m_timer = std::jthread([this](std::stop_token stop) { run_timer(std::move(stop)); });
+    }
+}
+
+std::string SegmentWriter::segment_path(std::string_view output_file, uint64_t index)
+{
+    // The number goes before the extensions of the file name, trace.json.gz -> trace.000001.json.gz
+    const size_t name_start = output_file.find_last_of('/') + 1;
+    size_t extension = output_file.find('.', name_start);
+    if (extension == std::string_view::npos || extension == name_start) {
+        extension = output_file.size();
+    }
+    return std::format("{}.{:06}{}", output_file.substr(0, extension), index, output_file.substr(extension));
+}
+
+void SegmentWriter::open_segment()
+{
+    auto segment = std::make_unique<Segment>();
+    segment->path = is_rotating() ? segment_path(m_options.output_file, m_next_index) : m_options.output_file;
+    ++m_next_index;
+    if (m_options.output_file.ends_with(".gz")) {
+        segment->gzip = std::make_unique<Tracer::GzipWriter>(segment->path);
+    } else {
+        segment->out = std::make_unique<UringWriter>(segment->path, m_options.use_uring);
+    }
+    if (segment->gzip ? !segment->gzip->is_open() : !segment->out->is_open()) {
+        throw std::runtime_error("Failed to open segment " + segment->path);
+    }
+    if (m_next_index == 2 && m_options.use_uring && segment->out && !segment->out->is_uring()) {
+        std::println(stderr, "io_uring is not available, writing segments with pwrite");
+    }
+    segment->write(Tracer::TRACE_EVENTS);
+    segment->opened = std::chrono::steady_clock::now();
+    m_segment = std::move(segment);
+}
+
+void SegmentWriter::add_batch(uint64_t sequence, std::span<const EventRecord> events)
+{
+    auto lock = m_sequencer.enter(sequence);
+    for (const EventRecord& event : events) {
+        m_json = m_segment->events++ == 0 ? "\n" : ",\n";
+        append_json(m_json, event);
+        m_segment->write(m_json);
+        if (m_options.max_bytes != 0 && m_segment->bytes >= m_options.max_bytes) {
+            rotate();
+        }
+    }
+    if (is_old()) {
+        rotate();
+    }
+    m_sequencer.leave(lock);
+}
+
+bool SegmentWriter::is_old() const
+{
+    return m_options.max_age.count() != 0 && m_segment->events != 0
+        && std::chrono::steady_clock::now() - m_segment->opened >= m_options.max_age;
+}
+
+void SegmentWriter::run_timer(std::stop_token stop)
+{
+    // A segment is rotated at most a second late, or a fraction of its age for short ones
+    const auto period = std::min<std::chrono::milliseconds>(m_options.max_age, std::chrono::seconds(4)) / 4;
+    std::unique_lock lock(m_timer_lock);
+    while (!m_timer_wakeup.wait_for(lock, stop, period, [] { return false; }) && !stop.stop_requested()) {
+        // Between two batches, so a segment never ends with half of one
+        const auto sequence_lock = m_sequencer.lock();
+        if (is_old()) {
+            rotate();
+        }
+    }
+}
+
+void SegmentWriter::rotate()
+{
+    std::unique_ptr<Segment> full = std::move(m_segment);
+    open_segment();
+    // Only waits if the previous seal is still running after a whole segment was written
+    if (m_sealing.valid()) {
+        m_sealing.get();
+    }
+    m_sealing = std::async(std::launch::async, [this, segment = std::move(full)]() mutable { seal(std::move(segment)); });
+}
+
+void SegmentWriter::seal(std::unique_ptr<Segment> segment)
+{
+    segment->write(std::string("\n") + Tracer::TRACE_EVENT_BODY);
+    try {
+        if (segment->gzip) {
+            segment->gzip->close();
+        } else {
+            segment->out->close();
+        }
+    } catch (const std::exception& error) {
+        std::println(stderr, "Failed to seal segment {}: {}", segment->path, error.what());
+    }
+    std::error_code error;
+    const uint64_t size = std::filesystem::file_size(segment->path, error);
+    m_sealed.push_back({ segment->path, error ? 0 : size });
+    m_sealed_bytes += m_sealed.back().size;
+    prune();
+}
+
+void SegmentWriter::prune()
+{
+    const auto is_over = [&]() {
+        return (m_options.keep_segments != 0 && m_sealed.size() > m_options.keep_segments)
+            || (m_options.keep_bytes != 0 && m_sealed_bytes > m_options.keep_bytes);
+    };
+    // The newest sealed segment is always kept
+    while (m_sealed.size() > 1 && is_over()) {
+        std::error_code error;
+        std::filesystem::remove(m_sealed.front().path, error);
+        if (error) {
+            std::println(stderr, "Failed to remove segment {}: {}", m_sealed.front().path, error.message());
+        }
+        m_sealed_bytes -= m_sealed.front().size;
+        m_sealed.pop_front();
+    }
+}
+
+void SegmentWriter::finish(uint64_t sequence)
+{
+    if (m_timer.joinable()) {
+        m_timer.request_stop();
+        m_timer.join();
+    }
+    const auto lock = m_sequencer.wait_for(sequence);
+    if (m_sealing.valid()) {
+        m_sealing.get();
+    }
+    const std::string last_path = m_segment->path;
+    const uint64_t last_events = m_segment->events;
+    seal(std::move(m_segment));
+    if (!is_rotating()) {
+        std::println("Wrote {} events to {}", last_events, last_path);
+        return;
+    }
+    std::println("Wrote {} segments, kept {} up to {}", m_next_index - 1, m_sealed.size(), last_path);
+}
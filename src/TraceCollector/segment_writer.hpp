@@ -0,0 +1,99 @@
+#pragma once
+
+#include "event_batch.hpp"
+#include "sequencer.hpp"
+#include "uring_writer.hpp"
+
+#include <Profiler/exporters/gzip_writer.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+
+/// @brief Writes the collected events to a series of rotating trace files.
+///
+/// Each segment is a complete trace with its own header and footer, named after the output file
+/// with a sequence number: trace.json becomes trace.000001.json, trace.000002.json and so on. A new
+/// segment starts once the current one holds `max_bytes` of events or is `max_age` old; either
+/// limit may be 0 to disable it. Sealing the full segment (footer, gzip flush, close) and pruning
+/// old ones run on a background task while the next segment already takes events, so rotation
+/// never waits for the disk. With `max_age`, a timer also rotates a segment that aged while no
+/// batches arrived, so the events it holds become a loadable trace without waiting for more. Sealed segments beyond `keep_segments` or `keep_bytes` of total size
+/// are deleted, oldest first.
+///
+/// Without either limit there's a single segment, written to the output file itself.
+class SegmentWriter {
+public:
+    struct Options {
+        std::string output_file;
+        uint64_t max_bytes;
+        std::chrono::seconds max_age;
+        size_t keep_segments;
+        uint64_t keep_bytes;
+
+        /// @var use_uring Write uncompressed segments through io_uring where the kernel allows it
+        bool use_uring;
+    };
+
+    explicit SegmentWriter(Options options);
+
+    void add_batch(uint64_t sequence, std::span<const EventRecord> events);
+
+    /// @brief Wait until every batch before `sequence` was applied, then seal the last segment
+    void finish(uint64_t sequence);
+
+    /// @brief Path of segment `index`, numbered from 1
+    static std::string segment_path(std::string_view output_file, uint64_t index);
+
+private:
+    struct Segment {
+        std::string path;
+        std::unique_ptr<UringWriter> out;
+        std::unique_ptr<Tracer::GzipWriter> gzip;
+        uint64_t bytes { 0 };
+        uint64_t events { 0 };
+        std::chrono::steady_clock::time_point opened;
+
+        void write(const std::string& text);
+    };
+
+    struct Sealed {
+        std::string path;
+        uint64_t size;
+    };
+
+    bool is_rotating() const { return m_options.max_bytes != 0 || m_options.max_age.count() != 0; }
+    bool is_old() const;
+    void open_segment();
+    void rotate();
+    void seal(std::unique_ptr<Segment> segment);
+    void prune();
+    void run_timer(std::stop_token stop);
+
+    Sequencer m_sequencer;
+    Options m_options;
+    uint64_t m_next_index { 1 };
+    std::unique_ptr<Segment> m_segment;
+
+    /// @var m_json Serialized event, reused across events
+    std::string m_json;
+
+    /// @var m_sealing Background seal of the previous segment, the only task touching m_sealed
+    std::future<void> m_sealing;
+    std::deque<Sealed> m_sealed;
+    uint64_t m_sealed_bytes { 0 };
+
+    std::mutex m_timer_lock;
+    std::condition_variable_any m_timer_wakeup;
+    /// @var m_timer Last member, so it's stopped before anything it reads is destroyed
+    std::jthread m_timer;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+/// @brief Lets batches handled by concurrent flush threads through one at a time, in sequence order
+class Sequencer {
+public:
+    /// @brief Block until every batch before `sequence` went through, the lock is held for this one
+    std::unique_lock<std::mutex> enter(uint64_t sequence)
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_turn.wait(lock, [&] { return m_next_sequence == sequence; });
+        return lock;
+    }
+
+    /// @brief Let the next batch in
+    void leave(std::unique_lock<std::mutex>& lock)
+    {
+        ++m_next_sequence;
+        lock.unlock();
+        m_turn.notify_all();
+    }
+
+    /// @brief Hold off batches between two turns, without waiting for a sequence
+    std::unique_lock<std::mutex> lock() { return std::unique_lock<std::mutex>(m_lock); }
+
+    /// @brief Block until every batch before `sequence` went through, without taking a turn
+    std::unique_lock<std::mutex> wait_for(uint64_t sequence)
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_turn.wait(lock, [&] { return m_next_sequence >= sequence; });
+        return lock;
+    }
+
+private:
+    std::mutex m_lock;
+    std::condition_variable m_turn;
+    uint64_t m_next_sequence { 0 };
+};
@@ -0,0 +1,89 @@
+#include "session.hpp"
+
+#include <print>
+#include <span>
+#include <string>
+#include <utility>
+
+Session::Session(const ArgsOpts& options, bool use_exporter)
+{
+    if (!options.summary_file.empty()) {
+        m_aggregator = std::make_unique<Aggregator>(options.summary_file,
+            std::chrono::milliseconds(options.snapshot_interval_ms), options.max_keys, options.top_k);
+    }
+    if (options.write_events && options.is_ordered) {
+        m_ordered_writer = std::make_unique<OrderedWriter>(options.output_file,
+            static_cast<int64_t>(options.reorder_window_ms) * 1000, options.reorder_max_events, options.chunk_kb * 1024, options.use_uring);
+    }
+    const bool is_rotating = options.rotate_mb != 0 || options.rotate_s != 0;
+    const bool use_segments = is_rotating || !use_exporter;
+    if (options.write_events && !options.is_ordered && use_segments) {
+        m_segment_writer = std::make_unique<SegmentWriter>(SegmentWriter::Options {
+            options.output_file,
+            uint64_t { options.rotate_mb } << 20,
+            std::chrono::seconds(options.rotate_s),
+            options.keep_segments,
+            uint64_t { options.keep_mb } << 20,
+            options.use_uring,
+        });
+    }
+    if (!options.columnar_file.empty()) {
+        m_column_writer = std::make_unique<ColumnWriter>(options.columnar_file);
+    }
+    m_sinks = {
+        options.write_events && !options.is_ordered && !use_segments ? &Tracer::FileExporter::instance(options.output_file.c_str()) : nullptr,
+        m_ordered_writer.get(),
+        m_segment_writer.get(),
+        m_aggregator.get(),
+        m_column_writer.get(),
+    };
+}
+
+void Session::flush(std::unique_ptr<EventBatch> batch, uint64_t sequence) const
+{
+    batch->decode();
+    m_flow_stitcher->stitch(sequence, *batch);
+    const std::span<const EventRecord> events = batch->events();
+
+    if (m_sinks.exporter != nullptr) {
+        std::string json;
+        for (const auto& event : events) {
+            json.clear();
+            append_json(json, event);
+            m_sinks.exporter->push_json(json);
+        }
+    }
+    if (m_sinks.ordered_writer != nullptr) {
+        m_sinks.ordered_writer->add_batch(sequence, events);
+    }
+    if (m_sinks.segment_writer != nullptr) {
+        m_sinks.segment_writer->add_batch(sequence, events);
+    }
+    if (m_sinks.aggregator != nullptr) {
+        m_sinks.aggregator->add_batch(sequence, events);
+    }
+    if (m_sinks.column_writer != nullptr) {
+        m_sinks.column_writer->add_batch(sequence, events);
+    }
+}
+
+void Session::finish(uint64_t sequence)
+{
+    const FlowStitcher::Stats flows = m_flow_stitcher->finish(sequence);
+    if (flows.stitched != 0 || flows.unmatched != 0) {
+        std::println("Stitched {} flows across processes ({} for repeated imports), dropped {} flow ends without a start",
+            flows.stitched + flows.fanned_out, flows.fanned_out, flows.unmatched);
+    }
+    if (m_ordered_writer) {
+        m_ordered_writer->finish(sequence);
+    }
+    if (m_segment_writer) {
+        m_segment_writer->finish(sequence);
+    }
+    if (m_aggregator) {
+        m_aggregator->finish(sequence);
+    }
+    if (m_column_writer) {
+        m_column_writer->finish(sequence);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "aggregator.hpp"
+#include "args.hpp"
+#include "column_writer.hpp"
+#include "event_batch.hpp"
+#include "flow_stitcher.hpp"
+#include "ordered_writer.hpp"
+#include "segment_writer.hpp"
+
+#include <Profiler/exporters/file_exporter.hpp>
+
+#include <cstdint>
+#include <memory>
+
+/// @brief Where decoded events go. Any may be missing, events are written by one of the exporter,
+/// the ordered writer or the segment writer.
+struct EventSinks {
+    Tracer::FileExporter* exporter;
+    OrderedWriter* ordered_writer;
+    SegmentWriter* segment_writer;
+    Aggregator* aggregator;
+    ColumnWriter* column_writer;
+};
+
+/// @brief The outputs of one stream of events, as configured by the collector options.
+///
+/// Flows between the processes of the stream are stitched before the events reach the outputs.
+///
+/// Plain JSON output goes through the process-wide FileExporter when `use_exporter` is set, the
+/// collector's single-session mode. Sessions of a daemon can't share it and write plain output
+/// with an unrotated SegmentWriter.
+class Session {
+public:
+    Session(const ArgsOpts& options, bool use_exporter);
+
+    /// @brief Decode a batch and hand it to the sinks, after the batches before `sequence`
+    void flush(std::unique_ptr<EventBatch> batch, uint64_t sequence) const;
+
+    /// @brief Wait until every batch before `sequence` was applied, then close the outputs
+    void finish(uint64_t sequence);
+
+private:
+    std::unique_ptr<Aggregator> m_aggregator;
+    std::unique_ptr<OrderedWriter> m_ordered_writer;
+    std::unique_ptr<SegmentWriter> m_segment_writer;
+    std::unique_ptr<ColumnWriter> m_column_writer;
+    std::unique_ptr<FlowStitcher> m_flow_stitcher { std::make_unique<FlowStitcher>() };
+    EventSinks m_sinks {};
+};
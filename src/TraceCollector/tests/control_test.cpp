@@ -0,0 +1,243 @@
+#include "../control_channel.hpp"
+#include "../event_batch.hpp"
+
+#include <IPC/pipe_reader.hpp>
+#include <Profiler/control.hpp>
+#include <Profiler/trace.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+#include <print>
+#include <string>
+#include <thread>
+#include <sys/stat.h> // mkfifo
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+const std::string DIRECTORY = "/tmp/control_test";
+
+/// @brief Events and control pipes a client sent, read until `done` returns true
+struct Received {
+    std::vector<std::string> names;
+    std::vector<std::string> hellos;
+};
+
+template <class Done>
+bool receive(IPC::PipeReader& reader, Received& received, Done done)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!done(received)) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        const size_t count = reader.read([&](const IPC::Message& msg) {
+            if (msg.kind == IPC::MessageKind::HELLO) {
+                received.hellos.push_back(msg.body);
+                return;
+            }
+            std::pmr::monotonic_buffer_resource strings;
+            EventRecord event;
+            if (decode_event(msg.body, strings, event)) {
+                received.names.emplace_back(event.name);
+            }
+        });
+        if (count == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    return true;
+}
+
+/// @brief Wait until the client's listener applied the last command
+template <class Condition>
+bool wait_for(Condition condition)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/// @brief Take a snapshot and collect the event names up to its marker
+bool snapshot(ControlChannel& control, IPC::PipeReader& reader, std::vector<std::string>& names)
+{
+    Received received;
+    std::ignore = control.execute("snapshot");
+    if (!receive(reader, received, [](const Received& r) { return !r.names.empty() && r.names.back() == "snapshot"; })) {
+        return false;
+    }
+    received.names.pop_back();
+    names = std::move(received.names);
+    return true;
+}
+
+void trace(const char* name, const char* cat, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        Tracer::TraceScope<Tracer::IPCExporter> scope(name, cat);
+    }
+}
+} // namespace
+
+int main(int /* argc */, char* /* argv */[])
+{
+    std::filesystem::remove_all(DIRECTORY);
+    std::filesystem::create_directories(DIRECTORY);
+    const std::string pipe = DIRECTORY + "/trace.pipe";
+
+    std::println("1. Parsing state records...");
+    {
+        Tracer::Control& state = Tracer::Control::instance();
+        // Snapshots are numbered by the collector, the channel below starts at 1
+        if (state.apply("tracing=on categories=* sample=1 snapshot=0") || !Tracer::Control::allows("io")) {
+            std::println(stderr, "The initial state was misread");
+            return 1;
+        }
+        state.apply("categories=io,db unknown=1");
+        if (!Tracer::Control::allows("io") || !Tracer::Control::allows("net,db") || Tracer::Control::allows("net")) {
+            std::println(stderr, "Categories weren't matched");
+            return 1;
+        }
+        state.apply("categories=* sample=4");
+        int sampled = 0;
+        for (int i = 0; i < 100; ++i) {
+            sampled += Tracer::Control::samples("io") ? 1 : 0;
+        }
+        if (sampled != 25 || !Tracer::Control::allows("io")) {
+            std::println(stderr, "Sampling kept {} scopes of 100 at one in 4", sampled);
+            return 1;
+        }
+        state.apply("tracing=off sample=1");
+        if (Tracer::Control::allows("io") || state.is_enabled()) {
+            std::println(stderr, "Stopped tracing still allows events");
+            return 1;
+        }
+        state.apply("tracing=on");
+    }
+
+    std::println("2. Checking commands...");
+    // Outlives the exporter, which writes its STOP on exit
+    static IPC::PipeReader reader(pipe);
+    ControlChannel control(DIRECTORY + "/ctl.fifo", true);
+    if (!reader.init() || !control.init()) {
+        return 1;
+    }
+    for (const char* command : { "", "sample 0", "sample", "categories", "start now", "pid=x stop", "restart" }) {
+        if (control.execute(command).empty()) {
+            std::println(stderr, "Accepted invalid command '{}'", command);
+            return 1;
+        }
+    }
+
+    std::println("3. Connecting a client...");
+    Tracer::IPCExporter& exporter = Tracer::IPCExporter::instance(pipe.c_str());
+    if (!exporter.control_path().empty()) {
+        std::println(stderr, "The client opened a control pipe without being asked to");
+        return 1;
+    }
+    exporter.enable_control();
+    Received hello;
+    if (!receive(reader, hello, [](const Received& r) { return !r.hellos.empty(); }) || hello.hellos.front() != exporter.control_path()) {
+        std::println(stderr, "The client didn't announce its control pipe");
+        return 1;
+    }
+    control.add_client(getpid(), hello.hellos.front());
+    if (control.client_count() != 1) {
+        return 1;
+    }
+
+    std::println("4. Filtering categories...");
+    std::ignore = control.execute("categories io");
+    if (!wait_for([] { return !Tracer::Control::allows("db"); })) {
+        std::println(stderr, "The client didn't apply the categories");
+        return 1;
+    }
+    trace("read", "io", 3);
+    trace("query", "db", 3);
+    std::vector<std::string> names;
+    if (!snapshot(control, reader, names) || names != std::vector<std::string>(3, "read")) {
+        std::println(stderr, "Expected 3 io scopes, got {}", names.size());
+        return 1;
+    }
+
+    std::println("5. Sampling and stopping...");
+    std::ignore = control.execute("categories *");
+    std::ignore = control.execute("sample 10");
+    if (!wait_for([] { return Tracer::Control::instance().sample_one_in() == 10; })) {
+        return 1;
+    }
+    trace("step", "io", 100);
+    if (!snapshot(control, reader, names) || names.size() != 10) {
+        std::println(stderr, "Expected 10 sampled scopes, got {}", names.size());
+        return 1;
+    }
+    std::ignore = control.execute(std::format("stop pid={}", getpid()));
+    if (!wait_for([] { return !Tracer::Control::instance().is_enabled(); }) || !control.state(getpid() + 1).is_enabled) {
+        std::println(stderr, "The pid override wasn't applied to this client only");
+        return 1;
+    }
+    trace("step", "io", 100);
+    Tracer::write_async_event<Tracer::IPCExporter>('n', "mark", "io", 1);
+    if (!snapshot(control, reader, names) || !names.empty()) {
+        std::println(stderr, "A stopped client sent {} events", names.size());
+        return 1;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    trace("step", "io", 1'000'000);
+    const auto stopped_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    std::println("   A scope of a stopped client costs {:.1f} ns", static_cast<double>(stopped_ns) / 1e6);
+    std::ignore = control.execute("start");
+    if (!wait_for([] { return Tracer::Control::instance().is_enabled(); })) {
+        return 1;
+    }
+
+    std::println("6. Dropping clients that went away...");
+    const std::string gone = DIRECTORY + "/gone.ctl";
+    mkfifo(gone.c_str(), 0666);
+    control.add_client(getpid() + 1, gone);
+    if (control.client_count() != 1) {
+        std::println(stderr, "A pipe without a reader was added");
+        return 1;
+    }
+    const std::string file = DIRECTORY + "/not_a_fifo";
+    std::ofstream(file) << "untouched";
+    control.add_client(getpid() + 2, file);
+    if (control.client_count() != 1 || std::filesystem::file_size(file) != 9) {
+        std::println(stderr, "A HELLO naming a regular file was accepted");
+        return 1;
+    }
+    if (struct stat info {}; stat(exporter.control_path().c_str(), &info) != 0 || (info.st_mode & 0777) != 0600) {
+        std::println(stderr, "Other users may write to the control pipe");
+        return 1;
+    }
+
+    std::println("7. Forking a controlled client...");
+    const pid_t child = fork();
+    if (child == 0) {
+        // The child opens its channel with its first event, scopes are sampled one in 10
+        const bool had_channel = !exporter.control_path().empty();
+        trace("child", "io", 10);
+        _exit(had_channel || exporter.control_path().empty() ? 1 : 0);
+    }
+    const std::string child_path = std::format("{}.{}.ctl", pipe, child);
+    Received child_hello;
+    int status = 0;
+    if (!receive(reader, child_hello, [&](const Received& r) { return std::ranges::find(r.hellos, child_path) != r.hellos.end(); })
+        || waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::println(stderr, "The forked child didn't open a control pipe of its own");
+        return 1;
+    }
+
+    std::println("All control tests passed");
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "../daemon.hpp"
+
+#include <Analysis/trace_stats.hpp>
+#include <IPC/client.hpp>
+#include <Profiler/chrome_event.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <print>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+const std::string DIRECTORY = "/tmp/daemon_test";
+
+/// @brief Send `count` complete events from a client of `pid`, then disconnect
+void send_events(const std::string& pipe, int pid, size_t count)
+{
+    IPC::PipeClient client(pipe.c_str());
+    if (!client.init()) {
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const Tracer::ChromeEvent event { "step", "test", 'X', static_cast<int64_t>(i) * 10, pid, 1, 5, 0, {} };
+        std::stringstream body;
+        body << event;
+        std::ignore = client.write_message({ IPC::MessageKind::DATA, pid, body.str() });
+    }
+    std::ignore = client.write_message({ IPC::MessageKind::STOP, pid, "" });
+}
+
+/// @brief Wait until a summary line counts all `count` events, snapshots are written while idle
+bool wait_for_snapshot(const std::string& path, size_t count)
+{
+    const std::string expected = R"("count":)" + std::to_string(count) + ',';
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        std::ifstream summary(path);
+        std::string line;
+        while (std::getline(summary, line)) {
+            if (line.starts_with(R"({"ts":)") && line.contains(expected)) {
+                return true;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return false;
+}
+
+uint64_t complete_events(const std::string& path)
+{
+    const Analysis::TraceFile file(path);
+    const Analysis::TraceStats stats = Analysis::compute_stats(file, 1);
+    return stats.malformed_events == 0 ? stats.complete_events : 0;
+}
+} // namespace
+
+int main(int /* argc */, char* /* argv */[])
+{
+    std::filesystem::remove_all(DIRECTORY);
+    std::filesystem::create_directories(DIRECTORY);
+    {
+        std::ofstream config(DIRECTORY + "/sessions");
+        config << "# name options\n"
+               << "noisy --pipe " << DIRECTORY << "/noisy.pipe --output " << DIRECTORY << "/noisy.json --budget-mb 1\n"
+               << "\n"
+               << "quiet --pipe " << DIRECTORY << "/quiet.pipe --output " << DIRECTORY << "/quiet.json --ordered"
+               << " --summary " << DIRECTORY << "/quiet.jsonl --snapshot-ms 50\n";
+    }
+    {
+        std::ofstream config(DIRECTORY + "/shared");
+        config << "a --pipe " << DIRECTORY << "/a.pipe --output " << DIRECTORY << "/a.json\n"
+               << "b --pipe " << DIRECTORY << "/b.pipe --output " << DIRECTORY << "/a.json\n";
+    }
+    try {
+        Daemon::load_sessions(DIRECTORY + "/shared");
+        std::println(stderr, "Sessions sharing an output were accepted");
+        return 1;
+    } catch (const std::runtime_error&) {
+    }
+
+    {
+        Daemon daemon(Daemon::load_sessions(DIRECTORY + "/sessions"), 2);
+        std::thread loop([&]() { daemon.run(); });
+
+        // Several clients of the noisy session against one of the quiet session
+        std::vector<std::thread> clients;
+        for (int pid = 100; pid < 104; ++pid) {
+            clients.emplace_back(send_events, DIRECTORY + "/noisy.pipe", pid, 20'000);
+        }
+        clients.emplace_back(send_events, DIRECTORY + "/quiet.pipe", 200, 500);
+        for (std::thread& client : clients) {
+            client.join();
+        }
+        const bool has_snapshot = wait_for_snapshot(DIRECTORY + "/quiet.jsonl", 500);
+        daemon.stop();
+        loop.join();
+        if (!has_snapshot) {
+            std::println(stderr, "No snapshot was written before shutdown");
+            return 1;
+        }
+    }
+
+    const uint64_t noisy = complete_events(DIRECTORY + "/noisy.json");
+    const uint64_t quiet = complete_events(DIRECTORY + "/quiet.json");
+    if (noisy != 80'000 || quiet != 500 || !std::filesystem::exists(DIRECTORY + "/quiet.jsonl")) {
+        std::println(stderr, "Wrote {} noisy and {} quiet events", noisy, quiet);
+        return 1;
+    }
+    std::filesystem::remove_all(DIRECTORY);
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include "../event_batch.hpp"
+
+#include <cmath>
+#include <print>
+#include <sstream>
+#include <string>
+#include <vector>
+
+int main(int /* argc */, char* /* argv */[])
+{
+    std::vector<Tracer::ChromeEvent> sent(5);
+    sent[0] = { "process_data", "computation", 'X', 1'718'000'000'000'123, 4321, 987654, 250, 0, {} };
+    sent[1] = { "a \"quoted\" name that is longer than the small string buffer", "io,disk", 'b', 42, 1, 2, 0, 0xbeef, {} };
+    sent[2] = { "tick", "loop", 'i', -5, 1, 2, 0, 0, {} };
+    sent[3] = { "request", "http", 'X', 100, 7, 8, 30, 0, {} };
+    Tracer::add_args(sent[3].args, "bytes", 1024, "ratio", 0.1234567, "route", "/api/v1", "nan", std::nan(""));
+    sent[4] = { "trace_context", "flow", 'f', 110, 9, 10, 0, 0x1234500000001, {} };
+    sent[4].args.add_id("trace_id", 0xbeef00000007);
+    sent[4].args.add("path", "C:\\tmp\n\x01");
+
+    EventBatch batch;
+    for (const Tracer::ChromeEvent& event : sent) {
+        std::stringstream body;
+        body << event;
+        batch.add(body.str());
+    }
+    // Truncated bodies are dropped
+    std::stringstream truncated;
+    truncated << sent[3];
+    batch.add(truncated.str().substr(0, truncated.str().size() - 3));
+    batch.add("name\ncat\nX\n");
+
+    batch.decode();
+    if (batch.events().size() != sent.size()) {
+        std::println(stderr, "Decoded {} of {} events", batch.events().size(), sent.size());
+        return 1;
+    }
+    std::string json;
+    for (size_t i = 0; i < sent.size(); ++i) {
+        json.clear();
+        append_json(json, batch.events()[i]);
+        if (json != Tracer::serialize_to_json(sent[i])) {
+            std::println(stderr, "Event {} written as\n{}\ninstead of\n{}", i, json, Tracer::serialize_to_json(sent[i]));
+            return 1;
+        }
+    }
+    if (!json.ends_with(R"("args":{"trace_id":"0000beef00000007","path":"C:\\tmp\n\u0001"}})")) {
+        std::println(stderr, "Arguments written as {}", json);
+        return 1;
+    }
+    json.clear();
+    append_json(json, batch.events()[1]);
+    if (!json.starts_with(R"({"name":"a \"quoted\" name)")) {
+        std::println(stderr, "Quotes written as {}", json);
+        return 1;
+    }
+    return 0;
+}
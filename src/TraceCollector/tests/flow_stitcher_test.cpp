@@ -0,0 +1,139 @@
+#include "../flow_stitcher.hpp"
+
+#include <Profiler/trace.hpp>
+
+#include <memory>
+#include <print>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+std::unique_ptr<EventBatch> make_batch(const std::vector<Tracer::ChromeEvent>& events)
+{
+    auto batch = std::make_unique<EventBatch>();
+    for (const Tracer::ChromeEvent& event : events) {
+        std::stringstream body;
+        body << event;
+        batch->add(body.str());
+    }
+    batch->decode();
+    return batch;
+}
+
+Tracer::ChromeEvent flow(char ph, uint64_t id, int64_t ts, int pid)
+{
+    return { "trace_context", "flow", ph, ts, pid, static_cast<size_t>(pid), 0, id, {} };
+}
+
+Tracer::ChromeEvent slice(const char* name, int64_t ts, int pid)
+{
+    return { name, "rpc", 'X', ts, pid, static_cast<size_t>(pid), 50, 0, {} };
+}
+
+/// @brief The batch's events as "<ph>:<name>:<pid>:<id>", ids of added flows as "new"
+std::vector<std::string> describe(const EventBatch& batch)
+{
+    std::vector<std::string> described;
+    for (const EventRecord& event : batch.events()) {
+        const bool is_added = (event.id >> 63) != 0;
+        described.push_back(std::format("{}:{}:{}:{}", event.ph, event.name, event.pid, is_added ? "new" : std::to_string(event.id)));
+    }
+    return described;
+}
+
+bool expect(const EventBatch& batch, const std::vector<std::string>& expected, const char* step)
+{
+    const std::vector<std::string> described = describe(batch);
+    if (described != expected) {
+        std::println(stderr, "{}: got", step);
+        for (const std::string& event : described) {
+            std::println(stderr, "  {}", event);
+        }
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+int main(int /* argc */, char* /* argv */[])
+{
+    Tracer::FileExporter::instance("/tmp/flow_stitcher_test.json");
+
+    std::println("1. Passing contexts in headers...");
+    const Tracer::TraceContext context { 0x123456789abcdef0, 0x0000303900000001 };
+    const std::string header = context.to_header();
+    const Tracer::TraceContext parsed = Tracer::TraceContext::from_header(header);
+    if (header != "123456789abcdef0-0000303900000001" || parsed.trace_id != context.trace_id || parsed.span_id != context.span_id) {
+        std::println(stderr, "Header {} didn't round trip", header);
+        return 1;
+    }
+    for (const char* invalid : { "", "123456789abcdef0_0000303900000001", "123456789abcdef0-00003039000000zz", "1-2" }) {
+        if (Tracer::TraceContext::from_header(invalid).is_valid()) {
+            std::println(stderr, "Accepted header '{}'", invalid);
+            return 1;
+        }
+    }
+    if (Tracer::current_context().is_valid()) {
+        return 1;
+    }
+    {
+        Tracer::ContextScope<Tracer::FileExporter> scope(parsed);
+        if (Tracer::current_context().span_id != parsed.span_id) {
+            std::println(stderr, "The received context isn't current");
+            return 1;
+        }
+    }
+    if (Tracer::current_context().is_valid()) {
+        std::println(stderr, "The context outlived its scope");
+        return 1;
+    }
+
+    std::println("2. Stitching flows across processes...");
+    FlowStitcher stitcher;
+
+    // The callee reports first, its end waits for the caller's start and outlives its batch
+    Tracer::ChromeEvent callee_end = flow('f', 7, 130, 2);
+    Tracer::add_args(callee_end.args, "peer", "eu-1");
+    auto callee = make_batch({ slice("handle", 120, 2), callee_end });
+    stitcher.stitch(0, *callee);
+    if (!expect(*callee, { "X:handle:2:0" }, "Held end")) {
+        return 1;
+    }
+    callee.reset();
+    auto caller = make_batch({ slice("call", 100, 1), flow('s', 7, 110, 1) });
+    stitcher.stitch(1, *caller);
+    if (!expect(*caller, { "X:call:1:0", "s:trace_context:1:7", "f:trace_context:2:7" }, "Released end")) {
+        return 1;
+    }
+    std::string json;
+    append_json(json, caller->events().back());
+    if (!json.ends_with(R"(,"id":"0x7","bp":"e","args":{"peer":"eu-1"}})")) {
+        std::println(stderr, "Flow end written as {}", json);
+        return 1;
+    }
+
+    // A retry imports the same context again, and gets a flow of its own
+    auto retry = make_batch({ flow('f', 7, 200, 3) });
+    stitcher.stitch(2, *retry);
+    if (!expect(*retry, { "f:trace_context:3:new", "s:trace_context:1:new" }, "Repeated import")
+        || retry->events()[0].id != retry->events()[1].id || retry->events()[1].ts != 110) {
+        return 1;
+    }
+
+    // A start and its end in one batch, and an end whose start never comes
+    auto local = make_batch({ flow('f', 9, 310, 4), flow('s', 9, 300, 4), flow('f', 11, 320, 4) });
+    stitcher.stitch(3, *local);
+    if (!expect(*local, { "s:trace_context:4:9", "f:trace_context:4:9" }, "Same batch")) {
+        return 1;
+    }
+
+    const FlowStitcher::Stats stats = stitcher.finish(4);
+    if (stats.stitched != 2 || stats.fanned_out != 1 || stats.unmatched != 1) {
+        std::println(stderr, "Stats: {} stitched, {} fanned out, {} unmatched", stats.stitched, stats.fanned_out, stats.unmatched);
+        return 1;
+    }
+
+    std::println("All flow tests passed");
+    return 0;
+}
@@ -80,6 +80,10 @@ void function_with_scopes()
             IPC_TRACE_SCOPE("loop_iteration");
             std::this_thread::sleep_for(std::chrono::milliseconds(5));
         }
+        for (int i = 0; i < 3; ++i) {
+            IPC_TRACE_SCOPE_ARGS("tagged_iteration", "scopes", "iteration", i);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
     }
 
     {
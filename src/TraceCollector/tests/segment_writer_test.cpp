@@ -0,0 +1,69 @@
+#include "../segment_writer.hpp"
+
+#include <Analysis/trace_stats.hpp>
+
+#include <filesystem>
+#include <print>
+#include <thread>
+
+int main(int /* argc */, char* /* argv */[])
+{
+    const std::string output = "/tmp/segment_writer_test/trace.json";
+    std::filesystem::remove_all("/tmp/segment_writer_test");
+    std::filesystem::create_directories("/tmp/segment_writer_test");
+
+    if (SegmentWriter::segment_path(output, 12) != "/tmp/segment_writer_test/trace.000012.json"
+        || SegmentWriter::segment_path("/tmp/a.b/trace", 1) != "/tmp/a.b/trace.000001") {
+        std::println(stderr, "Wrong segment names");
+        return 1;
+    }
+
+    // 4 KB segments hold a few dozen events, 750 events fill more than ten
+    SegmentWriter writer({ output, 4096, std::chrono::seconds(0), 3, 0, true });
+    uint64_t sequence = 0;
+    for (int64_t batch = 0; batch < 15; ++batch) {
+        std::vector<EventRecord> events(50);
+        for (size_t i = 0; i < events.size(); ++i) {
+            events[i] = { "step", "test", 'X', batch * 1000 + static_cast<int64_t>(i) * 10, 1, 2, 5, 0, {} };
+        }
+        writer.add_batch(sequence++, events);
+    }
+    writer.finish(sequence);
+
+    // The oldest segments were pruned, the three newest are complete traces
+    size_t segments = 0;
+    uint64_t events = 0;
+    for (const auto& entry : std::filesystem::directory_iterator("/tmp/segment_writer_test")) {
+        const Analysis::TraceFile file(entry.path().string());
+        const Analysis::TraceStats stats = Analysis::compute_stats(file, 1);
+        if (stats.malformed_events != 0 || stats.complete_events == 0) {
+            std::println(stderr, "{} is not a complete trace", entry.path().string());
+            return 1;
+        }
+        events += stats.complete_events;
+        ++segments;
+    }
+    if (segments != 3 || std::filesystem::exists(SegmentWriter::segment_path(output, 1)) || events >= 750) {
+        std::println(stderr, "Kept {} segments with {} events", segments, events);
+        return 1;
+    }
+
+    // An idle segment is sealed once it's old, without waiting for another batch
+    std::filesystem::remove_all("/tmp/segment_writer_test");
+    std::filesystem::create_directories("/tmp/segment_writer_test");
+    SegmentWriter aging({ output, 0, std::chrono::seconds(1), 0, 0, true });
+    std::vector<EventRecord> idle(5);
+    for (size_t i = 0; i < idle.size(); ++i) {
+        idle[i] = { "idle", "test", 'X', static_cast<int64_t>(i) * 10, 1, 2, 5, 0, {} };
+    }
+    aging.add_batch(0, idle);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+    const Analysis::TraceStats idle_stats = Analysis::compute_stats(Analysis::TraceFile(SegmentWriter::segment_path(output, 1)), 1);
+    if (idle_stats.malformed_events != 0 || idle_stats.complete_events != idle.size()) {
+        std::println(stderr, "Idle segment holds {} complete events", idle_stats.complete_events);
+        return 1;
+    }
+    aging.finish(1);
+    std::filesystem::remove_all("/tmp/segment_writer_test");
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include "../uring_writer.hpp"
+
+#include <fstream>
+#include <print>
+#include <sstream>
+#include <string>
+
+namespace {
+/// @brief Write pieces of varying size across many buffers and read the file back
+bool check(bool use_uring)
+{
+    const std::string path = "/tmp/uring_writer_test.json";
+    std::string expected;
+    UringWriter writer(path, use_uring);
+    if (!writer.is_open()) {
+        std::println(stderr, "Failed to open {}", path);
+        return false;
+    }
+    for (size_t i = 0; expected.size() < UringWriter::BUFFER_SIZE * (UringWriter::BUFFER_COUNT + 3) + 123; ++i) {
+        const std::string piece = std::format("{{\"index\":{},\"pad\":\"{}\"}},\n", i, std::string(i % 97, 'x'));
+        writer.write(piece);
+        expected += piece;
+    }
+    writer.close();
+
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream content;
+    content << in.rdbuf();
+    if (content.str() != expected) {
+        std::println(stderr, "File differs with io_uring {} (active: {})", use_uring, writer.is_uring());
+        return false;
+    }
+    std::println("{} bytes written, io_uring {}", expected.size(), writer.is_uring() ? "active" : "not used");
+    return true;
+}
+} // namespace
+
+int main(int /* argc */, char* /* argv */[])
+{
+    return check(true) && check(false) ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#include "../uring_writer.hpp"
+
+#include <Profiler/chrome_event.hpp>
+
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <print>
+#include <string>
+#include <vector>
+
+// Writes the same serialized events with each writer and reports the CPU time of the writing thread,
+// the part that competes with ingestion, and the total until the file is closed. Events are
+// serialized up front so that only the output path is measured.
+
+namespace {
+constexpr size_t EVENTS { 20'000'000 };
+constexpr size_t DISTINCT_EVENTS { 4096 };
+constexpr const char* PATH { "/tmp/collector_write_bench.json" };
+
+double thread_cpu_ms()
+{
+    timespec now {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<double>(now.tv_sec) * 1e3 + static_cast<double>(now.tv_nsec) / 1e6;
+}
+
+std::vector<std::string> serialize_events()
+{
+    std::vector<std::string> events;
+    Tracer::ChromeEvent event { "process_data", "computation", 'X', 0, 1234, 1234, 0, 0, {} };
+    for (size_t i = 0; i < DISTINCT_EVENTS; ++i) {
+        event.ts = 1'718'000'000'000'000 + static_cast<int64_t>(i) * 7;
+        event.dur = static_cast<int64_t>(i % 5000);
+        events.push_back(",\n" + Tracer::serialize_to_json(event));
+    }
+    return events;
+}
+
+template <class Write, class Close>
+void run(std::string_view label, const std::vector<std::string>& events, Write write, Close close)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const double cpu_start = thread_cpu_ms();
+    for (size_t i = 0; i < EVENTS; ++i) {
+        write(events[i % DISTINCT_EVENTS]);
+    }
+    close();
+    const double cpu = thread_cpu_ms() - cpu_start;
+    const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    const auto megabytes = static_cast<double>(std::filesystem::file_size(PATH)) / 1e6;
+    std::println("{:<18} {:>8.0} ms wall {:>8.0} ms thread CPU {:>8.0} MB/s", label, elapsed, cpu, megabytes / elapsed * 1e3);
+}
+} // namespace
+
+int main(int /* argc */, char* /* argv */[])
+{
+    const std::vector<std::string> events = serialize_events();
+    std::println("{} events", EVENTS);
+    {
+        std::ofstream out(PATH);
+        run("std::ofstream", events, [&](std::string_view text) { out << text; }, [&]() { out.close(); });
+    }
+    for (const bool use_uring : { false, true }) {
+        UringWriter writer(PATH, use_uring);
+        run(writer.is_uring() ? "io_uring" : "pwrite fallback", events, [&](std::string_view text) { writer.write(text); }, [&]() { writer.close(); });
+    }
+    std::filesystem::remove(PATH);
+    return 0;
+}
@@ -0,0 +1,262 @@
+#include "uring_writer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+constexpr size_t PAGE_SIZE { 4096 };
+
+int io_uring_setup(unsigned entries, io_uring_params* params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int ring_fd, unsigned opcode, const void* arg, unsigned count)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, count));
+}
+
+/// @brief The kernel reads and writes the ring indices concurrently
+unsigned load_acquire(unsigned* value)
+{
+    return std::atomic_ref<unsigned>(*value).load(std::memory_order_acquire);
+}
+
+void store_release(unsigned* value, unsigned next)
+{
+    std::atomic_ref<unsigned>(*value).store(next, std::memory_order_release);
+}
+} // namespace
+
+/// @brief Submission and completion queues shared with the kernel
+struct UringWriter::Ring {
+    void* ring_memory { MAP_FAILED };
+    size_t ring_size { 0 };
+    io_uring_sqe* sqes { static_cast<io_uring_sqe*>(MAP_FAILED) };
+    size_t sqes_size { 0 };
+
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    io_uring_cqe* cqes;
+};
+
+UringWriter::UringWriter(const std::string& path, bool use_uring)
+    : m_fd(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644))
+    , m_lengths(BUFFER_COUNT, 0)
+    , m_offsets(BUFFER_COUNT, 0)
+{
+    for (size_t i = 0; i < BUFFER_COUNT; ++i) {
+        m_buffers.push_back(static_cast<char*>(std::aligned_alloc(PAGE_SIZE, BUFFER_SIZE)));
+        if (m_buffers.back() == nullptr) {
+            throw std::bad_alloc();
+        }
+        m_free.push_back(BUFFER_COUNT - 1 - i);
+    }
+    m_current = m_free.back();
+    m_free.pop_back();
+
+    if (m_fd >= 0 && use_uring && !setup_ring()) {
+        teardown_ring();
+    }
+}
+
+UringWriter::~UringWriter()
+{
+    if (m_fd >= 0) {
+        try {
+            close();
+        } catch (const std::exception&) {
+            // Errors are reported by an explicit close()
+        }
+    }
+    teardown_ring();
+    for (char* buffer : m_buffers) {
+        std::free(buffer);
+    }
+}
+
+bool UringWriter::setup_ring()
+{
+    io_uring_params params {};
+    m_ring_fd = io_uring_setup(BUFFER_COUNT, &params);
+    if (m_ring_fd < 0 || (params.features & IORING_FEAT_SINGLE_MMAP) == 0) {
+        return false;
+    }
+    m_ring = new Ring {};
+
+    // One mapping holds both queues with IORING_FEAT_SINGLE_MMAP, kernels since 5.4
+    m_ring->ring_size = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    m_ring->ring_memory = mmap(nullptr, m_ring->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+    m_ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    m_ring->sqes = static_cast<io_uring_sqe*>(mmap(nullptr, m_ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES));
+    if (m_ring->ring_memory == MAP_FAILED || m_ring->sqes == MAP_FAILED) {
+        return false;
+    }
+
+    char* ring = static_cast<char*>(m_ring->ring_memory);
+    m_ring->sq_tail = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+    m_ring->sq_mask = reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+    m_ring->sq_array = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+    m_ring->cq_head = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+    m_ring->cq_tail = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+    m_ring->cq_mask = reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+    m_ring->cqes = reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+
+    // Registered buffers are pinned once instead of being mapped for every write
+    std::vector<iovec> buffers;
+    for (char* buffer : m_buffers) {
+        buffers.push_back({ buffer, BUFFER_SIZE });
+    }
+    return io_uring_register(m_ring_fd, IORING_REGISTER_BUFFERS, buffers.data(), static_cast<unsigned>(buffers.size())) == 0;
+}
+
+void UringWriter::teardown_ring()
+{
+    if (m_ring != nullptr) {
+        if (m_ring->sqes != MAP_FAILED) {
+            munmap(m_ring->sqes, m_ring->sqes_size);
+        }
+        if (m_ring->ring_memory != MAP_FAILED) {
+            munmap(m_ring->ring_memory, m_ring->ring_size);
+        }
+        delete m_ring;
+        m_ring = nullptr;
+    }
+    if (m_ring_fd >= 0) {
+        ::close(m_ring_fd);
+        m_ring_fd = -1;
+    }
+}
+
+void UringWriter::write(std::string_view text)
+{
+    while (!text.empty()) {
+        const size_t count = std::min(text.size(), BUFFER_SIZE - m_used);
+        std::memcpy(m_buffers[m_current] + m_used, text.data(), count);
+        m_used += count;
+        text.remove_prefix(count);
+        if (m_used == BUFFER_SIZE) {
+            submit(m_current);
+            while (m_free.empty()) {
+                reap();
+            }
+            m_current = m_free.back();
+            m_free.pop_back();
+        }
+    }
+}
+
+void UringWriter::submit(size_t buffer)
+{
+    m_lengths[buffer] = m_used;
+    m_offsets[buffer] = m_offset;
+    m_offset += m_used;
+    m_used = 0;
+
+    if (!is_uring()) {
+        write_sync(buffer, 0);
+        m_free.push_back(buffer);
+        return;
+    }
+
+    // Only this thread submits, and at most BUFFER_COUNT writes are in flight, so a slot is free
+    const unsigned tail = *m_ring->sq_tail;
+    const unsigned index = tail & *m_ring->sq_mask;
+    io_uring_sqe& sqe = m_ring->sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_WRITE_FIXED;
+    sqe.fd = m_fd;
+    sqe.addr = reinterpret_cast<uint64_t>(m_buffers[buffer]);
+    sqe.len = static_cast<uint32_t>(m_lengths[buffer]);
+    sqe.off = m_offsets[buffer];
+    sqe.buf_index = static_cast<uint16_t>(buffer);
+    sqe.user_data = buffer;
+    m_ring->sq_array[index] = index;
+    store_release(m_ring->sq_tail, tail + 1);
+    ++m_in_flight;
+
+    int result = 0;
+    do {
+        result = io_uring_enter(m_ring_fd, 1, 0, 0);
+    } while (result < 0 && errno == EINTR);
+    if (result < 0) {
+        m_has_failed = true;
+        throw std::runtime_error(std::string("io_uring submit failed: ") + std::strerror(errno));
+    }
+}
+
+void UringWriter::reap()
+{
+    if (io_uring_enter(m_ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+        m_has_failed = true;
+        throw std::runtime_error(std::string("io_uring wait failed: ") + std::strerror(errno));
+    }
+    unsigned head = *m_ring->cq_head;
+    while (head != load_acquire(m_ring->cq_tail)) {
+        const io_uring_cqe& cqe = m_ring->cqes[head & *m_ring->cq_mask];
+        const auto buffer = static_cast<size_t>(cqe.user_data);
+        if (cqe.res < 0) {
+            m_has_failed = true;
+        } else if (static_cast<size_t>(cqe.res) < m_lengths[buffer]) {
+            // Short writes are rare on files, the rest is written synchronously
+            write_sync(buffer, static_cast<size_t>(cqe.res));
+        }
+        m_free.push_back(buffer);
+        --m_in_flight;
+        ++head;
+    }
+    store_release(m_ring->cq_head, head);
+}
+
+void UringWriter::write_sync(size_t buffer, size_t done)
+{
+    while (done < m_lengths[buffer]) {
+        const ssize_t written = pwrite(m_fd, m_buffers[buffer] + done, m_lengths[buffer] - done, static_cast<off_t>(m_offsets[buffer] + done));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            m_has_failed = true;
+            return;
+        }
+        done += static_cast<size_t>(written);
+    }
+}
+
+void UringWriter::close()
+{
+    if (m_fd < 0) {
+        return;
+    }
+    if (m_used != 0) {
+        submit(m_current);
+    }
+    while (is_uring() && m_in_flight != 0) {
+        reap();
+    }
+    ::close(m_fd);
+    m_fd = -1;
+    if (m_has_failed) {
+        throw std::runtime_error("Failed to write the collector output");
+    }
+}
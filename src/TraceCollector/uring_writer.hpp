@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief Buffered file output written through io_uring, for the collector's event files.
+///
+/// Text is serialized straight into one of BUFFER_COUNT page-aligned buffers that are registered
+/// with the ring. A full buffer is submitted as one fixed-buffer write at its file offset and the
+/// caller continues in the next free buffer; buffers come back as their writes complete. The
+/// caller only waits when every buffer is in flight, so the disk runs behind serialization
+/// without a writer thread.
+///
+/// Without io_uring (old kernels, seccomp filters in containers) the same buffers are written with
+/// pwrite() on the caller's thread, like a buffered stream.
+class UringWriter {
+public:
+    static constexpr size_t BUFFER_SIZE { 1024 * 1024 };
+    static constexpr size_t BUFFER_COUNT { 8 };
+
+    /// @brief Open the file for writing, `use_uring` false forces the pwrite fallback
+    UringWriter(const std::string& path, bool use_uring);
+    ~UringWriter();
+
+    UringWriter(const UringWriter&) = delete;
+    UringWriter& operator=(const UringWriter&) = delete;
+
+    bool is_open() const { return m_fd >= 0; }
+
+    /// @brief Whether writes go through io_uring rather than the fallback
+    bool is_uring() const { return m_ring_fd >= 0; }
+
+    void write(std::string_view text);
+
+    /// @brief Write the partial buffer, wait for every write and close the file. Throws if any
+    /// write failed.
+    void close();
+
+private:
+    struct Ring;
+
+    bool setup_ring();
+    void teardown_ring();
+    void submit(size_t buffer);
+    /// @brief Wait for at least one write and recycle the buffers of all completed ones
+    void reap();
+    void write_sync(size_t buffer, size_t done);
+
+    int m_fd { -1 };
+    int m_ring_fd { -1 };
+    Ring* m_ring { nullptr };
+
+    std::vector<char*> m_buffers;
+    std::vector<size_t> m_free;
+    std::vector<size_t> m_lengths;
+    std::vector<uint64_t> m_offsets;
+    size_t m_in_flight { 0 };
+
+    size_t m_current;
+    size_t m_used { 0 };
+    uint64_t m_offset { 0 };
+    bool m_has_failed { false };
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Args/args.hpp>
+
+#include <charconv>
+#include <string>
+#include <thread>
+
+struct ArgsOpts {
+    std::string base_file = "";
+    std::string current_file = "";
+    size_t threads = std::max(std::thread::hardware_concurrency(), 1U);
+    double percentile = 90.0;
+    double threshold_pct = 10.0;
+    double alpha = 0.01;
+    size_t min_count = 20;
+};
+
+inline Args::Result parse_count(std::string_view key, std::string_view value, size_t& count)
+{
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), count);
+    if (error != std::errc {} || end != value.data() + value.size() || count == 0) {
+        return { Args::Result::Code::ERROR, std::string("Error: ") + std::string(key) + " expects a positive number" };
+    }
+    return { Args::Result::Code::OK };
+}
+
+inline Args::Result parse_real(std::string_view key, std::string_view value, double low, double high, double& real)
+{
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), real);
+    if (error != std::errc {} || end != value.data() + value.size() || real < low || real > high) {
+        return { Args::Result::Code::ERROR, std::string("Error: ") + std::string(key) + " is out of range" };
+    }
+    return { Args::Result::Code::OK };
+}
+
+inline Args::Result command_handler(std::string_view key, std::string_view value, ArgsOpts& options)
+{
+    if (key == "--base" && !value.empty()) {
+        options.base_file = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--current" && !value.empty()) {
+        options.current_file = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--threads") {
+        return parse_count(key, value, options.threads);
+    }
+    if (key == "--percentile") {
+        return parse_real(key, value, 0.0, 100.0, options.percentile);
+    }
+    if (key == "--threshold") {
+        return parse_real(key, value, 0.0, 1e9, options.threshold_pct);
+    }
+    if (key == "--alpha") {
+        return parse_real(key, value, 0.0, 1.0, options.alpha);
+    }
+    if (key == "--min-count") {
+        return parse_count(key, value, options.min_count);
+    }
+    return { Args::Result::Code::UNHANDLED };
+}
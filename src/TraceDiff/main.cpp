@@ -0,0 +1,100 @@
+#include "args.hpp"
+
+#include <Analysis/significance.hpp>
+#include <Analysis/trace_stats.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <map>
+#include <print>
+#include <utility>
+
+namespace {
+/// @brief Exit code when a scope regressed beyond the thresholds
+constexpr int EXIT_REGRESSION { 1 };
+/// @brief Exit code for usage and input errors
+constexpr int EXIT_ERROR { 2 };
+
+using ScopeKey = std::pair<std::string, std::string>;
+
+std::map<ScopeKey, Analysis::ScopeStats> by_scope(Analysis::TraceStats stats)
+{
+    std::map<ScopeKey, Analysis::ScopeStats> scopes;
+    for (Analysis::ScopeStats& scope : stats.scopes) {
+        ScopeKey key { scope.name, scope.cat };
+        scopes.emplace(std::move(key), std::move(scope));
+    }
+    return scopes;
+}
+
+double change_pct(int64_t base, int64_t current)
+{
+    return base == 0 ? (current == 0 ? 0.0 : 100.0) : 100.0 * static_cast<double>(current - base) / static_cast<double>(base);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const ArgsOpts options = Args::parse<ArgsOpts>(argc, argv, command_handler);
+    if (options.base_file.empty() || options.current_file.empty()) {
+        std::println(stderr, "Usage: trace_diff --base <trace> --current <trace> [--percentile P] [--threshold PCT] [--alpha A] [--min-count N] [--threads N]");
+        return EXIT_ERROR;
+    }
+
+    std::map<ScopeKey, Analysis::ScopeStats> base;
+    std::map<ScopeKey, Analysis::ScopeStats> current;
+    try {
+        base = by_scope(Analysis::compute_stats(Analysis::TraceFile(options.base_file), options.threads));
+        current = by_scope(Analysis::compute_stats(Analysis::TraceFile(options.current_file), options.threads));
+    } catch (const std::exception& error) {
+        std::println(stderr, "{}", error.what());
+        return EXIT_ERROR;
+    }
+
+    std::println("Regression: p{} up by more than {}% with p < {} and at least {} samples on both sides\n",
+        options.percentile, options.threshold_pct, options.alpha, options.min_count);
+    std::println("{:>8} {:>8} {:>10} {:>10} {:>9} {:>9} {:>9} {:>10}  name [cat]",
+        "base_n", "curr_n", "base_p", "curr_p", "p_change", "p50_chg", "p99_chg", "p_value");
+
+    size_t regressions = 0;
+    for (const auto& [key, before] : base) {
+        const auto it = current.find(key);
+        if (it == current.end()) {
+            std::println("{:>8} {:>8} {:>10} {:>10} {:>9} {:>9} {:>9} {:>10}  {} [{}] removed",
+                before.histogram.count(), 0, before.histogram.value_at_percentile(options.percentile), "-", "-", "-", "-", "-", key.first, key.second);
+            continue;
+        }
+        const Analysis::ScopeStats& after = it->second;
+        const Analysis::HdrHistogram& a = before.histogram;
+        const Analysis::HdrHistogram& b = after.histogram;
+
+        const int64_t base_value = a.value_at_percentile(options.percentile);
+        const int64_t current_value = b.value_at_percentile(options.percentile);
+        const double change = change_pct(base_value, current_value);
+        const Analysis::MannWhitney test = Analysis::mann_whitney(b, a);
+
+        // Slower at the gated percentile, and the whole distribution moved up significantly
+        const bool is_sampled = a.count() >= options.min_count && b.count() >= options.min_count;
+        const bool is_regression = is_sampled && change > options.threshold_pct && test.superiority > 0.5 && test.p_value < options.alpha;
+        regressions += is_regression ? 1 : 0;
+
+        std::println("{:>8} {:>8} {:>10} {:>10} {:>8.1}% {:>8.1}% {:>8.1}% {:>10.4}  {} [{}]{}",
+            a.count(), b.count(), base_value, current_value, change,
+            change_pct(a.value_at_percentile(50.0), b.value_at_percentile(50.0)),
+            change_pct(a.value_at_percentile(99.0), b.value_at_percentile(99.0)),
+            test.p_value, key.first, key.second, is_regression ? " REGRESSION" : "");
+    }
+    for (const auto& [key, after] : current) {
+        if (!base.contains(key)) {
+            std::println("{:>8} {:>8} {:>10} {:>10} {:>9} {:>9} {:>9} {:>10}  {} [{}] added",
+                0, after.histogram.count(), "-", after.histogram.value_at_percentile(options.percentile), "-", "-", "-", "-", key.first, key.second);
+        }
+    }
+
+    if (regressions != 0) {
+        std::println("\n{} scope(s) regressed", regressions);
+        return EXIT_REGRESSION;
+    }
+    std::println("\nNo regression");
+    return 0;
+}
@@ -0,0 +1,12 @@
+#!/bin/sh
+# Usage: expect_exit.sh <code> <command> [args...]
+# Runs the command and passes only if it exits with exactly <code>, unlike should_fail which
+# accepts any failure.
+expected="$1"
+shift
+"$@"
+status=$?
+if [ "$status" -ne "$expected" ]; then
+    echo "$1 exited with $status, expected $expected" >&2
+    exit 1
+fi
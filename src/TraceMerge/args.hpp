@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Args/args.hpp>
+
+#include <charconv>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ArgsOpts {
+    std::vector<std::string> inputs = {};
+    std::string output_file = "merged.json";
+    std::string temp_dir = std::filesystem::temp_directory_path().string();
+    size_t threads = std::max(std::thread::hardware_concurrency(), 1U);
+    size_t run_events = 4'000'000;
+};
+
+inline Args::Result parse_count(std::string_view key, std::string_view value, size_t& count)
+{
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), count);
+    if (error != std::errc {} || end != value.data() + value.size() || count == 0) {
+        return { Args::Result::Code::ERROR, std::string("Error: ") + std::string(key) + " expects a positive number" };
+    }
+    return { Args::Result::Code::OK };
+}
+
+inline Args::Result command_handler(std::string_view key, std::string_view value, ArgsOpts& options)
+{
+    if (key == "--input" && !value.empty()) {
+        options.inputs.emplace_back(value);
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--output" && !value.empty()) {
+        options.output_file = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--temp-dir" && !value.empty()) {
+        options.temp_dir = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--threads") {
+        return parse_count(key, value, options.threads);
+    }
+    if (key == "--run-events") {
+        return parse_count(key, value, options.run_events);
+    }
+    return { Args::Result::Code::UNHANDLED };
+}
@@ -0,0 +1,31 @@
+#include "args.hpp"
+
+#include <Analysis/trace_merge.hpp>
+
+#include <chrono>
+#include <exception>
+#include <print>
+
+int main(int argc, char** argv)
+{
+    const ArgsOpts options = Args::parse<ArgsOpts>(argc, argv, command_handler);
+    if (options.inputs.empty()) {
+        std::println(stderr, "Usage: trace_merge --input <trace> [--input <trace> ...] [--output <file>] [--temp-dir <dir>] [--run-events N] [--threads N]");
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const auto start = std::chrono::steady_clock::now();
+        const Analysis::MergeResult result = Analysis::merge_traces({ options.inputs, options.output_file, options.temp_dir, options.threads, options.run_events });
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+        std::println("Merged {} events and {} metadata events of {} files into {} in {} ms",
+            result.events, result.metadata_events, options.inputs.size(), options.output_file, elapsed.count());
+        std::println("  {} ordered ranges, {} spilled runs, {} duplicate metadata, {} malformed events",
+            result.sorted_ranges, result.spilled_runs, result.duplicate_metadata, result.malformed_events);
+    } catch (const std::exception& error) {
+        std::println(stderr, "{}", error.what());
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
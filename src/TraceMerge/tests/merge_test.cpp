@@ -0,0 +1,84 @@
+#include <cstdlib>
+#include <fstream>
+#include <print>
+#include <string>
+#include <vector>
+
+// Runs trace_merge, given as the first argument, on process_a.json and process_b.json and checks
+// the merged events and their order.
+
+namespace {
+const char* OUTPUT = "/tmp/trace_merge_test.json";
+
+struct Event {
+    std::string name;
+    char ph;
+    int64_t ts;
+};
+
+/// @brief Events of a trace written one per line, like the tools write them
+std::vector<Event> read_events(const char* path)
+{
+    std::vector<Event> events;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        const size_t name = line.find(R"("name":")");
+        const size_t ph = line.find(R"("ph":")");
+        if (name == std::string::npos || ph == std::string::npos) {
+            continue;
+        }
+        const size_t name_end = line.find('"', name + 8);
+        const size_t ts = line.find(R"("ts":)");
+        events.push_back({
+            line.substr(name + 8, name_end - name - 8),
+            line[ph + 6],
+            ts != std::string::npos ? std::atoll(line.c_str() + ts + 5) : -1,
+        });
+    }
+    return events;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4) {
+        std::println(stderr, "Usage: merge_test <trace_merge> <process_a.json> <process_b.json>");
+        return 1;
+    }
+    // Runs of 2 events make the merge spill and combine several runs per input
+    const std::string command = std::string(argv[1]) + " --input " + argv[2] + " --input " + argv[3]
+        + " --output " + OUTPUT + " --run-events 2";
+    if (std::system(command.c_str()) != 0) {
+        std::println(stderr, "trace_merge failed");
+        return 1;
+    }
+
+    const std::vector<Event> events = read_events(OUTPUT);
+    // The duplicate process_name of pid 1 is dropped, metadata comes first
+    const std::vector<std::string> expected {
+        "process_name", "thread_name", "process_name",
+        "handle", "job", "parse", "job", "handle", "parse", "flush"
+    };
+    std::vector<std::string> names;
+    for (const Event& event : events) {
+        names.push_back(event.name);
+    }
+    if (names != expected) {
+        std::println(stderr, "Merged {} events, expected {}", events.size(), expected.size());
+        return 1;
+    }
+    for (size_t i = 4; i < events.size(); ++i) {
+        if (events[i].ts < events[i - 1].ts) {
+            std::println(stderr, "Event {} at {} comes after {}", i, events[i].ts, events[i - 1].ts);
+            return 1;
+        }
+    }
+    if (events[2].ph != 'M' || events[3].ph != 'X') {
+        std::println(stderr, "Metadata is not ahead of the events");
+        return 1;
+    }
+
+    std::println("\nMerge test complete.");
+    return 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Args/args.hpp>
+
+#include <charconv>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ArgsOpts {
+    std::string input_file = "";
+    std::vector<std::string> where = {};
+    std::string group_by = "name";
+    size_t threads = std::max(std::thread::hardware_concurrency(), 1U);
+    size_t top = 20;
+    std::string sort_by = "total";
+};
+
+inline Args::Result parse_count(std::string_view key, std::string_view value, size_t& count)
+{
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), count);
+    if (error != std::errc {} || end != value.data() + value.size() || count == 0) {
+        return { Args::Result::Code::ERROR, std::string("Error: ") + std::string(key) + " expects a positive number" };
+    }
+    return { Args::Result::Code::OK };
+}
+
+inline Args::Result command_handler(std::string_view key, std::string_view value, ArgsOpts& options)
+{
+    if (key == "--input" && !value.empty()) {
+        options.input_file = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--where" && !value.empty()) {
+        options.where.emplace_back(value);
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--group-by") {
+        // An empty list aggregates all matching rows into one group
+        options.group_by = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--threads") {
+        return parse_count(key, value, options.threads);
+    }
+    if (key == "--top") {
+        return parse_count(key, value, options.top);
+    }
+    if (key == "--sort") {
+        if (value != "total" && value != "count" && value != "max" && value != "p99") {
+            return { Args::Result::Code::ERROR, "Error: --sort expects total, count, max or p99" };
+        }
+        options.sort_by = value;
+        return { Args::Result::Code::OK };
+    }
+    return { Args::Result::Code::UNHANDLED };
+}
@@ -0,0 +1,102 @@
+#include "args.hpp"
+
+#include <Analysis/column_query.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <print>
+#include <ranges>
+
+namespace {
+int64_t sort_value(const Analysis::QueryGroup& group, std::string_view sort_by)
+{
+    if (sort_by == "count") {
+        return static_cast<int64_t>(group.dur.count());
+    }
+    if (sort_by == "max") {
+        return group.dur.max();
+    }
+    if (sort_by == "p99") {
+        return group.dur.value_at_percentile(99.0);
+    }
+    return group.dur.sum();
+}
+
+std::string key_text(const Analysis::ColumnStore& store, const std::vector<Analysis::Column>& columns, const std::vector<int64_t>& key)
+{
+    std::string text;
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (i != 0) {
+            text += "  ";
+        }
+        if (Analysis::is_string_column(columns[i])) {
+            text += store.dictionary().at(static_cast<size_t>(key[i]));
+        } else if (columns[i] == Analysis::Column::PH) {
+            text += static_cast<char>(key[i]);
+        } else {
+            text += std::to_string(key[i]);
+        }
+    }
+    return text.empty() ? "[all]" : text;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const ArgsOpts options = Args::parse<ArgsOpts>(argc, argv, command_handler);
+    if (options.input_file.empty()) {
+        std::println(stderr, "Usage: trace_query --input <store> [--where <column><op><value> ...] [--group-by name,cat,ph,pid,tid]");
+        std::println(stderr, "                   [--threads N] [--top N] [--sort total|count|max|p99]");
+        std::println(stderr, "  Operators are = != < <= > >= and ~ (substring of name or cat), e.g. --where dur>=1000 --where cat=io");
+        return EXIT_FAILURE;
+    }
+
+    Analysis::Query query { {}, {}, options.threads };
+    for (const std::string& text : options.where) {
+        const auto predicate = Analysis::parse_predicate(text);
+        if (!predicate) {
+            std::println(stderr, "Invalid filter: {}", text);
+            return EXIT_FAILURE;
+        }
+        query.where.push_back(*predicate);
+    }
+    for (const auto part : std::views::split(std::string_view(options.group_by), ',')) {
+        const std::string_view name(part.begin(), part.end());
+        if (name.empty()) {
+            continue;
+        }
+        const auto column = Analysis::parse_column(name);
+        if (!column) {
+            std::println(stderr, "Unknown column: {}", name);
+            return EXIT_FAILURE;
+        }
+        query.group_by.push_back(*column);
+    }
+
+    try {
+        const auto start = std::chrono::steady_clock::now();
+        const Analysis::ColumnStore store(options.input_file);
+        Analysis::QueryResult result = Analysis::run_query(store, query);
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+        std::ranges::sort(result.groups, [&](const auto& lhs, const auto& rhs) {
+            return sort_value(lhs, options.sort_by) > sort_value(rhs, options.sort_by);
+        });
+
+        std::println("{}: {} of {} rows matched, {} of {} row groups skipped, {} ms with {} threads\n",
+            options.input_file, result.rows_matched, result.rows_scanned, result.row_groups_skipped,
+            store.row_groups().size(), elapsed.count(), options.threads);
+        std::println("{:>10} {:>14} {:>10} {:>10} {:>10} {:>10}  {}", "count", "total_us", "avg_us", "p50_us", "p99_us", "max_us",
+            options.group_by.empty() ? "" : options.group_by);
+        for (const Analysis::QueryGroup& group : result.groups | std::views::take(options.top)) {
+            const Analysis::HdrHistogram& dur = group.dur;
+            std::println("{:>10} {:>14} {:>10} {:>10} {:>10} {:>10}  {}", dur.count(), dur.sum(), static_cast<int64_t>(dur.mean()),
+                dur.value_at_percentile(50.0), dur.value_at_percentile(99.0), dur.max(), key_text(store, query.group_by, group.key));
+        }
+    } catch (const std::exception& error) {
+        std::println(stderr, "{}", error.what());
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
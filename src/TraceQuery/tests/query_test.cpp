@@ -0,0 +1,107 @@
+#include <Analysis/column_store.hpp>
+
+#include <cstdio>
+#include <print>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Runs trace_query, given as the first argument, on a store written here and checks its table.
+
+namespace {
+const char* STORE = "/tmp/trace_query_test.cols";
+
+/// @brief Standard output of the command, empty if it failed
+std::string run(const std::string& command)
+{
+    FILE* pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) {
+        return {};
+    }
+    std::string output;
+    char buffer[4096];
+    while (const size_t read = std::fread(buffer, 1, sizeof(buffer), pipe)) {
+        output.append(buffer, read);
+    }
+    return pclose(pipe) == 0 ? output : std::string {};
+}
+
+struct Row {
+    uint64_t count;
+    int64_t total_us;
+    std::string key;
+};
+
+/// @brief The result rows, below the column header
+std::vector<Row> parse_rows(const std::string& output)
+{
+    std::vector<Row> rows;
+    std::istringstream lines(output);
+    std::string line;
+    bool is_table = false;
+    while (std::getline(lines, line)) {
+        if (line.find("total_us") != std::string::npos) {
+            is_table = true;
+            continue;
+        }
+        std::istringstream fields(line);
+        Row row {};
+        int64_t avg {}, p50 {}, p99 {}, max {};
+        if (is_table && fields >> row.count >> row.total_us >> avg >> p50 >> p99 >> max) {
+            std::getline(fields >> std::ws, row.key);
+            rows.push_back(row);
+        }
+    }
+    return rows;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2) {
+        std::println(stderr, "Usage: query_test <trace_query>");
+        return 1;
+    }
+
+    // "read" in io: 300 rows of 100 us, "write" in io: 100 rows of 500 us and 100 of 50 us,
+    // "parse" in cpu: 500 rows of 1000 us
+    {
+        Analysis::ColumnStoreWriter writer(STORE, 128);
+        for (int64_t i = 0; i < 1000; ++i) {
+            const int64_t ts = 1'700'000'000'000'000 + i * 10;
+            if (i % 2 == 0) {
+                writer.write("parse", "cpu", 'X', ts, 1000, 7, 1);
+            } else if (i % 10 == 1 || i % 10 == 5 || i % 10 == 9) {
+                writer.write("read", "io", 'X', ts, 100, 7, 2);
+            } else {
+                writer.write("write", "io", 'X', ts, i % 10 == 3 ? 500 : 50, 7, 2);
+            }
+        }
+        writer.close();
+    }
+
+    std::println("1. Testing a filter with a group-by...");
+    const std::string output = run(std::string(argv[1]) + " --input " + STORE
+        + " --where cat=io --where 'dur>=100' --group-by name,cat --sort count --threads 2");
+    if (output.find("400 of 1000 rows matched") == std::string::npos) {
+        std::println(stderr, "Unexpected summary:\n{}", output);
+        return 1;
+    }
+    const std::vector<Row> rows = parse_rows(output);
+    if (rows.size() != 2 || rows[0].key != "read  io" || rows[0].count != 300 || rows[0].total_us != 30'000
+        || rows[1].key != "write  io" || rows[1].count != 100 || rows[1].total_us != 50'000) {
+        std::println(stderr, "Unexpected groups:\n{}", output);
+        return 1;
+    }
+
+    std::println("2. Testing sorting and --top...");
+    const std::vector<Row> top = parse_rows(run(std::string(argv[1]) + " --input " + STORE + " --group-by name --top 2"));
+    if (top.size() != 2 || top[0].key != "parse" || top[0].total_us != 500'000 || top[1].key != "write") {
+        std::println(stderr, "Unexpected top groups");
+        return 1;
+    }
+
+    std::remove(STORE);
+    std::println("\nQuery test complete.");
+    return 0;
+}
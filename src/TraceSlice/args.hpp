@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Args/args.hpp>
+
+#include <charconv>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ArgsOpts {
+    std::string input_file = "";
+    std::string output_file = "slice.json";
+    std::string from = "";
+    std::string to = "";
+    std::vector<int> pids = {};
+    std::vector<uint64_t> tids = {};
+    size_t threads = std::max(std::thread::hardware_concurrency(), 1U);
+};
+
+inline Args::Result parse_count(std::string_view key, std::string_view value, size_t& count)
+{
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), count);
+    if (error != std::errc {} || end != value.data() + value.size() || count == 0) {
+        return { Args::Result::Code::ERROR, std::string("Error: ") + std::string(key) + " expects a positive number" };
+    }
+    return { Args::Result::Code::OK };
+}
+
+template <class T>
+Args::Result parse_id(std::string_view key, std::string_view value, std::vector<T>& ids)
+{
+    T id {};
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), id);
+    if (error != std::errc {} || end != value.data() + value.size()) {
+        return { Args::Result::Code::ERROR, std::string("Error: ") + std::string(key) + " expects a number" };
+    }
+    ids.push_back(id);
+    return { Args::Result::Code::OK };
+}
+
+inline Args::Result command_handler(std::string_view key, std::string_view value, ArgsOpts& options)
+{
+    if (key == "--input" && !value.empty()) {
+        options.input_file = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--output" && !value.empty()) {
+        options.output_file = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--from" && !value.empty()) {
+        options.from = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--to" && !value.empty()) {
+        options.to = value;
+        return { Args::Result::Code::OK };
+    }
+    if (key == "--pid") {
+        return parse_id(key, value, options.pids);
+    }
+    if (key == "--tid") {
+        return parse_id(key, value, options.tids);
+    }
+    if (key == "--threads") {
+        return parse_count(key, value, options.threads);
+    }
+    return { Args::Result::Code::UNHANDLED };
+}
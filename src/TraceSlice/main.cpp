@@ -0,0 +1,159 @@
+#include "args.hpp"
+
+#include <Analysis/self_time.hpp>
+#include <Analysis/timeline.hpp>
+#include <Analysis/trace_file.hpp>
+#include <Profiler/chrome_event.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <optional>
+#include <print>
+
+namespace {
+struct Selected {
+    int64_t ts;
+    std::string_view raw;
+};
+
+/// @brief First timestamp of the trace, found from the index when there is one
+int64_t trace_start(const Analysis::TraceFile& file)
+{
+    if (!file.chunks().empty()) {
+        return std::ranges::min(file.chunks(), {}, &Analysis::ChunkInfo::ts_min).ts_min;
+    }
+    Analysis::EventCursor cursor(file.format(), file.partition(1).front());
+    Analysis::EventView event {};
+    int64_t start = INT64_MAX;
+    while (cursor.next(event)) {
+        start = std::min(start, event.ts);
+    }
+    return start;
+}
+
+/// @brief Microseconds since the epoch from "<us>", "<seconds>s" after the trace start, or a local
+/// time of day "HH:MM:SS[.fraction]" on the day the trace starts
+std::optional<int64_t> parse_time(std::string_view text, int64_t start)
+{
+    if (text.ends_with('s')) {
+        double seconds = 0.0;
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size() - 1, seconds);
+        if (error != std::errc {} || end != text.data() + text.size() - 1) {
+            return std::nullopt;
+        }
+        return start + static_cast<int64_t>(std::llround(seconds * 1e6));
+    }
+    if (text.find(':') != std::string_view::npos) {
+        int hours = 0;
+        int minutes = 0;
+        double seconds = 0.0;
+        const std::string copy(text);
+        if (std::sscanf(copy.c_str(), "%d:%d:%lf", &hours, &minutes, &seconds) != 3) {
+            return std::nullopt;
+        }
+        const std::time_t start_seconds = start / 1'000'000;
+        std::tm day {};
+        localtime_r(&start_seconds, &day);
+        day.tm_hour = hours;
+        day.tm_min = minutes;
+        day.tm_sec = 0;
+        day.tm_isdst = -1;
+        return int64_t { std::mktime(&day) } * 1'000'000 + static_cast<int64_t>(std::llround(seconds * 1e6));
+    }
+    int64_t us = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), us);
+    if (error != std::errc {} || end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return us;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const ArgsOpts options = Args::parse<ArgsOpts>(argc, argv, command_handler);
+    if (options.input_file.empty()) {
+        std::println(stderr, "Usage: trace_slice --input <store> [--output <file>] [--from T] [--to T] [--pid N ...] [--tid N ...] [--threads N]");
+        std::println(stderr, "  T is microseconds since the epoch, seconds after the trace start (12.5s) or a local time (14:03:10.5)");
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const auto clock_start = std::chrono::steady_clock::now();
+        const Analysis::TraceFile file(options.input_file);
+
+        const int64_t start = options.from.empty() && options.to.empty() ? 0 : trace_start(file);
+        const auto from = options.from.empty() ? std::optional<int64_t> { INT64_MIN } : parse_time(options.from, start);
+        const auto to = options.to.empty() ? std::optional<int64_t> { INT64_MAX } : parse_time(options.to, start);
+        if (!from || !to) {
+            std::println(stderr, "Invalid --from or --to");
+            return EXIT_FAILURE;
+        }
+
+        const auto is_selected_thread = [&](uint64_t thread_key) {
+            const auto pid = static_cast<int>(thread_key >> 32);
+            const uint64_t tid = thread_key & 0xffffffff;
+            return (options.pids.empty() || std::ranges::find(options.pids, pid) != options.pids.end())
+                && (options.tids.empty() || std::ranges::find(options.tids, tid) != options.tids.end());
+        };
+
+        // Only chunks whose time range and threads match are read. Files without index are scanned.
+        // Metadata events have no timestamp and count as 0, chunks holding one are always read.
+        std::vector<std::string_view> ranges;
+        size_t skipped_chunks = 0;
+        for (const Analysis::ChunkInfo& chunk : file.chunks()) {
+            if ((chunk.overlaps(*from, *to) || chunk.ts_min <= 0) && std::ranges::any_of(chunk.threads, is_selected_thread)) {
+                ranges.push_back(file.chunk_data(chunk));
+            } else {
+                ++skipped_chunks;
+            }
+        }
+        if (file.chunks().empty()) {
+            ranges = file.partition(options.threads * 4);
+        }
+
+        std::vector<std::vector<Selected>> selected(ranges.size());
+        Analysis::parallel_for(ranges.size(), options.threads, [&](size_t /* worker */, size_t index) {
+            Analysis::EventCursor cursor(file.format(), ranges[index]);
+            Analysis::EventView event {};
+            while (cursor.next(event)) {
+                // Metadata names the processes and threads of the slice, whatever the window
+                const int64_t end = event.ph == 'X' ? event.ts + event.dur : event.ts;
+                const bool is_in_window = event.ph == 'M' || (event.ts <= *to && end >= *from);
+                if (is_in_window && is_selected_thread(Analysis::SelfTimeTracker::thread_key(event.pid, event.tid))) {
+                    selected[index].push_back({ event.ts, event.raw });
+                }
+            }
+        });
+
+        std::vector<Selected> events;
+        for (const auto& range_events : selected) {
+            events.insert(events.end(), range_events.begin(), range_events.end());
+        }
+        std::ranges::stable_sort(events, {}, &Selected::ts);
+
+        std::ofstream out(options.output_file);
+        out << Tracer::TRACE_EVENTS;
+        for (size_t i = 0; i < events.size(); ++i) {
+            out << (i == 0 ? "\n" : ",\n") << events[i].raw;
+        }
+        out << "\n" << Tracer::TRACE_EVENT_BODY;
+        out.close();
+        if (!out) {
+            throw std::runtime_error("Failed to write " + options.output_file);
+        }
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - clock_start);
+        std::println("Wrote {} events to {} in {} ms, read {} of {} chunks", events.size(), options.output_file,
+            elapsed.count(), file.chunks().size() - skipped_chunks, file.chunks().size());
+    } catch (const std::exception& error) {
+        std::println(stderr, "{}", error.what());
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
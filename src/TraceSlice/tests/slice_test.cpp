@@ -0,0 +1,71 @@
+#include <cstdlib>
+#include <fstream>
+#include <print>
+#include <string>
+#include <vector>
+
+// Runs trace_slice, given as the first argument, on a trace and checks which events it kept.
+
+namespace {
+const char* OUTPUT = "/tmp/trace_slice_test.json";
+
+/// @brief Timestamps of the events of a trace written one per line, like the tools write them,
+/// metadata events without one count as -1
+std::vector<int64_t> read_timestamps(const char* path)
+{
+    std::vector<int64_t> timestamps;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (const size_t ts = line.find(R"("ts":)"); ts != std::string::npos) {
+            timestamps.push_back(std::atoll(line.c_str() + ts + 5));
+        } else if (line.find(R"("ph":"M")") != std::string::npos) {
+            timestamps.push_back(-1);
+        }
+    }
+    return timestamps;
+}
+
+bool slice(const char* trace_slice, const char* input, const std::string& options, const std::vector<int64_t>& expected)
+{
+    const std::string command = std::string(trace_slice) + " --input " + input + " --output " + OUTPUT + " " + options;
+    if (std::system(command.c_str()) != 0) {
+        std::println(stderr, "trace_slice {} failed", options);
+        return false;
+    }
+    const std::vector<int64_t> timestamps = read_timestamps(OUTPUT);
+    if (timestamps != expected) {
+        std::println(stderr, "trace_slice {} kept {} events, expected {}", options, timestamps.size(), expected.size());
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3) {
+        std::println(stderr, "Usage: slice_test <trace_slice> <process_a.json>");
+        return 1;
+    }
+
+    std::println("1. Testing a time window...");
+    // Slices overlapping [150, 310] us, the one ending at 150 included, in timestamp order after
+    // the process and thread names
+    if (!slice(argv[1], argv[2], "--from 150 --to 310 --pid 1", { -1, -1, 100, 120, 300 })) {
+        return 1;
+    }
+
+    std::println("2. Testing units and an open end...");
+    if (!slice(argv[1], argv[2], "--from 0.00019s --pid 1", { -1, -1, 300, 320 })) {
+        return 1;
+    }
+
+    std::println("3. Testing a filter that matches nothing...");
+    if (!slice(argv[1], argv[2], "--from 150 --to 0.25s --pid 2", {})) {
+        return 1;
+    }
+
+    std::println("\nSlice test complete.");
+    return 0;
+}
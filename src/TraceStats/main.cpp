@@ -0,0 +1,88 @@
+#include "args.hpp"
+
+#include <Analysis/trace_stats.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <print>
+
+namespace {
+int64_t sort_value(const Analysis::ScopeStats& scope, std::string_view sort_by)
+{
+    if (sort_by == "self") {
+        return scope.self_time;
+    }
+    if (sort_by == "count") {
+        return static_cast<int64_t>(scope.histogram.count());
+    }
+    if (sort_by == "p99") {
+        return scope.histogram.value_at_percentile(99.0);
+    }
+    return scope.histogram.sum();
+}
+
+void print_table(const Analysis::TraceStats& stats, size_t top)
+{
+    std::println("{:>10} {:>14} {:>14} {:>10} {:>10} {:>10} {:>10} {:>10}  name [cat]",
+        "count", "total_us", "self_us", "p50_us", "p90_us", "p99_us", "p999_us", "max_us");
+    for (size_t i = 0; i < std::min(top, stats.scopes.size()); ++i) {
+        const Analysis::ScopeStats& scope = stats.scopes[i];
+        const Analysis::HdrHistogram& histogram = scope.histogram;
+        std::println("{:>10} {:>14} {:>14} {:>10} {:>10} {:>10} {:>10} {:>10}  {} [{}]",
+            histogram.count(), histogram.sum(), scope.self_time, histogram.value_at_percentile(50.0),
+            histogram.value_at_percentile(90.0), histogram.value_at_percentile(99.0),
+            histogram.value_at_percentile(99.9), histogram.max(), scope.name, scope.cat);
+    }
+}
+
+void print_json(const Analysis::TraceStats& stats, size_t top)
+{
+    std::println(R"({{"events":{},"complete_events":{},"malformed_events":{},"scopes":[)",
+        stats.events, stats.complete_events, stats.malformed_events);
+    for (size_t i = 0; i < std::min(top, stats.scopes.size()); ++i) {
+        const Analysis::ScopeStats& scope = stats.scopes[i];
+        const Analysis::HdrHistogram& histogram = scope.histogram;
+        // Names are printed as they are in the trace, still escaped
+        std::println(R"({{"name":"{}","cat":"{}","count":{},"total_us":{},"self_us":{},"p50_us":{},"p90_us":{},"p99_us":{},"p999_us":{},"max_us":{}}}{})",
+            scope.name, scope.cat, histogram.count(), histogram.sum(), scope.self_time,
+            histogram.value_at_percentile(50.0), histogram.value_at_percentile(90.0),
+            histogram.value_at_percentile(99.0), histogram.value_at_percentile(99.9), histogram.max(),
+            i + 1 < std::min(top, stats.scopes.size()) ? "," : "");
+    }
+    std::println("]}}");
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const ArgsOpts options = Args::parse<ArgsOpts>(argc, argv, command_handler);
+    if (options.input_file.empty()) {
+        std::println(stderr, "Usage: trace_stats --input <trace> [--threads N] [--top N] [--sort total|self|count|p99] [--json]");
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const auto start = std::chrono::steady_clock::now();
+        const Analysis::TraceFile file(options.input_file);
+        Analysis::TraceStats stats = Analysis::compute_stats(file, options.threads);
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+        std::ranges::sort(stats.scopes, [&](const auto& lhs, const auto& rhs) {
+            return sort_value(lhs, options.sort_by) > sort_value(rhs, options.sort_by);
+        });
+
+        if (options.as_json) {
+            print_json(stats, options.top);
+            return 0;
+        }
+        std::println("{}: {} events, {} complete, {} malformed, read in {} ms with {} threads\n",
+            options.input_file, stats.events, stats.complete_events, stats.malformed_events,
+            elapsed.count(), options.threads);
+        print_table(stats, options.top);
+    } catch (const std::exception& error) {
+        std::println(stderr, "{}", error.what());
+        return EXIT_FAILURE;
+    }
+    return 0;
+}